@@ -0,0 +1,78 @@
+#ifndef ANSI_RENDER_H
+#define ANSI_RENDER_H
+
+/******************************************************************************
+ * ANSI DIFF RENDERER
+ *
+ * Writes the frames composed by ncurses as plain ANSI escape sequences,
+ * for slow links where every byte counts.
+ *  - Front buffer: cells last written to the terminal.
+ *  - Back buffer: cells of the next frame, read from ncurses' newscr.
+ *  - Only runs of changed cells are written. Short gaps of unchanged cells
+ *    are written again when that is cheaper than moving the cursor, and
+ *    attributes are only switched when they differ from the last cell.
+ *  - Colors are the terminal's own palette, custom colors (init_color)
+ *    are not sent.
+ *  - Glyphs are assumed to be one column wide.
+ *****************************************************************************/
+
+#include "tui.h"
+
+struct ansi_cell
+{
+    wchar_t ch;
+    attr_t attrs;
+    short pair;
+};
+
+struct ansi_renderer
+{
+    int fd;
+    struct pos size;
+    struct ansi_cell *front;
+    struct ansi_cell *back;
+    cchar_t *front_rows; // Front buffer as read, unchanged rows are skipped
+    cchar_t *row;        // One row read from the screen
+
+    // Terminal state after the last write, unknown after a pending wrap
+    struct pos cursor;
+    bool cursor_known;
+    struct ansi_cell style; // Only attrs and pair are used
+    bool style_known;
+
+    // Output of one frame, written at once
+    char *out;
+    size_t out_len;
+    size_t out_cap;
+};
+
+/**
+ * Switch the terminal to the alternate screen and clear it.
+ * @param  fd Terminal output, it is not closed
+ * @retval NULL if out of memory
+ */
+struct ansi_renderer *ansi_renderer_create(int fd, struct pos size);
+
+/**
+ * Start over on a terminal of another size, the screen is cleared.
+ * @return 0 on success, -1 on error, the renderer keeps its old size if
+ *         out of memory
+ */
+int ansi_renderer_resize(struct ansi_renderer *renderer, struct pos size);
+
+/**
+ * Restore attributes, cursor and the normal screen.
+ */
+void ansi_renderer_destroy(struct ansi_renderer *renderer);
+
+/**
+ * Write the cells of the screen that differ from the last frame.
+ * @param  screen Composed frame, newscr after wnoutrefresh()
+ * @param  cells_out        Cells that changed
+ * @param  attr_changes_out Attribute switches written
+ * @return Bytes written, -1 on error
+ */
+long long ansi_render_frame(struct ansi_renderer *renderer, WINDOW *screen,
+                            long *cells_out, long *attr_changes_out);
+
+#endif // ANSI_RENDER_H
@@ -0,0 +1,27 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+/******************************************************************************
+ * BATCH VALIDATION
+ *
+ * Non-interactive solve of every puzzle set in a directory.
+ *  - Puzzles are spread over a pool of worker threads.
+ *  - One JSON object per puzzle is written per line, in file/puzzle order.
+ *****************************************************************************/
+
+#include <stdio.h>
+
+struct batch_config
+{
+    int n_threads;     // 0 for one per online CPU
+    long max_guesses;  // Search budget per puzzle, 0 for no limit
+};
+extern const struct batch_config batch_config_default;
+
+/**
+ * @return 0 if every puzzle has a unique solution, 1 if any does not
+ * @retval -1 if the directory could not be read
+ */
+int batch_validate(const char *dir_name, struct batch_config config, FILE *out);
+
+#endif // BATCH_H
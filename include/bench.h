@@ -0,0 +1,75 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+/******************************************************************************
+ * BENCHMARKS
+ *
+ * Non-interactive timings of the hot paths, results are printed as a table.
+ *****************************************************************************/
+
+#include <stdio.h>
+
+/**
+ * Time a catalog scan of directories holding 10 to 10,000 copies of a set.
+ *  - Cold: no index, every file is parsed, with one thread and the default.
+ *  - Warm: index up to date, files are only stat()ed.
+ * @param  set_file_name Puzzle set file to copy
+ * @param  tmp_dir Where the scratch directories are created
+ * @return 0 on success, -1 on error
+ */
+int bench_scan(const char *set_file_name, const char *tmp_dir, FILE *out);
+
+/**
+ * Play the first puzzle of a set on a headless screen, feeding bursts of
+ * 1 to 100 repeated keys as if they were typed faster than the frame rate.
+ *  - Reports the frames rendered per key of the burst, the first frame
+ *    drawn before any input is not counted.
+ * @return 0 on success, -1 on error
+ */
+int bench_input(const char *set_file_name, FILE *out);
+
+/**
+ * Replay short key scripts (cursor moves, edits, selection) on the first
+ * puzzle of a set, in each cell mode, on a headless screen.
+ *  - One key per frame, reports screen cells changed, attribute switches,
+ *    terminal bytes and time to write per frame.
+ *  - Each replay is run with ncurses and with the ANSI renderer.
+ * @return 0 on success, -1 on error
+ */
+int bench_render(const char *set_file_name, FILE *out);
+
+/**
+ * Lay out the first puzzle of a set after each resize of a simulated
+ * drag, in each cell mode and with each renderer, on a headless screen.
+ *  - Reports the time and terminal bytes of a relayout and its frame.
+ * @return 0 on success, -1 on error
+ */
+int bench_resize(const char *set_file_name, FILE *out);
+
+/**
+ * Push cell toggles, area fills and board clears on the undo history of the
+ * first puzzle of a set, undo and redo all of them, then jump to random
+ * moves of the history.
+ *  - Reports the time per operation, the operations kept by the history,
+ *    the moves replayed per jump and the bytes the history holds.
+ * @return 0 on success, -1 on error
+ */
+int bench_undo(const char *set_file_name, FILE *out);
+
+/**
+ * Capture the first puzzle of a set after branches of 1 to all cells
+ * toggled, until every capture slot is used, then restore random captures.
+ *  - Reports the time per capture and restore, the bytes the captures hold
+ *    and what full board copies would take.
+ * @return 0 on success, -1 on error
+ */
+int bench_capture(const char *set_file_name, FILE *out);
+
+/**
+ * Play the first puzzle of a set with the keys, one per frame, on a
+ * headless screen and write the final screen, see dump_screen().
+ * @return 0 on success, -1 on error
+ */
+int render_snapshot(const char *set_file_name, const char *keys, FILE *out);
+
+#endif // BENCH_H
@@ -0,0 +1,133 @@
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+/******************************************************************************
+ * BIT-PACKED BOARD
+ *
+ * Each cell property is a bit plane, one bit per cell, packed in 64-bit words.
+ * Every plane is stored twice:
+ *  - Row lines, bit j of row i is cell (i, j)
+ *  - Column lines (transposed copy), bit i of column j is cell (i, j)
+ * so both axes can be scanned a word at a time.
+ *
+ * Bits past the end of a line are always 0.
+ *****************************************************************************/
+
+#include "puzzle.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define BB_WORD_BITS 64
+
+#define BB_N_WORDS(n_bits) (((n_bits) + BB_WORD_BITS - 1) / BB_WORD_BITS)
+#define BB_MAX_LINE_WORDS \
+    BB_N_WORDS(MAX_PZ_N_ROWS > MAX_PZ_N_COLS ? MAX_PZ_N_ROWS : MAX_PZ_N_COLS)
+
+enum bb_plane
+{
+    BB_PLANE_FILL,
+    BB_PLANE_XMARK,
+    BB_PLANE_TEMP,
+    BB_N_PLANES
+};
+
+struct bitboard
+{
+    int n_rows;
+    int n_cols;
+    int row_words; // Words per row line
+    int col_words; // Words per column line
+    uint64_t *rows[BB_N_PLANES];
+    uint64_t *cols[BB_N_PLANES];
+};
+
+/**
+ * @retval NULL if allocation failed
+ */
+struct bitboard *bitboard_create(int n_rows, int n_cols);
+void bitboard_destroy(struct bitboard *bb);
+
+/**
+ * Copy all planes. Boards must have the same size.
+ */
+void bitboard_copy(struct bitboard *dst, const struct bitboard *src);
+void bitboard_clear(struct bitboard *bb);
+
+bool bitboard_get(const struct bitboard *bb, enum bb_plane plane, struct cell cell);
+
+/**
+ * @return Bit p set if the cell is set on plane p
+ */
+unsigned bitboard_get_planes(const struct bitboard *bb, struct cell cell);
+
+/**
+ * Set/clear a bit on both the row and the column copy of the plane.
+ */
+void bitboard_put(struct bitboard *bb, enum bb_plane plane,
+                  struct cell cell, bool value);
+
+/**
+ * Overwrite word `w` of a row line, the column copy follows.
+ *  - Bits past the end of the row must be 0.
+ */
+void bitboard_put_row_word(struct bitboard *bb, enum bb_plane plane,
+                           int row, int w, uint64_t value);
+
+static inline int bitboard_line_len(const struct bitboard *bb, enum axis axis)
+{
+    return (axis == AXIS_ROW) ? bb->n_cols : bb->n_rows;
+}
+
+static inline int bitboard_line_words(const struct bitboard *bb, enum axis axis)
+{
+    return (axis == AXIS_ROW) ? bb->row_words : bb->col_words;
+}
+
+/**
+ * @return Read only view of a single row or column of a plane
+ */
+static inline const uint64_t *bitboard_line(const struct bitboard *bb,
+                                            enum bb_plane plane,
+                                            enum axis axis, int idx)
+{
+    return (axis == AXIS_ROW) ? bb->rows[plane] + idx * bb->row_words
+                              : bb->cols[plane] + idx * bb->col_words;
+}
+
+/* ---- Line helpers ---- */
+
+static inline bool bitline_test(const uint64_t *line, int i)
+{
+    return (line[i / BB_WORD_BITS] >> (i % BB_WORD_BITS)) & 1;
+}
+
+/**
+ * @return Mask of the valid bits in word `w` of a `len` bit line
+ */
+static inline uint64_t bitline_word_mask(int len, int w)
+{
+    int n_bits = len - w * BB_WORD_BITS;
+    if (n_bits >= BB_WORD_BITS) return ~(uint64_t)0;
+    if (n_bits <= 0)            return 0;
+    return ((uint64_t)1 << n_bits) - 1;
+}
+
+/**
+ * Set bits [from, to) of the line.
+ */
+void bitline_set_range(uint64_t *line, int from, int to);
+
+/**
+ * @return Index of the next set/clear bit at or after `from`, `len` if none
+ */
+int bitline_next_set(const uint64_t *line, int len, int from);
+int bitline_next_clear(const uint64_t *line, int len, int from);
+
+/**
+ * Check if the runs of set bits in line match the clue line exactly.
+ * @param clueline Right aligned, 0 padded clues
+ */
+bool bitline_matches_clues(const uint64_t *line, int len,
+                           const int *clueline, int clueline_size);
+
+#endif // BITBOARD_H
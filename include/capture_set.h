@@ -0,0 +1,81 @@
+#ifndef CAPTURE_SET_H
+#define CAPTURE_SET_H
+
+/******************************************************************************
+ * CAPTURE SET
+ *
+ * Named copies of a board that share the row lines they have in common.
+ *  - Rows are reference counted blocks. A capture copies only the rows
+ *    changed since the last capture or restore, the others are shared.
+ *  - The owner of the board marks the changed rows, see
+ *    capture_set_mark_row().
+ *  - Past the maximum number of captures, the oldest one is dropped.
+ *****************************************************************************/
+
+#include "bitboard.h"
+#include <stddef.h>
+
+#define CAPTURE_NAME_LEN 32
+
+struct capture_row
+{
+    int refs;
+    uint64_t words[]; // Word w of plane p at w * BB_N_PLANES + p
+};
+
+struct capture
+{
+    char name[CAPTURE_NAME_LEN];
+    char desc[CAPTURE_NAME_LEN];
+    struct capture_row **rows;
+};
+
+struct capture_set
+{
+    struct capture *slots; // Oldest first
+    int n_slots;
+    int max_slots;
+    int n_stored; // Captures ever made, names are numbered with it
+
+    // Rows of the board at the last capture or restore, NULL before
+    struct capture_row **shared;
+    uint64_t *rows_dirty; // Rows changed since
+    int n_rows, row_words;
+    size_t bytes_in_use;
+};
+
+/**
+ * @retval NULL if allocation failed
+ */
+struct capture_set *capture_set_create(const struct bitboard *bb, int max_slots);
+void capture_set_destroy(struct capture_set *cs);
+
+/**
+ * Capture the board in a new slot named after its number.
+ * @param  desc Description of the capture, may be cut
+ * @return Slot of the capture, -1 if allocation failed
+ */
+int capture_set_store(struct capture_set *cs, const struct bitboard *bb,
+                      const char *desc);
+
+/**
+ * Tell the set the board is now the capture in the slot, so the next
+ * capture shares its rows.
+ */
+void capture_set_restored(struct capture_set *cs, int slot);
+
+/**
+ * @return Row line words of every plane, see struct capture_row
+ */
+static inline const uint64_t *capture_set_row(const struct capture_set *cs,
+                                              int slot, int row)
+{
+    return cs->slots[slot].rows[row]->words;
+}
+
+static inline void capture_set_mark_row(struct capture_set *cs, int row)
+{
+    cs->rows_dirty[row / BB_WORD_BITS] |= (uint64_t)1 << (row % BB_WORD_BITS);
+}
+
+#endif // CAPTURE_SET_H
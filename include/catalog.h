@@ -0,0 +1,61 @@
+#ifndef CATALOG_H
+#define CATALOG_H
+
+/******************************************************************************
+ * PUZZLE CATALOG
+ *
+ * On-disk index of the puzzle set files in a directory.
+ *  - Entries are keyed by file path, mtime and size.
+ *  - Each entry holds the set metadata, so menus do not need to open the
+ *    puzzle set files. Only the set header is parsed for it, puzzles are
+ *    read and checked once a set is chosen.
+ *  - Only files that are new or changed since the last load are parsed,
+ *    entries of removed files are dropped.
+ *  - Files are checked and parsed by a pool of threads, entries stay in
+ *    file name order.
+ *****************************************************************************/
+
+#include "loader.h"
+#include "puzzle.h"
+
+#define CATALOG_MAGIC   0x474C5443U // "CTLG"
+#define CATALOG_VERSION 2
+
+struct catalog_entry
+{
+    char file_name[MAX_PZ_FILE_NAME_LEN + 1];
+    struct file_info info;
+    bool valid; // Invalid headers are kept too, so they are not parsed again
+
+    char format_ver[JSON_FMT_VER_LEN + 1];
+    char title[MAX_PZ_TITLE_LEN + 1];
+    char desc[MAX_PZ_DESC_LEN + 1];
+    int num_puzzles;
+};
+
+struct catalog
+{
+    struct catalog_entry *entries; // Sorted by file name
+    int n_entries;
+    int n_parsed; // Entries rebuilt from their file by this load
+};
+
+/**
+ * Load the catalog of a directory, updating the index file if any puzzle
+ * set file was added, changed or removed.
+ *  - A missing or unreadable index file is rebuilt from scratch.
+ * @param  n_threads Scan threads, 0 for the default
+ * @retval NULL if the directory could not be read
+ */
+struct catalog *catalog_load(const char *dir_name, const char *index_file_name,
+                             int n_threads);
+void catalog_destroy(struct catalog *catalog);
+
+/**
+ * Fill the metadata of a puzzle set from a catalog entry, no puzzles are
+ * created. Same result as puzzle_set_create() with LOAD_METADATA_ONLY.
+ */
+void catalog_entry_get_metadata(const struct catalog_entry *entry,
+                                struct puzzle_set *pset);
+
+#endif // CATALOG_H
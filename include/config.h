@@ -4,7 +4,11 @@
 #define LOG_FILE_NAME "./log.txt"
 #define PUZZLE_DIR "./puzzles"
 #define SAVE_FILE_NAME "./save.dat"
+#define CATALOG_FILE_NAME "./catalog.dat"
 #define LOG_LEVEL LOG_DEBUG
 #define CLEAR_LOG_AT_STARTUP 1
+#define UNDO_MEMORY_CAP (16 * 1024 * 1024) // Bytes, oldest moves are dropped past it
+#define UNDO_SNAPSHOT_INTERVAL 64 // Moves, at most this many are replayed by a jump
+#define CAPTURE_MAX_SLOTS 16 // Oldest capture is dropped past it
 
 #endif // CONFIG_H
@@ -10,6 +10,12 @@ enum commands
     CMD_CLEAR,
     CMD_CAPTURE,
     CMD_RESTORE_CAPTURE,
+    CMD_EARLIER_STATE,
+    CMD_LATER_STATE,
+    CMD_OLDEST_STATE,
+    CMD_NEWEST_STATE,
+    CMD_GOTO_MOVE,
+    CMD_CELL_MODE,
     CMD_SAVE,
     CMD_QUIT,
     CMD_N
@@ -32,4 +38,10 @@ extern char *command_mode_desc[CMD_N];
 enum game_return_code new_game(void);
 enum game_return_code continue_game(void);
 
+/**
+ * Play a puzzle from the start until it is solved or the user quits.
+ *  - Also returns when the input is closed.
+ */
+enum game_return_code play_puzzle(const struct puzzle *pz);
+
 #endif // GAME_CONTROL_H
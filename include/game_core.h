@@ -5,6 +5,7 @@
  * CORE GAMEPLAY LOGIC
  *****************************************************************************/
 
+#include "bitboard.h"
 #include "puzzle.h"
 #include <stdbool.h>
 
@@ -17,12 +18,32 @@ enum cell_state
     CELL_TEMP_XMARKED
 };
 
+/**
+ * Cells and lines changed since the last clear_changes().
+ *  - Filled by every board change, undo/redo and area operations included,
+ *    so the UI only redraws what changed.
+ */
+struct change_set
+{
+    uint64_t *cells;    // Row lines, bit j of row i is cell (i, j)
+    uint64_t *lines[2]; // Lines whose solved status changed, by enum axis
+    int row_words;
+    int n_words; // Cells and lines, one block
+    bool any;
+};
+
 struct game_state 
 {
     const struct puzzle *puzzle;
-    enum cell_state **board_state;
-    enum cell_state **board_capture;
-    struct undo_queue *undo_queue;
+    struct bitboard *board;
+    struct capture_set *captures;
+    struct undo_tree *undo_tree;
+
+    // Cached validation, bit i set if line i matches its clues
+    uint64_t *line_solved[2]; // Indexed by enum axis
+    int n_unsolved_lines;
+
+    struct change_set changes;
 };
 
 struct game_state *game_state_create(const struct puzzle *pz);
@@ -53,13 +74,104 @@ void clear_board(struct game_state *gs);
 
 void auto_xmark(struct game_state *gs);
 void delete_temp_marks(struct game_state *gs);
-void store_capture(struct game_state *gs);
-void restore_capture(struct game_state *gs);
+/**
+ * Capture the board in a new slot of gs->captures, past CAPTURE_MAX_SLOTS
+ * the oldest capture is dropped.
+ *  - Only the rows changed since the last capture or restore are copied.
+ * @return Slot of the capture, -1 if allocation failed
+ */
+int store_capture(struct game_state *gs);
+
+/**
+ * Set the board to a capture, as one move. Only the words of the rows that
+ * differ from the board are written.
+ */
+void restore_capture(struct game_state *gs, int slot);
+
+enum undo_jump
+{
+    UNDO_JUMP_EARLIER, // Move before the current one in time, in any branch
+    UNDO_JUMP_LATER,
+    UNDO_JUMP_OLDEST,  // Oldest move kept
+    UNDO_JUMP_NEWEST,  // Last move made, in any branch
+};
+
+/**
+ * Move along the undo tree: undo to the parent, redo to the child last
+ * visited. Making a move after an undo starts a new branch.
+ * @return False if there was nothing to undo/redo
+ */
+bool undo(struct game_state *gs);
+bool redo(struct game_state *gs);
+
+/**
+ * Go to the board as it was right after a move, in any branch.
+ *  - Restores the nearest snapshot before it and replays the moves after
+ *    it, at most UNDO_SNAPSHOT_INTERVAL.
+ * @param  move Moves are numbered in the order they were made, 0 is the
+ *              start of the history
+ * @return Moves replayed, -1 if the move is no longer kept
+ */
+int undo_goto(struct game_state *gs, uint32_t move);
+
+/**
+ * @return False if there was no such move to go to
+ */
+bool undo_jump(struct game_state *gs, enum undo_jump jump);
+uint32_t undo_current_move(const struct game_state *gs);
 
-void undo(struct game_state *gs);
-void redo(struct game_state *gs);
+/**
+ * @return Bytes held by the undo history, see UNDO_MEMORY_CAP
+ */
+size_t undo_bytes_in_use(const struct game_state *gs);
 
+/**
+ * Check the line against its clues by scanning the board.
+ *  - Use is_axis_solved() for the cached result.
+ */
 bool validate_axis(const struct game_state *gs, enum axis axis, int idx);
-bool game_solved(const struct game_state *gs);
+
+/**
+ * Cached validate_axis() result, kept up to date on every cell change.
+ */
+static inline bool is_axis_solved(const struct game_state *gs, 
+                                  enum axis axis, int idx)
+{
+    return bitline_test(gs->line_solved[axis], idx);
+}
+
+static inline bool game_solved(const struct game_state *gs)
+{
+    return gs->n_unsolved_lines == 0;
+}
+
+/* ---- Change set ---- */
+
+static inline bool has_changes(const struct game_state *gs)
+{
+    return gs->changes.any;
+}
+
+/**
+ * @return Bit line of the changed cells of a row, n_cols bits
+ */
+static inline const uint64_t *changed_cells(const struct game_state *gs, int row)
+{
+    return gs->changes.cells + row * gs->changes.row_words;
+}
+
+/**
+ * @return True if the solved status of the line changed
+ */
+static inline bool is_axis_changed(const struct game_state *gs,
+                                   enum axis axis, int idx)
+{
+    return bitline_test(gs->changes.lines[axis], idx);
+}
+
+/**
+ * Start a new change set, call once the changes are displayed.
+ */
+void clear_changes(struct game_state *gs);
 
 #endif // GAME_CORE_H
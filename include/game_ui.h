@@ -10,27 +10,121 @@
 #include "puzzle.h"
 #include "game_core.h"
 
+enum cell_mode
+{
+    CELL_MODE_BOXED,       // 4x2 cells inside a grid
+    CELL_MODE_COMPACT,     // 2x1 cells, guide blocks are shaded
+    CELL_MODE_HALF_BLOCK,  // 2x1 cells, two board rows per terminal row
+    CELL_MODE_N
+};
+
+/**
+ * Main window columns taken by a clue.
+ */
+struct clue_span
+{
+    struct pos start;
+    int width;
+    int value;
+};
+
+/**
+ * Where the clues of a row or column are drawn in the current layout.
+ *  - Row clues are on one terminal row, column clues one per terminal row
+ *    above the board.
+ *  - The region is the area colored when the line is solved, the same
+ *    columns on each of its rows.
+ */
+struct clue_line
+{
+    struct clue_span *clues; // Non-zero clues, left to right/top to bottom
+    int n_clues;
+
+    bool in_view;
+    struct pos region_start;
+    int region_width;
+    int region_height;
+};
+
+struct clue_layout
+{
+    struct clue_line *lines[2]; // By enum axis, one per row/column
+    struct clue_span *spans;    // Storage of every line's clues
+    int max_clues[2];           // Most clues in one line
+    int digits[2];              // Digits of the largest clue
+    int row_clue_width;         // Digits and the space before them
+    int col_clue_width;
+};
+
 struct game_ui 
 {
     WINDOW *win;
     WINDOW *board;
     struct menu_set *cmd_menu;
     const struct puzzle *puzzle;
+
+    // Redraw every cell and clue on the next display_game_state()
+    bool full_repaint;
+
+    // Selection highlighted on screen, only the difference is restyled
+    bool has_selection;
+    struct cell sel_start, sel_end;
+
+    // Visible part of the board, the board window only holds these cells
+    struct cell view_start, view_size;
+
+    // Terminal rows/columns taken by a cell, set from cell_mode by
+    // game_ui_set_windows()
+    enum cell_mode cell_mode;
+    struct pos cell_size;
+
+    // Clue values are set once, positions again on each layout or scroll
+    struct clue_layout clues;
 };
 
 struct game_ui *game_ui_create(const struct puzzle *pz);
+
+/**
+ * Lay out the windows for the terminal size and cell mode.
+ *  - Can be called again after a resize or cell mode change, the windows
+ *    are replaced and the view keeps its start where it still fits.
+ *  - Clue values are kept, only their positions are computed again.
+ */
 int game_ui_set_windows(struct game_ui *ui);
 void game_ui_destroy(struct game_ui *ui);
 
-void highlight_area(struct game_ui *ui, struct cell start, struct cell end, attr_t attr);
+/**
+ * Change how cells are drawn and lay the windows out again.
+ *  - The base board must be displayed again.
+ * @return 0 on success, -1 if the terminal cannot draw the mode
+ */
+int game_ui_set_cell_mode(struct game_ui *ui, enum cell_mode mode);
+
+/**
+ * Highlight the selected area, replacing the previous selection.
+ *  - Only cells entering or leaving the selection are restyled.
+ *  - Attributes come from the board, the screen is never read back.
+ */
+void draw_selection(struct game_ui *ui, const struct game_state *state,
+                    struct cell start, struct cell end);
 
 /**
  * Display the base puzzle board with row and column clues.
+ *  - Staged for the next frame_display(), like the other display functions.
  */
 void display_base_board(struct game_ui *ui);
 
+/**
+ * Scroll the board so the cell is visible, no-op if it already is.
+ *  - The view is recentered on the cell, aligned to the 5x5 guide grid.
+ *  - Base board is redrawn and a full repaint is pending.
+ */
+void scroll_to_cell(struct game_ui *ui, struct cell cell);
+
 /**
  * Update the ui with the current game state 
+ *  - Only cells and clue lines in the state's change set are redrawn,
+ *    unless a full repaint is pending.
  */
 void display_game_state(struct game_ui *ui, const struct game_state *state);
 
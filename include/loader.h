@@ -1,6 +1,7 @@
 #ifndef LOADER_H
 #define LOADER_H
 
+#include <limits.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include "cJSON/cJSON.h"
@@ -15,9 +16,54 @@ struct json_property
     int min, max;
 };
 
+/**
+ * @brief Type and size of a JSON value, checked against a json_property
+ *  - size is text length, number value or array size, by type.
+ *  - type is cJSON_Invalid for a missing value.
+ */
+struct json_value_info
+{
+    int type;
+    int size;
+};
+
+#define JSON_READER_BUF_SIZE  4096
+#define JSON_READER_MAX_DEPTH CJSON_NESTING_LIMIT
+
+/**
+ * @brief Pull parser over a JSON file
+ *  - The file is read in chunks and values are read in file order, no tree
+ *    is built.
+ *  - Errors are sticky: after the first one is logged every call fails.
+ *  - Nesting deeper than JSON_READER_MAX_DEPTH is an error, as in cJSON.
+ */
+struct json_reader
+{
+    FILE *fp;
+    const char *file_name;
+    char buf[JSON_READER_BUF_SIZE];
+    size_t pos, len;
+    long buf_offset; // File offset of buf[0]
+    bool need_comma; // A value was read at the current level
+    int depth;       // Objects and arrays entered and not yet left
+    bool error;
+};
+
+
+struct file_info
+{
+    long long mtime_ns;
+    long long size;
+};
 
 bool file_exists(const char *file_name);
 
+/**
+ * @brief  Modification time and size of a regular file
+ * @retval false if the file does not exist or is not a regular file
+ */
+bool get_file_info(const char *file_name, struct file_info *info_out);
+
 /**
  * @brief  Loads entire text file into memory
  * @retval NULL if error
@@ -32,11 +78,81 @@ char *load_file(const char *file_name);
  */
 char **list_json_files(const char *dir_name, int *n_files_out);
 
+/**
+ * @brief  Lists all file names in a directory ending with ext, e.g. ".npk"
+ * @see    list_json_files
+ */
+char **list_files_with_ext(const char *dir_name, const char *ext,
+                           int *n_files_out);
+
 /** 
  * @breif  Check if parsed json object has property with correct spec
  */
 bool is_valid_json_property(const cJSON *json, const struct json_property prop);
 
+/**
+ * @brief  Check a value against a property spec, same warnings as
+ *         is_valid_json_property()
+ */
+bool is_valid_json_value(struct json_value_info info,
+                         const struct json_property prop);
+
+/**
+ * @brief  Same check as is_valid_json_value(), without logging
+ */
+bool is_json_value_in_spec(struct json_value_info info,
+                           const struct json_property prop);
+
+/**
+ * @brief  Open a file for json_reader, logs if it fails
+ */
+bool json_reader_open(struct json_reader *r, const char *file_name);
+void json_reader_close(struct json_reader *r);
+
+/**
+ * @brief  cJSON type (cJSON_String, ...) of the next value
+ * @retval cJSON_Invalid if error
+ */
+int json_peek_type(struct json_reader *r);
+
+/**
+ * @brief  Step into an object or array
+ * @retval false if the next value is not one
+ */
+bool json_enter_object(struct json_reader *r);
+bool json_enter_array(struct json_reader *r);
+
+/**
+ * @brief  Read the key of the next object member, the value is next
+ *  - Longer keys are truncated to key_size - 1.
+ * @retval false at the end of the object (consumed) or on error
+ */
+bool json_next_member(struct json_reader *r, char *key, size_t key_size);
+
+/**
+ * @brief  Move to the next array element
+ * @retval false at the end of the array (consumed) or on error
+ */
+bool json_next_element(struct json_reader *r);
+
+/**
+ * @brief  Read a string, keeps at most size - 1 bytes
+ * @return Full length in bytes. -1 if error
+ */
+int json_read_string(struct json_reader *r, char *buf, size_t size);
+bool json_read_number(struct json_reader *r, double *value_out);
+bool json_skip_value(struct json_reader *r);
+
+/**
+ * @brief  Same saturating conversion as cJSON's valueint
+ */
+static inline int json_number_to_int(double value)
+{
+    if (value >= INT_MAX) return INT_MAX;
+    if (value <= (double)INT_MIN) return INT_MIN;
+    return (int)value;
+}
+
 /**
  * @brief  Parse JSON file into cJSON object
  * @retval NULL if error
@@ -0,0 +1,76 @@
+#ifndef PACK_H
+#define PACK_H
+
+/******************************************************************************
+ * COMPILED PUZZLE PACK (.npk)
+ *
+ * Binary form of a puzzle set, mapped into memory instead of parsed.
+ *
+ * Layout, native byte order, all offsets from the start of the file:
+ *  - struct npk_header
+ *  - struct npk_entry[n_puzzles], at index_offset
+ *  - Clue data, each puzzle's row clues then column clues as contiguous
+ *    int arrays in the same layout as the alloc2d() arrays of struct puzzle
+ *    (right aligned, 0 padded clue lines)
+ *
+ * Puzzles loaded from a pack point straight into the mapping for their
+ * clues, the mapping is owned by the puzzle set.
+ *****************************************************************************/
+
+#include "puzzle.h"
+#include <stdint.h>
+#include <string.h>
+
+#define NPK_EXT     ".npk"
+#define NPK_MAGIC   0x314B504EU // "NPK1"
+#define NPK_VERSION 1
+
+struct npk_header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t header_size;   // sizeof(struct npk_header) of the writer
+    uint32_t int_size;      // sizeof(int) of the writer
+    uint32_t n_puzzles;
+    uint32_t index_offset;
+    char format_ver[JSON_FMT_VER_LEN + 1];
+    char title[MAX_PZ_TITLE_LEN + 1];
+    char desc[MAX_PZ_DESC_LEN + 1];
+};
+
+struct npk_entry
+{
+    char title[MAX_PZ_TITLE_LEN + 1];
+    char author[MAX_PZ_AUTHOR_LEN + 1];
+    int32_t difficulty;
+    int32_t n_rows;
+    int32_t n_cols;
+    uint32_t row_clues_offset;
+    uint32_t col_clues_offset;
+};
+
+/**
+ * Map a pack file and build the puzzle set on top of it.
+ * @retval NULL if the file is not a valid pack
+ */
+struct puzzle_set *pack_load(const char *file_name, enum load_mode mode);
+
+/**
+ * Write a fully loaded puzzle set as a pack.
+ * @return 0 on success, -1 on error
+ */
+int pack_write(const struct puzzle_set *pset, const char *file_name);
+
+/**
+ * @return Pack file name for a JSON file name, "dir/set.json" -> "dir/set.npk"
+ * @retval NULL if allocation failed
+ */
+char *pack_file_name(const char *json_file_name);
+
+static inline bool is_pack_file_name(const char *file_name)
+{
+    const char *ext = strrchr(file_name, '.');
+    return ext != NULL && strcmp(ext, NPK_EXT) == 0;
+}
+
+#endif // PACK_H
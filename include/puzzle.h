@@ -13,6 +13,7 @@
  *****************************************************************************/
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdio.h>
 #define JSON_FMT_VER "0.2.0"
 #define JSON_FMT_VER_LEN 5
@@ -22,8 +23,8 @@
 #define MAX_PZ_DESC_LEN      255
 #define MAX_PZ_FILE_NAME_LEN 255
 
-#define MAX_PZ_N_ROWS 50 
-#define MAX_PZ_N_COLS 50
+#define MAX_PZ_N_ROWS 200
+#define MAX_PZ_N_COLS 200
 
 #define MAX_PZ_PER_SET 10
 
@@ -35,6 +36,10 @@ struct puzzle_set
     char desc[MAX_PZ_DESC_LEN + 1];
     int num_puzzles;
     struct puzzle *puzzles[MAX_PZ_PER_SET];
+
+    // Mapped pack file the puzzles' clues point into, NULL for JSON sets
+    void *map;
+    size_t map_size;
 };
 
 struct puzzle 
@@ -46,6 +51,7 @@ struct puzzle
     int n_cols;
     int **row_clues;
     int **col_clues;
+    bool clues_mapped; // Clue data belongs to a mapped pack, not the puzzle
 };
 
 struct cell 
@@ -59,15 +65,38 @@ enum axis
     AXIS_COL
 };
 
+enum load_mode 
+{
+    LOAD_METADATA_ONLY,
+    LOAD_ALL
+};
+
+/**
+ * Load a puzzle set from a JSON file or a compiled pack (.npk).
+ * @retval NULL if the file is not a valid puzzle set
+ */
+struct puzzle_set *puzzle_set_create(const char *file_name, enum load_mode mode);
 struct puzzle_set *puzzle_set_create_from_user_selection(void);
 struct puzzle *select_puzzle_from_set(struct puzzle_set *pset);
 struct puzzle *puzzle_create_from_save(void);
 
+/**
+ * List puzzle set files in a directory, with directory path.
+ *  - A pack is listed instead of its JSON source unless the JSON is newer.
+ *  - Sorted by file name.
+ * @retval NULL if error
+ */
+char **list_puzzle_set_files(const char *dir_name, int *n_files_out);
+
 void puzzle_set_destroy(struct puzzle_set *pset);
 
 void puzzle_destroy(struct puzzle *puzzle);
 
-bool skip_puzzle_from_file(FILE *fp, const struct puzzle *pz);
+/**
+ * Check that clues are in range and fit their lines.
+ *  - Does not check for a unique solution, see is_valid_puzzle().
+ */
+bool is_valid_clues(const struct puzzle *pz);
 
 static inline int get_row_clueline_size(const struct puzzle *pz)
 {
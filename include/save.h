@@ -0,0 +1,55 @@
+#ifndef SAVE_H
+#define SAVE_H
+
+/******************************************************************************
+ * SAVE FILE
+ *
+ * Puzzle and board of a game in progress.
+ *
+ * Layout of version 2, little endian, packed:
+ *  - u32 magic, u32 version
+ *  - u8 title length, title; u8 author length, author (no terminators)
+ *  - i32 difficulty, u8 n_rows, u8 n_cols
+ *  - Clue lines, rows then columns: u8 number of clues, then each clue as a
+ *    u8, without the 0 padding
+ *  - Cells, row by row, SAVE_CELL_BITS each, packed from the low bit of
+ *    each byte
+ *  - u32 CRC-32 (IEEE) of everything before it
+ *
+ * Version 1 has no header: the title and author buffers, native ints for
+ * difficulty and size, the padded clue arrays and one enum cell_state per
+ * cell. It is still read, a save is always written as version 2.
+ *****************************************************************************/
+
+#include "puzzle.h"
+#include <stdint.h>
+
+#define SAVE_MAGIC     0x56534E89U // "\x89NSV", no version 1 title starts so
+#define SAVE_VERSION   2
+#define SAVE_CELL_BITS 3
+
+/**
+ * Write a puzzle and its board, replacing the file.
+ * @param  cells n_rows * n_cols cell values, row by row, each below
+ *               1 << SAVE_CELL_BITS
+ * @return 0 on success, -1 on error
+ */
+int save_write(const char *file_name, const struct puzzle *pz,
+               const uint8_t *cells);
+
+/**
+ * @return Puzzle of a save file, not checked for a unique solution
+ * @retval NULL if the file is not a valid save
+ */
+struct puzzle *save_load_puzzle(const char *file_name);
+
+/**
+ * Read the board of a save file.
+ * @param  pz    Puzzle read from the same file, its size is checked
+ * @param  cells n_rows * n_cols cell values out, row by row, not checked
+ * @return 0 on success, -1 on error
+ */
+int save_load_cells(const char *file_name, const struct puzzle *pz,
+                    uint8_t *cells);
+
+#endif // SAVE_H
@@ -0,0 +1,120 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+
+/******************************************************************************
+ * NONOGRAM SOLVER
+ *
+ * Line propagation:
+ *  - For a line, find the left-most and right-most placement of its clue
+ *    blocks that agree with the cells known so far.
+ *  - Cells covered by the same block in both placements are filled, cells
+ *    in the same gap in both placements are empty.
+ *  - When the overlap gives nothing new, the line is settled exactly: a cell
+ *    is fixed if it is the same in every placement.
+ *  - Lines crossing a newly fixed cell are queued again, until the queue
+ *    runs dry (stalled) or every cell is known (solved).
+ *
+ * The grid is a bitboard where
+ *  - BB_PLANE_FILL  : Cell known to be filled
+ *  - BB_PLANE_XMARK : Cell known to be empty
+ * A cell with neither bit set is unknown.
+ *
+ * Search:
+ *  - When propagation stalls, branch on the unknown cell whose row and
+ *    column have the fewest unknown cells, trying filled then empty.
+ *****************************************************************************/
+
+#include "bitboard.h"
+#include "puzzle.h"
+#include <stdbool.h>
+
+enum solve_status
+{
+    SOLVE_CONTRADICTION = -1,
+    SOLVE_STALLED,
+    SOLVE_SOLVED
+};
+
+struct solver_stats
+{
+    long n_line_solves;  // Lines run through the line solver
+    long n_cells_fixed;  // Cells deduced by propagation
+    long n_guesses;      // Branches taken by the search
+    int  max_depth;      // Deepest search level reached
+};
+
+struct solver
+{
+    const struct puzzle *puzzle;
+    struct bitboard *grid;
+    int n_known;         // Cells in grid that are known
+    struct solver_stats stats;
+
+    /* Clues per line without padding, rows first then columns */
+    int *clues;
+    int *clue_start;     // Offset into clues per line id
+    int *n_clues;        // Per line id
+
+    /* Work queue of dirty line ids, rows are [0, n_rows) */
+    int *queue;
+    int queue_head, queue_len;
+    uint64_t *queued;
+
+    /* Line solver scratch */
+    unsigned char *cells;
+    unsigned char *rev_cells;
+    int *rev_clues;
+    int *run;
+    int *left;
+    int *right;
+    unsigned char *fit;
+    unsigned char *rev_fit;
+    int *can_fill;
+
+    /* Search, one saved grid per depth */
+    struct bitboard **stack;
+    int stack_size;
+    long max_guesses;    // Give up after this many guesses, 0 for no limit
+    bool gave_up;
+};
+
+/**
+ * @retval NULL if allocation failed
+ */
+struct solver *solver_create(const struct puzzle *pz);
+void solver_destroy(struct solver *s);
+
+/**
+ * Forget every deduction and queue all lines again.
+ */
+void solver_reset(struct solver *s);
+
+/**
+ * Run line propagation until the work queue is empty.
+ *  - s->grid holds the solved grid, or the partial grid where it stalled.
+ */
+enum solve_status solver_propagate(struct solver *s);
+
+/**
+ * Depth first search with line propagation at every node.
+ *  - Continues from the current grid, call solver_reset() for a fresh count.
+ *  - Stops as soon as `limit` solutions are found.
+ *  - s->grid is left in an unspecified state.
+ *
+ * @param solution Optional output, receives the first solution found
+ * @return Number of solutions found, at most `limit`
+ * @retval -1 if allocation failed or s->max_guesses was reached (s->gave_up)
+ */
+int solver_count_solutions(struct solver *s, int limit, struct bitboard *solution);
+
+static inline int solver_n_lines(const struct solver *s)
+{
+    return s->puzzle->n_rows + s->puzzle->n_cols;
+}
+
+static inline bool solver_is_solved(const struct solver *s)
+{
+    return s->n_known == s->puzzle->n_rows * s->puzzle->n_cols;
+}
+
+#endif // SOLVER_H
@@ -43,15 +43,67 @@ enum color_pairs
 
 #define COLOR_GREY 8
 #define COLOR_DARK_GREY 238
+#define COLOR_SHADE 236
 
 
+enum frame_renderer
+{
+    RENDERER_NCURSES, // Ncurses' own output optimizer
+    RENDERER_ANSI,    // Cell diff written as plain ANSI, see ansi_render.h
+};
+
+/**
+ * Choose how frames are written, before the screen is initialized.
+ *  - Ncurses still composes every frame, with RENDERER_ANSI its own output
+ *    is discarded.
+ */
+void set_frame_renderer(enum frame_renderer renderer);
+
 /**
  * Initialize/configure the ncurses screen.
  *  - Must be called before any other tui functions.
  *  - Installs cleanup function to be called at exit.
+ *  - Terminal output of each frame is counted, see get_frame_stats().
  */
 void init_screen(void);
 
+/**
+ * Initialize ncurses without a terminal, for benchmarks and snapshots.
+ *  - Keys are read from `in`, output is discarded.
+ *  - The screen only exists in memory, cells changed by each frame are
+ *    counted, see struct frame_stats, and it can be dumped as text.
+ * @param term Terminal type to emulate, NULL for $TERM
+ * @return 0 on success, -1 on error
+ */
+int init_headless_screen(FILE *in, const char *term, struct pos size);
+void end_headless_screen(void);
+
+/**
+ * Write the characters on screen, then their color pairs, one line per
+ * screen row. Line drawing characters are written as ASCII.
+ *  - Color pairs are single base 36 digits, '.' for the default pair.
+ */
+void dump_screen(FILE *out);
+
+/**
+ * Read a key that is already queued, without waiting.
+ * @retval ERR if no key is pending
+ */
+int get_pending_key(WINDOW *win);
+
+/**
+ * Wait at most timeout_ms for a key.
+ * @retval ERR if no key came
+ */
+int get_key_within(WINDOW *win, int timeout_ms);
+
+/**
+ * Follow a terminal resize, after KEY_RESIZE or resize_term().
+ *  - Ncurses resizes its own screen, the ANSI renderer reads the new size
+ *    and starts over on a cleared screen.
+ */
+void resize_screen(void);
+
 void print_in_middle(WINDOW *win, const char *string);
 
 /**
@@ -60,9 +112,74 @@ void print_in_middle(WINDOW *win, const char *string);
  */
 void display_notification(const char *msg);
 
+/**
+ * Ask the user for a number.
+ *  - Digits and backspace edit it, enter accepts it and 'q' cancels.
+ * @param  value_out Number entered, at most max
+ * @return False if cancelled or nothing was entered
+ */
+bool prompt_number(const char *msg, long max, long *value_out);
+
 void color_pairs_test(void);
 void color_test(void);
 
+/**
+ * Color pair of any two colors, created on first use after the fixed
+ * color_pairs.
+ * @return COLOR_P_DEFAULT if the terminal has no pairs left
+ */
+short get_color_pair(short fg, short bg);
+
+/**
+ * @return Terminal can draw Unicode characters (UTF-8 locale)
+ */
+bool has_unicode(void);
+
+/* ---- Frame ---- */
+
+/**
+ * Windows are staged as they are drawn and sent to the terminal together,
+ * one flush per frame instead of one per window.
+ */
+
+struct frame_stats
+{
+    long n_frames;
+    long long last_bytes;  // Terminal output of the last frame
+    long long max_bytes;
+    long long total_bytes;
+    long long last_us;     // Time to compute and write the last frame
+    long long total_us;
+
+    // Headless screen or ANSI renderer only
+    long last_cells;         // Screen cells changed by the last frame
+    long last_attr_changes;  // Attribute switches to draw them in order
+    long long total_cells;
+    long long total_attr_changes;
+};
+
+/**
+ * Add the window to the next frame (wnoutrefresh), nothing is written yet.
+ */
+void frame_stage(WINDOW *win);
+
+/**
+ * Write every staged window to the terminal with a single doupdate(), or
+ * a single write of the ANSI renderer.
+ */
+void frame_display(void);
+
+/**
+ * @return Output counters of the frames displayed so far
+ */
+const struct frame_stats *get_frame_stats(void);
+
+/**
+ * Call hook(arg) after each frame is displayed, NULL to remove it.
+ *  - Lets a headless screen be fed one key per frame.
+ */
+void set_frame_hook(void (*hook)(void *arg), void *arg);
+
 /* ---- Menu ---- */ 
 
 /**
@@ -102,6 +219,12 @@ struct menu_set *menu_set_create(const struct menu_param *params);
  * @param config Use global menu_config_default for default values.
  */
 void menu_set_configure(struct menu_set *mset, const struct menu_config config);
+
+/**
+ * Move a configured menu, it must not be posted.
+ * @return 0 on success, -1 if it does not fit the screen
+ */
+int menu_set_move(struct menu_set *mset, struct pos start);
 void menu_set_destroy(struct menu_set *mset);
 
 /**
@@ -0,0 +1,93 @@
+#ifndef UNDO_HISTORY_H
+#define UNDO_HISTORY_H
+
+/******************************************************************************
+ * UNDO HISTORY
+ *
+ * Append-only log of variable size undo records, kept in a chain of fixed
+ * size chunks that grows on demand.
+ *  - Records are opaque to the history, 8-byte aligned, zero padded.
+ *  - Each record gets the next id, ids are never reused.
+ *  - When a new chunk would take the history past its memory cap, the
+ *    oldest chunks and their records are dropped first. A dropped chunk is
+ *    kept for reuse, so a full history allocates nothing.
+ *****************************************************************************/
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define UNDO_CHUNK_SIZE (64 * 1024) // Bytes of records per chunk
+
+struct undo_chunk
+{
+    struct undo_chunk *prev, *next;
+    size_t size; // Bytes of records it can hold
+    size_t used;
+    uint32_t first_id;
+    uint64_t data[];
+};
+
+struct undo_history
+{
+    struct undo_chunk *first; // Oldest records
+    struct undo_chunk *last;  // Records are only pushed here
+    uint32_t first_id;        // Oldest record kept
+    uint32_t end_id;          // Id of the next record
+
+    struct undo_chunk *spare; // Dropped chunk kept for reuse
+    size_t bytes_in_use;
+    size_t memory_cap;
+};
+
+/**
+ * @param  memory_cap Bytes the chunks may take, at least one chunk is kept
+ * @retval NULL if allocation failed
+ */
+struct undo_history *undo_history_create(size_t memory_cap);
+void undo_history_destroy(struct undo_history *h);
+
+/**
+ * Append a record, the oldest records may be dropped to make room.
+ * @param  size Bytes of the record, rounded up to 8 with zeros
+ * @return Record to fill, NULL if allocation failed
+ */
+void *undo_history_push(struct undo_history *h, size_t size);
+
+/**
+ * @return Record with the id, NULL if it was dropped or not pushed yet
+ */
+void *undo_history_get(const struct undo_history *h, uint32_t id);
+
+/**
+ * @return Id of a record returned by the history
+ */
+static inline uint32_t undo_history_id(const void *record)
+{
+    return ((const uint32_t *)record)[-1];
+}
+
+/**
+ * @return Bytes of a record returned by the history, zero padding included
+ */
+static inline size_t undo_history_size(const void *record)
+{
+    return ((const uint32_t *)record)[-2] - 2 * sizeof(uint32_t);
+}
+
+/**
+ * @return True if the record with the id is still kept
+ */
+static inline int undo_history_has(const struct undo_history *h, uint32_t id)
+{
+    return id >= h->first_id && id < h->end_id;
+}
+
+/**
+ * @return Bytes of the chunks held, spare chunk included
+ */
+static inline size_t undo_history_bytes(const struct undo_history *h)
+{
+    return h->bytes_in_use;
+}
+
+#endif // UNDO_HISTORY_H
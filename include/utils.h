@@ -4,6 +4,7 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
 
 /* ---- MISC ---- */ 
 
@@ -24,6 +25,11 @@ void free2d(void **arr, size_t n_rows);
 
 void free_ptr_array(void **arr, size_t n);
 
+/**
+ * Microseconds between two CLOCK_MONOTONIC readings.
+ */
+double elapsed_us(struct timespec start, struct timespec end);
+
 /* ---- LOGGING ---- */
 
 enum log_level
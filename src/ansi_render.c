@@ -0,0 +1,553 @@
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <wchar.h>
+
+#include "ansi_render.h"
+#include "utils.h"
+
+// Attributes with an SGR code, others are not drawn
+#define ANSI_SGR_ATTRS \
+    (A_BOLD | A_DIM | A_UNDERLINE | A_BLINK | A_REVERSE | A_STANDOUT | A_INVIS)
+
+#define ANSI_MAX_SEQ_LEN 64
+
+// Unchanged cells looked at for a cheaper rewrite, a move is at most 10 bytes
+#define ANSI_MAX_GAP 10
+
+#define ANSI_ENTER "\x1b[?1049h\x1b[?25l"
+#define ANSI_LEAVE "\x1b(B\x1b[0m\x1b[?25h\x1b[?1049l"
+#define ANSI_CLEAR "\x1b[2J"
+
+static const struct
+{
+    attr_t attr;
+    int code;
+} sgr_codes[] =
+{
+    {A_BOLD, 1},
+    {A_DIM, 2},
+    {A_UNDERLINE, 4},
+    {A_BLINK, 5},
+    {A_REVERSE, 7},
+    {A_STANDOUT, 7},
+    {A_INVIS, 8},
+};
+
+#define N_SGR_CODES (int)(sizeof(sgr_codes) / sizeof(*sgr_codes))
+
+/* Function Prototypes */
+
+/**
+ * Add bytes to the output of the frame.
+ * @return 0 on success, -1 if out of memory
+ */
+int out_append(struct ansi_renderer *r, const char *data, size_t len);
+
+/**
+ * Write the output of the frame to the terminal.
+ * @return 0 on success, -1 on error
+ */
+int out_flush(struct ansi_renderer *r);
+
+/**
+ * Copy a row of the screen into the back buffer.
+ * @return Row differs from the one read by the last frame
+ */
+bool read_row(struct ansi_renderer *r, WINDOW *screen, int y, int n_cols);
+
+bool is_same_style(const struct ansi_cell *a, const struct ansi_cell *b);
+bool is_same_cell(const struct ansi_cell *a, const struct ansi_cell *b);
+
+/**
+ * Cursor move from its last position, the shortest of the absolute and
+ * relative moves.
+ * @return Length of the sequence, 0 if the cursor is already there
+ */
+int format_move(const struct ansi_renderer *r, struct pos to, char *seq);
+
+/**
+ * Switch from the terminal's style to the cell's.
+ * @return Length of the sequences, 0 if the style is the same
+ */
+int format_style(const struct ansi_renderer *r, const struct ansi_cell *cell,
+                 char *seq);
+int format_color(short color, bool is_bg, char *seq);
+
+/**
+ * @return Length of the glyph's bytes
+ */
+int format_char(const struct ansi_cell *cell, char *seq);
+
+/**
+ * Write a back buffer cell at the cursor, switching style if needed.
+ * @param  attr_changes Incremented if the style is switched
+ * @return 0 on success, -1 if out of memory
+ */
+int write_cell(struct ansi_renderer *r, struct pos cell, long *attr_changes);
+
+/**
+ * @return Unchanged cells from the cursor to the next changed cell of the
+ *         row, if writing them again costs less than a cursor move, else 0
+ */
+int get_gap_len(const struct ansi_renderer *r, int n_cols);
+
+/* Public */
+
+struct ansi_renderer *ansi_renderer_create(int fd, struct pos size)
+{
+    assert(fd >= 0);
+
+    struct ansi_renderer *r = calloc(1, sizeof(struct ansi_renderer));
+    ALLOC_CHECK_RETURN(r, NULL);
+    r->fd = fd;
+
+    // Sent together with the first clear
+    if (out_append(r, ANSI_ENTER, strlen(ANSI_ENTER)) != 0
+        || ansi_renderer_resize(r, size) != 0)
+    {
+        LOG(LOG_ERROR, "Failed to set up the terminal");
+        ansi_renderer_destroy(r);
+        return NULL;
+    }
+    return r;
+}
+
+int ansi_renderer_resize(struct ansi_renderer *r, struct pos size)
+{
+    assert(r != NULL);
+    assert(size.y > 0 && size.x > 0);
+
+    struct ansi_cell *front = malloc(size.y * size.x * sizeof(struct ansi_cell));
+    struct ansi_cell *back  = malloc(size.y * size.x * sizeof(struct ansi_cell));
+    // Matches no screen row, the first frame compares every cell
+    cchar_t *front_rows = calloc(size.y * size.x, sizeof(cchar_t));
+    // Wide character strings of ncurses are null terminated
+    cchar_t *row = malloc((size.x + 1) * sizeof(cchar_t));
+    if (front == NULL || back == NULL || front_rows == NULL || row == NULL)
+    {
+        LOG(LOG_ERROR, "Failed to allocate the cell buffers");
+        free(front);
+        free(back);
+        free(front_rows);
+        free(row);
+        return -1;
+    }
+
+    free(r->front);
+    free(r->back);
+    free(r->front_rows);
+    free(r->row);
+    r->front      = front;
+    r->back       = back;
+    r->front_rows = front_rows;
+    r->row        = row;
+    r->size       = size;
+
+    // Screen is cleared with the default pair
+    struct ansi_cell blank = {.ch = L' ', .attrs = A_NORMAL, .pair = 0};
+    for (int i = 0; i < size.y * size.x; i++)
+    {
+        r->front[i] = blank;
+    }
+
+    char seq[ANSI_MAX_SEQ_LEN];
+    r->style_known  = false;
+    r->cursor_known = false;
+    int len = format_style(r, &blank, seq);
+    if (out_append(r, seq, len) != 0
+        || out_append(r, ANSI_CLEAR, strlen(ANSI_CLEAR)) != 0
+        || out_flush(r) != 0)
+    {
+        return -1;
+    }
+    r->style       = blank;
+    r->style_known = true;
+    return 0;
+}
+
+void ansi_renderer_destroy(struct ansi_renderer *r)
+{
+    if (r == NULL)
+    {
+        return;
+    }
+
+    // Terminal was only set up once the buffers exist
+    if (r->front != NULL)
+    {
+        r->out_len = 0;
+        if (out_append(r, ANSI_LEAVE, strlen(ANSI_LEAVE)) == 0)
+        {
+            out_flush(r);
+        }
+    }
+
+    free(r->front);
+    free(r->back);
+    free(r->front_rows);
+    free(r->row);
+    free(r->out);
+    free(r);
+}
+
+long long ansi_render_frame(struct ansi_renderer *r, WINDOW *screen,
+                            long *cells_out, long *attr_changes_out)
+{
+    assert(r != NULL);
+    assert(screen != NULL);
+
+    struct pos screen_size;
+    getmaxyx(screen, screen_size.y, screen_size.x);
+    int n_rows = MIN(screen_size.y, r->size.y);
+    int n_cols = MIN(screen_size.x, r->size.x);
+
+    long cells        = 0;
+    long attr_changes = 0;
+    r->out_len = 0;
+
+    for (int y = 0; y < n_rows; y++)
+    {
+        if (!read_row(r, screen, y, n_cols))
+        {
+            continue;
+        }
+        struct ansi_cell *front = &r->front[y * r->size.x];
+        struct ansi_cell *back  = &r->back[y * r->size.x];
+
+        int x = 0;
+        while (x < n_cols)
+        {
+            if (is_same_cell(&front[x], &back[x]))
+            {
+                x++;
+                continue;
+            }
+
+            char seq[ANSI_MAX_SEQ_LEN];
+            int len = format_move(r, (struct pos){.y = y, .x = x}, seq);
+            if (out_append(r, seq, len) != 0)
+            {
+                return -1;
+            }
+
+            // Changed run, through gaps that are cheaper to write again
+            while (x < n_cols)
+            {
+                int n_cells = 1;
+                if (is_same_cell(&front[x], &back[x]))
+                {
+                    n_cells = get_gap_len(r, n_cols);
+                    if (n_cells == 0)
+                    {
+                        break;
+                    }
+                }
+                else
+                {
+                    front[x] = back[x];
+                    cells++;
+                }
+
+                for (int i = 0; i < n_cells; i++, x++)
+                {
+                    struct pos cell = {.y = y, .x = x};
+                    if (write_cell(r, cell, &attr_changes) != 0)
+                    {
+                        return -1;
+                    }
+                }
+            }
+        }
+    }
+
+    long long bytes = r->out_len;
+    if (out_flush(r) != 0)
+    {
+        return -1;
+    }
+
+    *cells_out        = cells;
+    *attr_changes_out = attr_changes;
+    return bytes;
+}
+
+/* Private */
+
+int out_append(struct ansi_renderer *r, const char *data, size_t len)
+{
+    if (r->out_len + len > r->out_cap)
+    {
+        size_t cap = MAX(r->out_cap * 2, r->out_len + len);
+        cap = MAX(cap, 4096);
+        char *out = realloc(r->out, cap);
+        ALLOC_CHECK_RETURN(out, -1);
+        r->out     = out;
+        r->out_cap = cap;
+    }
+
+    memcpy(r->out + r->out_len, data, len);
+    r->out_len += len;
+    return 0;
+}
+
+int out_flush(struct ansi_renderer *r)
+{
+    size_t written = 0;
+    while (written < r->out_len)
+    {
+        ssize_t len = write(r->fd, r->out + written, r->out_len - written);
+        if (len < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (len <= 0)
+        {
+            LOGF(LOG_ERROR, "Failed to write the frame: %s", strerror(errno));
+            r->out_len = 0;
+            return -1;
+        }
+        written += len;
+    }
+
+    r->out_len = 0;
+    return 0;
+}
+
+bool read_row(struct ansi_renderer *r, WINDOW *screen, int y, int n_cols)
+{
+    mvwin_wchnstr(screen, y, 0, r->row, n_cols);
+
+    // Same bytes are the same cells, decoding every cell costs more
+    cchar_t *front_row = &r->front_rows[y * r->size.x];
+    if (memcmp(front_row, r->row, n_cols * sizeof(cchar_t)) == 0)
+    {
+        return false;
+    }
+    memcpy(front_row, r->row, n_cols * sizeof(cchar_t));
+
+    struct ansi_cell *back = &r->back[y * r->size.x];
+    for (int x = 0; x < n_cols; x++)
+    {
+        wchar_t wch[CCHARW_MAX];
+        getcchar(&r->row[x], wch, &back[x].attrs, &back[x].pair, NULL);
+        back[x].ch = wch[0];
+    }
+    return true;
+}
+
+bool is_same_style(const struct ansi_cell *a, const struct ansi_cell *b)
+{
+    return a->attrs == b->attrs && a->pair == b->pair;
+}
+
+bool is_same_cell(const struct ansi_cell *a, const struct ansi_cell *b)
+{
+    return a->ch == b->ch && is_same_style(a, b);
+}
+
+int format_move(const struct ansi_renderer *r, struct pos to, char *seq)
+{
+    if (r->cursor_known && r->cursor.y == to.y && r->cursor.x == to.x)
+    {
+        return 0;
+    }
+
+    // Absolute, row and column are 1-based and default to 1
+    int len;
+    if (to.x == 0)
+    {
+        len = (to.y == 0) ? sprintf(seq, "\x1b[H")
+                          : sprintf(seq, "\x1b[%dH", to.y + 1);
+    }
+    else
+    {
+        len = sprintf(seq, "\x1b[%d;%dH", to.y + 1, to.x + 1);
+    }
+
+    if (!r->cursor_known)
+    {
+        return len;
+    }
+
+    char rel[ANSI_MAX_SEQ_LEN];
+    int rel_len = INT_MAX;
+    if (to.y == r->cursor.y)
+    {
+        int dx = to.x - r->cursor.x;
+        char dir = (dx > 0) ? 'C' : 'D';
+        dx = abs(dx);
+        rel_len = (dx == 1) ? sprintf(rel, "\x1b[%c", dir)
+                            : sprintf(rel, "\x1b[%d%c", dx, dir);
+    }
+    else if (to.y == r->cursor.y + 1 && to.x == 0)
+    {
+        rel_len = sprintf(rel, "\r\n");
+    }
+
+    if (rel_len < len)
+    {
+        memcpy(seq, rel, rel_len);
+        len = rel_len;
+    }
+    return len;
+}
+
+int format_style(const struct ansi_renderer *r, const struct ansi_cell *cell,
+                 char *seq)
+{
+    int len = 0;
+
+    bool acs      = (cell->attrs & A_ALTCHARSET) != 0;
+    bool prev_acs = (r->style.attrs & A_ALTCHARSET) != 0;
+    if (!r->style_known || acs != prev_acs)
+    {
+        // DEC line drawing set
+        len += sprintf(seq + len, acs ? "\x1b(0" : "\x1b(B");
+    }
+
+    attr_t sgr      = cell->attrs & ANSI_SGR_ATTRS;
+    attr_t prev_sgr = r->style.attrs & ANSI_SGR_ATTRS;
+    short fg, bg, prev_fg, prev_bg;
+    pair_content(cell->pair, &fg, &bg);
+    pair_content(r->style.pair, &prev_fg, &prev_bg);
+
+    // Attributes can only be turned off all together
+    bool reset   = !r->style_known || (prev_sgr & ~sgr) != 0;
+    attr_t added = reset ? sgr : sgr & ~prev_sgr;
+    bool set_fg  = reset ? fg >= 0 : fg != prev_fg;
+    bool set_bg  = reset ? bg >= 0 : bg != prev_bg;
+    if (!reset && added == 0 && !set_fg && !set_bg)
+    {
+        return len;
+    }
+
+    len += sprintf(seq + len, "\x1b[");
+    int n_params = 0;
+    if (reset)
+    {
+        len += sprintf(seq + len, "0");
+        n_params++;
+    }
+    for (int i = 0; i < N_SGR_CODES; i++)
+    {
+        if (added & sgr_codes[i].attr)
+        {
+            len += sprintf(seq + len, n_params++ ? ";%d" : "%d",
+                           sgr_codes[i].code);
+        }
+    }
+    if (set_fg)
+    {
+        len += sprintf(seq + len, n_params++ ? ";" : "");
+        len += format_color(fg, false, seq + len);
+    }
+    if (set_bg)
+    {
+        len += sprintf(seq + len, n_params++ ? ";" : "");
+        len += format_color(bg, true, seq + len);
+    }
+    len += sprintf(seq + len, "m");
+    return len;
+}
+
+int format_color(short color, bool is_bg, char *seq)
+{
+    int base = is_bg ? 40 : 30;
+    if (color < 0)
+    {
+        return sprintf(seq, "%d", base + 9);
+    }
+    if (color < 8)
+    {
+        return sprintf(seq, "%d", base + color);
+    }
+    if (color < 16)
+    {
+        // Bright colors
+        return sprintf(seq, "%d", base + 60 + color - 8);
+    }
+    return sprintf(seq, "%d;5;%d", base + 8, color);
+}
+
+int format_char(const struct ansi_cell *cell, char *seq)
+{
+    wchar_t ch = cell->ch;
+    if (ch < 0x80)
+    {
+        seq[0] = (ch < ' ' || ch == 0x7f) ? ' ' : (char)ch;
+        return 1;
+    }
+
+    mbstate_t state;
+    memset(&state, 0, sizeof(state));
+    size_t len = wcrtomb(seq, ch, &state);
+    if (len == (size_t)-1)
+    {
+        seq[0] = '?';
+        return 1;
+    }
+    return len;
+}
+
+int write_cell(struct ansi_renderer *r, struct pos cell, long *attr_changes)
+{
+    const struct ansi_cell *back = &r->back[cell.y * r->size.x + cell.x];
+
+    char seq[ANSI_MAX_SEQ_LEN + MB_LEN_MAX];
+    int len = format_style(r, back, seq);
+    if (len > 0)
+    {
+        (*attr_changes)++;
+    }
+    len += format_char(back, seq + len);
+    if (out_append(r, seq, len) != 0)
+    {
+        return -1;
+    }
+
+    r->style       = *back;
+    r->style_known = true;
+
+    // Writing the last column leaves the terminal waiting to wrap
+    r->cursor_known = cell.x + 1 < r->size.x;
+    r->cursor.y     = cell.y;
+    r->cursor.x     = cell.x + 1;
+    return 0;
+}
+
+int get_gap_len(const struct ansi_renderer *r, int n_cols)
+{
+    if (!r->cursor_known)
+    {
+        return 0;
+    }
+
+    struct pos from = r->cursor;
+    const struct ansi_cell *front = &r->front[from.y * r->size.x];
+    const struct ansi_cell *back  = &r->back[from.y * r->size.x];
+
+    int rewrite_len = 0;
+    int end = MIN(n_cols, from.x + ANSI_MAX_GAP);
+    for (int x = from.x; x < end; x++)
+    {
+        if (!is_same_cell(&front[x], &back[x]))
+        {
+            char seq[ANSI_MAX_SEQ_LEN];
+            struct pos to = {.y = from.y, .x = x};
+            return (rewrite_len <= format_move(r, to, seq)) ? x - from.x : 0;
+        }
+
+        // Only cells drawn in the current style are free of switches
+        if (!is_same_style(&back[x], &r->style))
+        {
+            return 0;
+        }
+        char seq[MB_LEN_MAX];
+        rewrite_len += format_char(&back[x], seq);
+    }
+    return 0;
+}
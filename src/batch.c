@@ -0,0 +1,323 @@
+#include "batch.h"
+#include "loader.h"
+#include "puzzle.h"
+#include "solver.h"
+#include "utils.h"
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+const struct batch_config batch_config_default =
+{
+    .n_threads   = 0,
+    .max_guesses = 0,
+};
+
+enum batch_status
+{
+    BATCH_UNIQUE,
+    BATCH_MULTIPLE,
+    BATCH_UNSOLVABLE,
+    BATCH_INVALID_CLUES,
+    BATCH_GAVE_UP,
+    BATCH_ERROR,
+    BATCH_N_STATUS
+};
+
+static const char *batch_status_str[BATCH_N_STATUS] =
+{
+    [BATCH_UNIQUE]        = "unique",
+    [BATCH_MULTIPLE]      = "multiple",
+    [BATCH_UNSOLVABLE]    = "unsolvable",
+    [BATCH_INVALID_CLUES] = "invalid_clues",
+    [BATCH_GAVE_UP]       = "gave_up",
+    [BATCH_ERROR]         = "error",
+};
+
+struct batch_job
+{
+    const struct puzzle *puzzle;
+    const char *file_name;
+    int pz_idx;
+
+    enum batch_status status;
+    int n_solutions;
+    bool line_solvable; // Solved by propagation alone
+    double solve_us;
+    struct solver_stats stats;
+};
+
+struct batch_pool
+{
+    struct batch_job *jobs;
+    int n_jobs;
+    int next_job;
+    long max_guesses;
+    pthread_mutex_t lock;
+};
+
+/* Function prototypes */
+
+void *batch_worker(void *arg);
+void batch_solve(struct batch_job *job, long max_guesses);
+
+struct batch_job *batch_next_job(struct batch_pool *pool);
+void batch_print_job(const struct batch_job *job, FILE *out);
+void batch_print_load_error(const char *file_name, FILE *out);
+
+
+/* Public */
+
+int batch_validate(const char *dir_name, struct batch_config config, FILE *out)
+{
+    assert(dir_name != NULL);
+    assert(out != NULL);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    int n_files;
+    char **file_names = list_puzzle_set_files(dir_name, &n_files);
+    if (file_names == NULL)
+    {
+        fprintf(stderr, "Failed to read directory: %s\n", dir_name);
+        return -1;
+    }
+
+    struct puzzle_set **psets = calloc(n_files, sizeof(*psets));
+    ALLOC_CHECK_EXIT(psets);
+
+    int n_jobs = 0;
+    for (int i = 0; i < n_files; i++)
+    {
+        psets[i] = puzzle_set_create(file_names[i], LOAD_ALL);
+        if (psets[i] != NULL)
+        {
+            n_jobs += psets[i]->num_puzzles;
+        }
+    }
+
+    struct batch_pool pool =
+    {
+        .jobs        = calloc(MAX(n_jobs, 1), sizeof(struct batch_job)),
+        .n_jobs      = n_jobs,
+        .next_job    = 0,
+        .max_guesses = config.max_guesses,
+    };
+    ALLOC_CHECK_EXIT(pool.jobs);
+    pthread_mutex_init(&pool.lock, NULL);
+
+    int job_idx = 0;
+    for (int i = 0; i < n_files; i++)
+    {
+        for (int j = 0; psets[i] != NULL && j < psets[i]->num_puzzles; j++)
+        {
+            pool.jobs[job_idx++] = (struct batch_job)
+            {
+                .puzzle    = psets[i]->puzzles[j],
+                .file_name = file_names[i],
+                .pz_idx    = j,
+            };
+        }
+    }
+
+    int n_threads = config.n_threads;
+    if (n_threads <= 0)
+    {
+        n_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    n_threads = MAX(1, MIN(n_threads, n_jobs));
+
+    pthread_t threads[n_threads];
+    int n_started = 0;
+    for (; n_started < n_threads; n_started++)
+    {
+        if (pthread_create(&threads[n_started], NULL, batch_worker, &pool) != 0)
+        {
+            LOG(LOG_WARNING, "Failed to start worker thread");
+            break;
+        }
+    }
+    if (n_started == 0)
+    {
+        // Run on the calling thread instead
+        batch_worker(&pool);
+    }
+    for (int i = 0; i < n_started; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_mutex_destroy(&pool.lock);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    // Output in file/puzzle order regardless of completion order
+    int status_cnt[BATCH_N_STATUS] = {0};
+    int n_load_errors = 0;
+    job_idx = 0;
+    for (int i = 0; i < n_files; i++)
+    {
+        if (psets[i] == NULL)
+        {
+            batch_print_load_error(file_names[i], out);
+            n_load_errors++;
+            continue;
+        }
+        for (int j = 0; j < psets[i]->num_puzzles; j++)
+        {
+            batch_print_job(&pool.jobs[job_idx], out);
+            status_cnt[pool.jobs[job_idx].status]++;
+            job_idx++;
+        }
+    }
+
+    fprintf(stderr, "Checked %d puzzles in %d files (%d not loadable) "
+                    "with %d threads in %.1f ms:",
+            n_jobs, n_files, n_load_errors, MAX(n_started, 1),
+            elapsed_us(start, end) / 1000.0);
+    for (int i = 0; i < BATCH_N_STATUS; i++)
+    {
+        fprintf(stderr, " %s=%d", batch_status_str[i], status_cnt[i]);
+    }
+    fprintf(stderr, "\n");
+
+    for (int i = 0; i < n_files; i++)
+    {
+        puzzle_set_destroy(psets[i]);
+    }
+    free(psets);
+    free(pool.jobs);
+    free_ptr_array((void **) file_names, n_files);
+
+    bool all_unique = n_load_errors == 0 && status_cnt[BATCH_UNIQUE] == n_jobs;
+    return all_unique ? 0 : 1;
+}
+
+/* Private */
+
+void *batch_worker(void *arg)
+{
+    struct batch_pool *pool = arg;
+    struct batch_job *job;
+    while ((job = batch_next_job(pool)) != NULL)
+    {
+        batch_solve(job, pool->max_guesses);
+    }
+    return NULL;
+}
+
+struct batch_job *batch_next_job(struct batch_pool *pool)
+{
+    struct batch_job *job = NULL;
+
+    pthread_mutex_lock(&pool->lock);
+    if (pool->next_job < pool->n_jobs)
+    {
+        job = &pool->jobs[pool->next_job++];
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return job;
+}
+
+void batch_solve(struct batch_job *job, long max_guesses)
+{
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    if (!is_valid_clues(job->puzzle))
+    {
+        job->status = BATCH_INVALID_CLUES;
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        job->solve_us = elapsed_us(start, end);
+        return;
+    }
+
+    struct solver *solver = solver_create(job->puzzle);
+    if (solver == NULL)
+    {
+        job->status = BATCH_ERROR;
+        return;
+    }
+    solver->max_guesses = max_guesses;
+
+    enum solve_status status = solver_propagate(solver);
+    job->line_solvable = status == SOLVE_SOLVED;
+    if (status == SOLVE_CONTRADICTION)
+    {
+        // The grid is inconsistent, a search from it would be meaningless
+        job->n_solutions = 0;
+    }
+    else
+    {
+        solver_reset(solver);
+        job->n_solutions = solver_count_solutions(solver, 2, NULL);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    job->solve_us = elapsed_us(start, end);
+    job->stats    = solver->stats;
+
+    if (solver->gave_up)
+    {
+        job->status = BATCH_GAVE_UP;
+    }
+    else
+    {
+        switch (job->n_solutions)
+        {
+            case 0:  job->status = BATCH_UNSOLVABLE; break;
+            case 1:  job->status = BATCH_UNIQUE;     break;
+            case 2:  job->status = BATCH_MULTIPLE;   break;
+            default: job->status = BATCH_ERROR;      break;
+        }
+    }
+
+    solver_destroy(solver);
+}
+
+void batch_print_job(const struct batch_job *job, FILE *out)
+{
+    cJSON *json = cJSON_CreateObject();
+    ALLOC_CHECK_EXIT(json);
+
+    const struct puzzle *pz = job->puzzle;
+    cJSON_AddStringToObject(json, "file",          job->file_name);
+    cJSON_AddNumberToObject(json, "puzzle",        job->pz_idx);
+    cJSON_AddStringToObject(json, "title",         pz->title);
+    cJSON_AddNumberToObject(json, "rows",          pz->n_rows);
+    cJSON_AddNumberToObject(json, "cols",          pz->n_cols);
+    cJSON_AddStringToObject(json, "status",        batch_status_str[job->status]);
+    cJSON_AddBoolToObject  (json, "solvable",      job->n_solutions > 0);
+    cJSON_AddBoolToObject  (json, "unique",        job->status == BATCH_UNIQUE);
+    cJSON_AddBoolToObject  (json, "line_solvable", job->line_solvable);
+    cJSON_AddNumberToObject(json, "time_us",       job->solve_us);
+    cJSON_AddNumberToObject(json, "line_solves",   job->stats.n_line_solves);
+    cJSON_AddNumberToObject(json, "cells_fixed",   job->stats.n_cells_fixed);
+    cJSON_AddNumberToObject(json, "guesses",       job->stats.n_guesses);
+    cJSON_AddNumberToObject(json, "max_depth",     job->stats.max_depth);
+
+    char *line = cJSON_PrintUnformatted(json);
+    ALLOC_CHECK_EXIT(line);
+    fprintf(out, "%s\n", line);
+
+    cJSON_free(line);
+    cJSON_Delete(json);
+}
+
+void batch_print_load_error(const char *file_name, FILE *out)
+{
+    cJSON *json = cJSON_CreateObject();
+    ALLOC_CHECK_EXIT(json);
+
+    cJSON_AddStringToObject(json, "file",   file_name);
+    cJSON_AddStringToObject(json, "status", "load_error");
+
+    char *line = cJSON_PrintUnformatted(json);
+    ALLOC_CHECK_EXIT(line);
+    fprintf(out, "%s\n", line);
+
+    cJSON_free(line);
+    cJSON_Delete(json);
+}
@@ -0,0 +1,897 @@
+#include <string.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "capture_set.h"
+#include "catalog.h"
+#include "config.h"
+#include "game_control.h"
+#include "game_core.h"
+#include "game_ui.h"
+#include "loader.h"
+#include "tui.h"
+#include "utils.h"
+
+static const int bench_scan_sizes[] = {10, 100, 1000, 10000};
+
+#define BENCH_N_SCAN_SIZES \
+    (int)(sizeof(bench_scan_sizes) / sizeof(*bench_scan_sizes))
+
+static const int bench_burst_sizes[] = {1, 10, 30, 100};
+
+#define BENCH_N_BURST_SIZES \
+    (int)(sizeof(bench_burst_sizes) / sizeof(*bench_burst_sizes))
+
+// Cursor movement and cell edit
+static const char bench_burst_keys[] = {'j', 'f'};
+
+#define BENCH_N_BURST_KEYS (int)sizeof(bench_burst_keys)
+
+#define BENCH_TERM "xterm-256color"
+#define BENCH_SCREEN_ROWS 250
+#define BENCH_SCREEN_COLS 500
+
+// Terminal sizes of a drag-resize, from small to full size and back
+#define BENCH_N_RESIZES       100
+#define BENCH_RESIZE_MIN_ROWS 24
+#define BENCH_RESIZE_MIN_COLS 80
+#define BENCH_RESIZE_STEP     4
+
+// Board operations pushed on the undo history, then all undone and redone
+enum bench_undo_op
+{
+    BENCH_UNDO_CELL,  // Toggle a cell
+    BENCH_UNDO_AREA,  // Set a rectangle to a state
+    BENCH_UNDO_CLEAR, // Fill the board, then clear it
+    BENCH_N_UNDO_OPS
+};
+
+static const char *bench_undo_op_names[BENCH_N_UNDO_OPS] =
+{
+    [BENCH_UNDO_CELL]  = "cell",
+    [BENCH_UNDO_AREA]  = "area",
+    [BENCH_UNDO_CLEAR] = "clear",
+};
+
+static const int bench_undo_n_ops[BENCH_N_UNDO_OPS] =
+{
+    [BENCH_UNDO_CELL]  = 100000,
+    [BENCH_UNDO_AREA]  = 10000,
+    [BENCH_UNDO_CLEAR] = 1000,
+};
+
+#define BENCH_UNDO_N_GOTOS 1000 // Jumps to random moves of the history
+
+// Cells toggled between two captures, 0 for every cell of the board
+static const int bench_capture_changes[] = {1, 10, 100, 0};
+
+#define BENCH_N_CAPTURE_CHANGES \
+    (int)(sizeof(bench_capture_changes) / sizeof(bench_capture_changes[0]))
+#define BENCH_CAPTURE_N_RESTORES 1000
+
+#define SNAPSHOT_SCREEN_ROWS 60
+#define SNAPSHOT_SCREEN_COLS 160
+
+struct bench_script
+{
+    const char *name;
+    const char *keys;
+};
+
+static const struct bench_script bench_render_scripts[] =
+{
+    {"move",   "lllllljjjjjjhhhhhhkkkkkk"},
+    {"fill",   "flflflflfljfhfhfhfhfhf"},
+    {"select", "vllllljjjjjhhhhhkkkkkv"},
+};
+
+#define BENCH_N_RENDER_SCRIPTS \
+    (int)(sizeof(bench_render_scripts) / sizeof(*bench_render_scripts))
+
+static const char *renderer_names[] =
+{
+    [RENDERER_NCURSES] = "ncurses",
+    [RENDERER_ANSI]    = "ansi",
+};
+
+#define BENCH_N_RENDERERS \
+    (int)(sizeof(renderer_names) / sizeof(*renderer_names))
+
+static const char *cell_mode_names[CELL_MODE_N] =
+{
+    [CELL_MODE_BOXED]      = "boxed",
+    [CELL_MODE_COMPACT]    = "compact",
+    [CELL_MODE_HALF_BLOCK] = "half-block",
+};
+
+/**
+ * Keys written one per displayed frame, frames caused by the first
+ * n_skipped keys are not counted.
+ */
+struct bench_replay
+{
+    const char *keys;
+    int n_keys;
+    int n_skipped;
+    int next_key;
+    int key_fd;
+
+    long n_frames;
+    long n_counted;
+    long long cells;
+    long long attr_changes;
+    long long bytes;
+    long long us;
+};
+
+/* Function Prototypes */
+
+/**
+ * Fill a new directory with n_files copies of a file.
+ * @return Directory path. NULL if error
+ */
+char *bench_dir_create(const char *tmp_dir, const char *content, int n_files);
+void bench_dir_destroy(char *dir_name, int n_files);
+
+/**
+ * @return Milliseconds taken by catalog_load(), -1 if it failed
+ */
+double bench_catalog_load(const char *dir_name, const char *index_file_name,
+                          int n_threads);
+
+/**
+ * Play the puzzle with the burst of keys queued as input, then end of input.
+ * @param  frames_out Frames displayed
+ * @return Milliseconds taken, -1 if the screen could not be created
+ */
+double bench_play_burst(const struct puzzle *pz, char key, int n_keys,
+                        long *frames_out);
+
+/**
+ * Play the puzzle, feeding the next key of the replay after each frame.
+ *  - The screen is left open for the caller, end_headless_screen().
+ * @return 0 on success, -1 if the screen could not be created
+ */
+int bench_replay_play(const struct puzzle *pz, struct bench_replay *replay,
+                      struct pos screen_size);
+
+/**
+ * Frame hook: count the frame, then write the next key or close the input.
+ */
+void bench_replay_frame(void *arg);
+
+/**
+ * Resize the headless screen BENCH_N_RESIZES times, laying the puzzle out
+ * and drawing it after each resize.
+ * @param  us_out, max_us_out, bytes_out Totals of the relayouts
+ * @return 0 on success, -1 if the screen could not be created or the cell
+ *         mode is not supported
+ */
+int bench_resize_mode(const struct puzzle *pz, enum cell_mode mode,
+                      long long *us_out, long long *max_us_out,
+                      long long *bytes_out);
+
+/**
+ * Run the i-th operation of the kind on the board, seed picks the cells.
+ */
+void bench_undo_run_op(struct game_state *gs, enum bench_undo_op op, int i,
+                       uint32_t *seed);
+
+/**
+ * @return Next xorshift32 number, the seed must not be 0
+ */
+uint32_t bench_rand(uint32_t *seed);
+
+/**
+ * @return Keys switching the command menu's cell mode, from boxed
+ */
+int get_cell_mode_keys(enum cell_mode mode, char *keys, int max_keys);
+
+/**
+ * @return First puzzle of the set, NULL if the set could not be loaded
+ */
+struct puzzle_set *bench_load_set(const char *set_file_name);
+
+/* Public */
+
+int bench_scan(const char *set_file_name, const char *tmp_dir, FILE *out)
+{
+    assert(set_file_name != NULL);
+    assert(tmp_dir != NULL);
+    assert(out != NULL);
+
+    char *content = load_file(set_file_name);
+    if (content == NULL)
+    {
+        fprintf(stderr, "Failed to read: %s\n", set_file_name);
+        return -1;
+    }
+
+    fprintf(out, "%8s %14s %14s %14s\n",
+            "files", "cold_1t_ms", "cold_mt_ms", "warm_mt_ms");
+
+    int ret = 0;
+    for (int i = 0; i < BENCH_N_SCAN_SIZES && ret == 0; i++)
+    {
+        int n_files = bench_scan_sizes[i];
+        char *dir_name = bench_dir_create(tmp_dir, content, n_files);
+        if (dir_name == NULL)
+        {
+            fprintf(stderr, "Failed to create %d files in %s\n",
+                    n_files, tmp_dir);
+            ret = -1;
+            break;
+        }
+
+        int index_len = strlen(dir_name) + sizeof("/catalog.dat");
+        char index_file_name[index_len];
+        snprintf(index_file_name, index_len, "%s/catalog.dat", dir_name);
+
+        double cold_1t = bench_catalog_load(dir_name, index_file_name, 1);
+        remove(index_file_name);
+        double cold_mt = bench_catalog_load(dir_name, index_file_name, 0);
+        double warm_mt = bench_catalog_load(dir_name, index_file_name, 0);
+        remove(index_file_name);
+
+        if (cold_1t < 0 || cold_mt < 0 || warm_mt < 0)
+        {
+            ret = -1;
+        }
+        fprintf(out, "%8d %14.2f %14.2f %14.2f\n",
+                n_files, cold_1t, cold_mt, warm_mt);
+
+        bench_dir_destroy(dir_name, n_files);
+    }
+
+    free(content);
+    return ret;
+}
+
+int bench_input(const char *set_file_name, FILE *out)
+{
+    assert(set_file_name != NULL);
+    assert(out != NULL);
+
+    struct puzzle_set *pset = bench_load_set(set_file_name);
+    if (pset == NULL)
+    {
+        return -1;
+    }
+    const struct puzzle *pz = pset->puzzles[0];
+
+    fprintf(out, "puzzle: %s (%dx%d)\n", pz->title, pz->n_rows, pz->n_cols);
+    fprintf(out, "%4s %8s %8s %16s %10s\n",
+            "key", "keys", "frames", "frames_per_key", "ms");
+
+    int ret = 0;
+    for (int k = 0; k < BENCH_N_BURST_KEYS && ret == 0; k++)
+    {
+        for (int i = 0; i < BENCH_N_BURST_SIZES; i++)
+        {
+            int n_keys = bench_burst_sizes[i];
+            long n_frames;
+            double ms = bench_play_burst(pz, bench_burst_keys[k], n_keys,
+                                         &n_frames);
+            if (ms < 0)
+            {
+                ret = -1;
+                break;
+            }
+
+            // First frame is drawn before any key
+            long burst_frames = n_frames - 1;
+            fprintf(out, "%4c %8d %8ld %16.3f %10.2f\n",
+                    bench_burst_keys[k], n_keys, burst_frames,
+                    (double)burst_frames / n_keys, ms);
+        }
+    }
+
+    puzzle_set_destroy(pset);
+    return ret;
+}
+
+int bench_render(const char *set_file_name, FILE *out)
+{
+    assert(set_file_name != NULL);
+    assert(out != NULL);
+
+    struct puzzle_set *pset = bench_load_set(set_file_name);
+    if (pset == NULL)
+    {
+        return -1;
+    }
+    const struct puzzle *pz = pset->puzzles[0];
+
+    fprintf(out, "puzzle: %s (%dx%d)\n", pz->title, pz->n_rows, pz->n_cols);
+    fprintf(out, "%8s %10s %8s %8s %12s %12s %12s %10s\n",
+            "renderer", "mode", "script", "frames", "cells/frame",
+            "attrs/frame", "bytes/frame", "us/frame");
+
+    int ret = 0;
+    for (int k = 0; k < BENCH_N_RENDERERS * CELL_MODE_N && ret == 0; k++)
+    {
+        // Renderers side by side for each mode
+        int m = k / BENCH_N_RENDERERS;
+        int renderer = k % BENCH_N_RENDERERS;
+        set_frame_renderer(renderer);
+
+        for (int i = 0; i < BENCH_N_RENDER_SCRIPTS; i++)
+        {
+            const struct bench_script *script = &bench_render_scripts[i];
+
+            // Mode switch first, its frames are not counted
+            char keys[128];
+            int n_mode_keys = get_cell_mode_keys(m, keys, sizeof(keys));
+            int n_keys      = n_mode_keys + strlen(script->keys);
+            assert(n_keys <= (int)sizeof(keys));
+            memcpy(keys + n_mode_keys, script->keys, strlen(script->keys));
+
+            struct bench_replay replay =
+            {
+                .keys      = keys,
+                .n_keys    = n_keys,
+                .n_skipped = n_mode_keys,
+            };
+            struct pos size = {.y = BENCH_SCREEN_ROWS, .x = BENCH_SCREEN_COLS};
+            if (bench_replay_play(pz, &replay, size) != 0)
+            {
+                ret = -1;
+                break;
+            }
+            end_headless_screen();
+
+            if (m == CELL_MODE_HALF_BLOCK && !has_unicode())
+            {
+                fprintf(out, "%8s %10s %8s  (needs a UTF-8 locale)\n",
+                        renderer_names[renderer], cell_mode_names[m],
+                        script->name);
+                continue;
+            }
+
+            long n = MAX(replay.n_counted, 1);
+            fprintf(out, "%8s %10s %8s %8ld %12.1f %12.1f %12.1f %10.1f\n",
+                    renderer_names[renderer], cell_mode_names[m],
+                    script->name, replay.n_counted,
+                    (double)replay.cells / n, (double)replay.attr_changes / n,
+                    (double)replay.bytes / n, (double)replay.us / n);
+        }
+    }
+    set_frame_renderer(RENDERER_NCURSES);
+
+    puzzle_set_destroy(pset);
+    return ret;
+}
+
+int bench_resize(const char *set_file_name, FILE *out)
+{
+    assert(set_file_name != NULL);
+    assert(out != NULL);
+
+    struct puzzle_set *pset = bench_load_set(set_file_name);
+    if (pset == NULL)
+    {
+        return -1;
+    }
+    const struct puzzle *pz = pset->puzzles[0];
+
+    fprintf(out, "puzzle: %s (%dx%d)\n", pz->title, pz->n_rows, pz->n_cols);
+    fprintf(out, "%8s %10s %8s %10s %10s %14s\n",
+            "renderer", "mode", "resizes", "us/resize", "max_us",
+            "bytes/resize");
+
+    for (int k = 0; k < BENCH_N_RENDERERS * CELL_MODE_N; k++)
+    {
+        int m = k / BENCH_N_RENDERERS;
+        int renderer = k % BENCH_N_RENDERERS;
+        set_frame_renderer(renderer);
+
+        long long us, max_us, bytes;
+        if (bench_resize_mode(pz, m, &us, &max_us, &bytes) != 0)
+        {
+            fprintf(out, "%8s %10s  (not supported)\n",
+                    renderer_names[renderer], cell_mode_names[m]);
+            continue;
+        }
+        fprintf(out, "%8s %10s %8d %10.1f %10lld %14.1f\n",
+                renderer_names[renderer], cell_mode_names[m], BENCH_N_RESIZES,
+                (double)us / BENCH_N_RESIZES, max_us,
+                (double)bytes / BENCH_N_RESIZES);
+    }
+    set_frame_renderer(RENDERER_NCURSES);
+
+    puzzle_set_destroy(pset);
+    return 0;
+}
+
+int bench_undo(const char *set_file_name, FILE *out)
+{
+    assert(set_file_name != NULL);
+    assert(out != NULL);
+
+    struct puzzle_set *pset = bench_load_set(set_file_name);
+    if (pset == NULL)
+    {
+        return -1;
+    }
+    const struct puzzle *pz = pset->puzzles[0];
+
+    fprintf(out, "puzzle: %s (%dx%d)\n", pz->title, pz->n_rows, pz->n_cols);
+    fprintf(out, "%6s %8s %8s %10s %10s %10s %10s %8s %10s\n",
+            "op", "ops", "kept", "push_ns", "undo_ns", "redo_ns", 
+            "goto_ns", "replay", "KiB");
+
+    for (int op = 0; op < BENCH_N_UNDO_OPS; op++)
+    {
+        struct game_state *gs = game_state_create(pz);
+        int n_ops = bench_undo_n_ops[op];
+        uint32_t seed = 1;
+
+        struct timespec start, pushed, undone, redone, jumped;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int i = 0; i < n_ops; i++)
+        {
+            bench_undo_run_op(gs, op, i, &seed);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &pushed);
+
+        size_t bytes = undo_bytes_in_use(gs);
+        long n_kept = 0;
+        while (undo(gs))
+        {
+            n_kept++;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &undone);
+        while (redo(gs))
+            ;
+        clock_gettime(CLOCK_MONOTONIC, &redone);
+
+        // Any kept move, the moves replayed after the snapshot are counted
+        uint32_t last_move = undo_current_move(gs);
+        long n_replayed = 0;
+        for (int i = 0; i < BENCH_UNDO_N_GOTOS; i++)
+        {
+            uint32_t move = last_move - bench_rand(&seed) % (n_kept + 1);
+            int replayed  = undo_goto(gs, move);
+            n_replayed   += MAX(replayed, 0);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &jumped);
+
+        long n = MAX(n_kept, 1);
+        fprintf(out, "%6s %8d %8ld %10.1f %10.1f %10.1f %10.1f %8.1f %10.1f\n",
+                bench_undo_op_names[op], n_ops, n_kept,
+                elapsed_us(start, pushed) * 1000.0 / n_ops,
+                elapsed_us(pushed, undone) * 1000.0 / n,
+                elapsed_us(undone, redone) * 1000.0 / n,
+                elapsed_us(redone, jumped) * 1000.0 / BENCH_UNDO_N_GOTOS,
+                (double)n_replayed / BENCH_UNDO_N_GOTOS,
+                bytes / 1024.0);
+        game_state_destroy(gs);
+    }
+
+    puzzle_set_destroy(pset);
+    return 0;
+}
+
+int bench_capture(const char *set_file_name, FILE *out)
+{
+    assert(set_file_name != NULL);
+    assert(out != NULL);
+
+    struct puzzle_set *pset = bench_load_set(set_file_name);
+    if (pset == NULL)
+    {
+        return -1;
+    }
+    const struct puzzle *pz = pset->puzzles[0];
+    int n_cells = pz->n_rows * pz->n_cols;
+
+    fprintf(out, "puzzle: %s (%dx%d)\n", pz->title, pz->n_rows, pz->n_cols);
+    fprintf(out, "%8s %8s %10s %10s %10s %10s\n",
+            "changed", "slots", "store_ns", "restore_ns", "KiB", "copy_KiB");
+
+    for (int c = 0; c < BENCH_N_CAPTURE_CHANGES; c++)
+    {
+        struct game_state *gs = game_state_create(pz);
+        int n_changed = bench_capture_changes[c] ? bench_capture_changes[c]
+                                                 : n_cells;
+        uint32_t seed = 1;
+
+        // A third of the board filled, then a branch of changes per capture
+        for (int i = 0; i < n_cells / 3; i++)
+        {
+            struct cell cell = {bench_rand(&seed) % pz->n_rows, 
+                                bench_rand(&seed) % pz->n_cols};
+            set_cell_state(gs, cell, CELL_FILLED);
+        }
+
+        double store_us = 0;
+        for (int i = 0; i < CAPTURE_MAX_SLOTS; i++)
+        {
+            for (int j = 0; j < n_changed; j++)
+            {
+                struct cell cell = {bench_rand(&seed) % pz->n_rows, 
+                                    bench_rand(&seed) % pz->n_cols};
+                toggle_cell_state(gs, cell, CELL_FILLED);
+            }
+
+            struct timespec start, end;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            store_capture(gs);
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            store_us += elapsed_us(start, end);
+        }
+        size_t bytes = gs->captures->bytes_in_use;
+
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int i = 0; i < BENCH_CAPTURE_N_RESTORES; i++)
+        {
+            restore_capture(gs, bench_rand(&seed) % CAPTURE_MAX_SLOTS);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        // What full board copies would take
+        size_t copy_bytes = (size_t)CAPTURE_MAX_SLOTS * BB_N_PLANES 
+                            * sizeof(uint64_t)
+                            * (gs->board->row_words * pz->n_rows 
+                               + gs->board->col_words * pz->n_cols);
+
+        fprintf(out, "%8d %8d %10.1f %10.1f %10.1f %10.1f\n",
+                n_changed, CAPTURE_MAX_SLOTS,
+                store_us * 1000.0 / CAPTURE_MAX_SLOTS,
+                elapsed_us(start, end) * 1000.0 / BENCH_CAPTURE_N_RESTORES,
+                bytes / 1024.0, copy_bytes / 1024.0);
+        game_state_destroy(gs);
+    }
+
+    puzzle_set_destroy(pset);
+    return 0;
+}
+
+int render_snapshot(const char *set_file_name, const char *keys, FILE *out)
+{
+    assert(set_file_name != NULL);
+    assert(keys != NULL);
+    assert(out != NULL);
+
+    struct puzzle_set *pset = bench_load_set(set_file_name);
+    if (pset == NULL)
+    {
+        return -1;
+    }
+
+    struct bench_replay replay =
+    {
+        .keys   = keys,
+        .n_keys = strlen(keys),
+    };
+    struct pos size = {.y = SNAPSHOT_SCREEN_ROWS, .x = SNAPSHOT_SCREEN_COLS};
+    int ret = bench_replay_play(pset->puzzles[0], &replay, size);
+    if (ret == 0)
+    {
+        dump_screen(out);
+        end_headless_screen();
+    }
+
+    puzzle_set_destroy(pset);
+    return ret;
+}
+
+/* Private */
+
+struct puzzle_set *bench_load_set(const char *set_file_name)
+{
+    struct puzzle_set *pset = puzzle_set_create(set_file_name, LOAD_ALL);
+    if (pset == NULL || pset->num_puzzles == 0)
+    {
+        fprintf(stderr, "Failed to load puzzles: %s\n", set_file_name);
+        puzzle_set_destroy(pset);
+        return NULL;
+    }
+    return pset;
+}
+
+char *bench_dir_create(const char *tmp_dir, const char *content, int n_files)
+{
+    int dir_len = strlen(tmp_dir) + sizeof("/nonogram-bench-XXXXXX");
+    char *dir_name = malloc(dir_len);
+    ALLOC_CHECK_RETURN(dir_name, NULL);
+
+    snprintf(dir_name, dir_len, "%s/nonogram-bench-XXXXXX", tmp_dir);
+    if (mkdtemp(dir_name) == NULL)
+    {
+        free(dir_name);
+        return NULL;
+    }
+
+    size_t content_len = strlen(content);
+    for (int i = 0; i < n_files; i++)
+    {
+        char file_name[dir_len + 32];
+        snprintf(file_name, sizeof(file_name), "%s/set_%05d.json", dir_name, i);
+
+        FILE *fp = fopen(file_name, "w");
+        bool ok = fp != NULL && fwrite(content, 1, content_len, fp) == content_len;
+        if (fp != NULL && fclose(fp) != 0)
+        {
+            ok = false;
+        }
+        if (!ok)
+        {
+            bench_dir_destroy(dir_name, i + 1);
+            return NULL;
+        }
+    }
+
+    return dir_name;
+}
+
+void bench_dir_destroy(char *dir_name, int n_files)
+{
+    char file_name[strlen(dir_name) + 32];
+    for (int i = 0; i < n_files; i++)
+    {
+        snprintf(file_name, sizeof(file_name), "%s/set_%05d.json", dir_name, i);
+        remove(file_name);
+    }
+    rmdir(dir_name);
+    free(dir_name);
+}
+
+double bench_catalog_load(const char *dir_name, const char *index_file_name,
+                          int n_threads)
+{
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    struct catalog *catalog = catalog_load(dir_name, index_file_name, n_threads);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    if (catalog == NULL) return -1;
+    catalog_destroy(catalog);
+    return elapsed_us(start, end) / 1000.0;
+}
+
+double bench_play_burst(const struct puzzle *pz, char key, int n_keys,
+                        long *frames_out)
+{
+    int fds[2];
+    if (pipe(fds) != 0)
+    {
+        return -1;
+    }
+
+    // Whole burst is queued before the game starts reading
+    char keys[n_keys];
+    memset(keys, key, n_keys);
+    bool ok = write(fds[1], keys, n_keys) == n_keys;
+    close(fds[1]);
+
+    FILE *in = fdopen(fds[0], "r");
+    if (!ok || in == NULL)
+    {
+        close(fds[0]);
+        return -1;
+    }
+
+    struct pos size = {.y = BENCH_SCREEN_ROWS, .x = BENCH_SCREEN_COLS};
+    if (init_headless_screen(in, BENCH_TERM, size) != 0)
+    {
+        fclose(in);
+        return -1;
+    }
+
+    long frames_before = get_frame_stats()->n_frames;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    play_puzzle(pz);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    *frames_out = get_frame_stats()->n_frames - frames_before;
+
+    end_headless_screen();
+    fclose(in);
+    return elapsed_us(start, end) / 1000.0;
+}
+
+int bench_replay_play(const struct puzzle *pz, struct bench_replay *replay,
+                      struct pos screen_size)
+{
+    int fds[2];
+    if (pipe(fds) != 0)
+    {
+        return -1;
+    }
+
+    FILE *in = fdopen(fds[0], "r");
+    if (in == NULL)
+    {
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+    if (init_headless_screen(in, BENCH_TERM, screen_size) != 0)
+    {
+        fclose(in);
+        close(fds[1]);
+        return -1;
+    }
+
+    replay->key_fd = fds[1];
+    set_frame_hook(bench_replay_frame, replay);
+
+    play_puzzle(pz);
+
+    set_frame_hook(NULL, NULL);
+    if (replay->key_fd >= 0)
+    {
+        // Game was solved before the end of the keys
+        close(replay->key_fd);
+        replay->key_fd = -1;
+    }
+    fclose(in);
+    return 0;
+}
+
+void bench_replay_frame(void *arg)
+{
+    struct bench_replay *replay = arg;
+    const struct frame_stats *stats = get_frame_stats();
+
+    // Frame 0 is drawn before any key, frame i follows key i - 1
+    if (replay->n_frames > replay->n_skipped)
+    {
+        replay->n_counted++;
+        replay->cells        += stats->last_cells;
+        replay->attr_changes += stats->last_attr_changes;
+        replay->bytes        += stats->last_bytes;
+        replay->us           += stats->last_us;
+    }
+    replay->n_frames++;
+
+    if (replay->key_fd < 0)
+    {
+        return;
+    }
+    if (replay->next_key < replay->n_keys
+        && write(replay->key_fd, &replay->keys[replay->next_key], 1) == 1)
+    {
+        replay->next_key++;
+        return;
+    }
+
+    // End of input quits the game
+    close(replay->key_fd);
+    replay->key_fd = -1;
+}
+
+int bench_resize_mode(const struct puzzle *pz, enum cell_mode mode,
+                      long long *us_out, long long *max_us_out,
+                      long long *bytes_out)
+{
+    // No keys are read
+    FILE *in = fopen("/dev/null", "r");
+    if (in == NULL)
+    {
+        return -1;
+    }
+    struct pos full_size = {.y = SNAPSHOT_SCREEN_ROWS, .x = SNAPSHOT_SCREEN_COLS};
+    if (init_headless_screen(in, BENCH_TERM, full_size) != 0)
+    {
+        fclose(in);
+        return -1;
+    }
+
+    struct game_state *gs = game_state_create(pz);
+    struct game_ui *ui    = game_ui_create(pz);
+    int ret = game_ui_set_cell_mode(ui, mode);
+
+    *us_out     = 0;
+    *max_us_out = 0;
+    *bytes_out  = 0;
+    for (int i = 0; i < BENCH_N_RESIZES && ret == 0; i++)
+    {
+        // Triangle wave between the smallest and the full size
+        int n_steps = (full_size.x - BENCH_RESIZE_MIN_COLS) / BENCH_RESIZE_STEP;
+        int step    = i % (n_steps * 2);
+        step = (step < n_steps) ? step : n_steps * 2 - step;
+        struct pos size =
+        {
+            .y = MIN(full_size.y, BENCH_RESIZE_MIN_ROWS + step),
+            .x = BENCH_RESIZE_MIN_COLS + step * BENCH_RESIZE_STEP,
+        };
+
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+
+        resize_term(size.y, size.x);
+        resize_screen();
+        game_ui_set_windows(ui);
+        display_base_board(ui);
+        display_game_state(ui, gs);
+        frame_display();
+
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        long long us = elapsed_us(start, end);
+        *us_out     += us;
+        *max_us_out  = MAX(*max_us_out, us);
+        *bytes_out  += get_frame_stats()->last_bytes;
+    }
+
+    game_ui_destroy(ui);
+    game_state_destroy(gs);
+    end_headless_screen();
+    fclose(in);
+    return ret;
+}
+
+void bench_undo_run_op(struct game_state *gs, enum bench_undo_op op, int i,
+                       uint32_t *seed)
+{
+    int n_rows = gs->puzzle->n_rows;
+    int n_cols = gs->puzzle->n_cols;
+
+    switch (op)
+    {
+        case BENCH_UNDO_CELL:
+        {
+            struct cell cell = {bench_rand(seed) % n_rows, 
+                                bench_rand(seed) % n_cols};
+            toggle_cell_state(gs, cell, CELL_FILLED);
+            break;
+        }
+        case BENCH_UNDO_AREA:
+        {
+            static const enum cell_state states[] = 
+            {
+                CELL_EMPTY, CELL_FILLED, CELL_XMARKED
+            };
+            struct cell a = {bench_rand(seed) % n_rows, bench_rand(seed) % n_cols};
+            struct cell b = {bench_rand(seed) % n_rows, bench_rand(seed) % n_cols};
+            struct cell start = {MIN(a.row, b.row), MIN(a.col, b.col)};
+            struct cell end   = {MAX(a.row, b.row), MAX(a.col, b.col)};
+            set_area_state(gs, start, end, states[bench_rand(seed) % 3]);
+            break;
+        }
+        case BENCH_UNDO_CLEAR:
+            if (i % 2 == 0)
+            {
+                struct cell end = {n_rows - 1, n_cols - 1};
+                set_area_state(gs, (struct cell){0, 0}, end, CELL_FILLED);
+            }
+            else
+            {
+                clear_board(gs);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+uint32_t bench_rand(uint32_t *seed)
+{
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 17;
+    *seed ^= *seed << 5;
+    return *seed;
+}
+
+int get_cell_mode_keys(enum cell_mode mode, char *keys, int max_keys)
+{
+    int n_keys = 0;
+    for (int m = CELL_MODE_BOXED; m < (int)mode; m++)
+    {
+        // Menu keeps its last item, go to the top first
+        assert(n_keys + CMD_N + CMD_CELL_MODE + 2 <= max_keys);
+        keys[n_keys++] = ':';
+        memset(keys + n_keys, 'k', CMD_N);
+        n_keys += CMD_N;
+        memset(keys + n_keys, 'j', CMD_CELL_MODE);
+        n_keys += CMD_CELL_MODE;
+        keys[n_keys++] = '\n';
+    }
+    return n_keys;
+}
@@ -0,0 +1,230 @@
+#include "bitboard.h"
+#include "utils.h"
+#include <string.h>
+
+/* Function prototypes */
+
+size_t bitboard_plane_words(const struct bitboard *bb, enum axis axis);
+
+/* Public */
+
+struct bitboard *bitboard_create(int n_rows, int n_cols)
+{
+    assert(n_rows > 0 && n_cols > 0);
+
+    struct bitboard *bb = malloc(sizeof(struct bitboard));
+    ALLOC_CHECK_RETURN(bb, NULL);
+
+    bb->n_rows    = n_rows;
+    bb->n_cols    = n_cols;
+    bb->row_words = BB_N_WORDS(n_cols);
+    bb->col_words = BB_N_WORDS(n_rows);
+
+    // Single block: all row planes, then all column planes
+    size_t row_plane_words = bitboard_plane_words(bb, AXIS_ROW);
+    size_t col_plane_words = bitboard_plane_words(bb, AXIS_COL);
+    uint64_t *data = calloc(BB_N_PLANES * (row_plane_words + col_plane_words),
+                            sizeof(uint64_t));
+    if (data == NULL)
+    {
+        LOG(LOG_ERROR, "Memory allocation failed");
+        free(bb);
+        return NULL;
+    }
+
+    for (int p = 0; p < BB_N_PLANES; p++)
+    {
+        bb->rows[p] = data + p * row_plane_words;
+        bb->cols[p] = data + BB_N_PLANES * row_plane_words
+                           + p * col_plane_words;
+    }
+
+    return bb;
+}
+
+void bitboard_destroy(struct bitboard *bb)
+{
+    if (bb != NULL)
+    {
+        free(bb->rows[0]);
+    }
+    free(bb); bb = NULL;
+}
+
+void bitboard_copy(struct bitboard *dst, const struct bitboard *src)
+{
+    assert(dst != NULL && src != NULL);
+    assert(dst->n_rows == src->n_rows && dst->n_cols == src->n_cols);
+
+    size_t n_words = bitboard_plane_words(src, AXIS_ROW)
+                     + bitboard_plane_words(src, AXIS_COL);
+    memcpy(dst->rows[0], src->rows[0], BB_N_PLANES * n_words * sizeof(uint64_t));
+}
+
+void bitboard_clear(struct bitboard *bb)
+{
+    assert(bb != NULL);
+
+    size_t n_words = bitboard_plane_words(bb, AXIS_ROW)
+                     + bitboard_plane_words(bb, AXIS_COL);
+    memset(bb->rows[0], 0, BB_N_PLANES * n_words * sizeof(uint64_t));
+}
+
+bool bitboard_get(const struct bitboard *bb, enum bb_plane plane, struct cell cell)
+{
+    assert(bb != NULL);
+    assert(cell.row >= 0 && cell.row < bb->n_rows);
+    assert(cell.col >= 0 && cell.col < bb->n_cols);
+
+    return bitline_test(bitboard_line(bb, plane, AXIS_ROW, cell.row), cell.col);
+}
+
+unsigned bitboard_get_planes(const struct bitboard *bb, struct cell cell)
+{
+    assert(bb != NULL);
+    assert(cell.row >= 0 && cell.row < bb->n_rows);
+    assert(cell.col >= 0 && cell.col < bb->n_cols);
+
+    size_t   word  = (size_t)cell.row * bb->row_words + cell.col / BB_WORD_BITS;
+    int      shift = cell.col % BB_WORD_BITS;
+    unsigned planes = 0;
+    for (int p = 0; p < BB_N_PLANES; p++)
+    {
+        planes |= ((bb->rows[p][word] >> shift) & 1) << p;
+    }
+    return planes;
+}
+
+void bitboard_put(struct bitboard *bb, enum bb_plane plane,
+                  struct cell cell, bool value)
+{
+    assert(bb != NULL);
+    assert(cell.row >= 0 && cell.row < bb->n_rows);
+    assert(cell.col >= 0 && cell.col < bb->n_cols);
+
+    uint64_t *row_word = bb->rows[plane] + cell.row * bb->row_words
+                         + cell.col / BB_WORD_BITS;
+    uint64_t *col_word = bb->cols[plane] + cell.col * bb->col_words
+                         + cell.row / BB_WORD_BITS;
+    uint64_t row_bit = (uint64_t)1 << (cell.col % BB_WORD_BITS);
+    uint64_t col_bit = (uint64_t)1 << (cell.row % BB_WORD_BITS);
+
+    if (value)
+    {
+        *row_word |= row_bit;
+        *col_word |= col_bit;
+    }
+    else
+    {
+        *row_word &= ~row_bit;
+        *col_word &= ~col_bit;
+    }
+}
+
+void bitboard_put_row_word(struct bitboard *bb, enum bb_plane plane,
+                           int row, int w, uint64_t value)
+{
+    assert(bb != NULL);
+    assert(row >= 0 && row < bb->n_rows);
+    assert(w >= 0 && w < bb->row_words);
+    assert((value & ~bitline_word_mask(bb->n_cols, w)) == 0);
+
+    uint64_t *row_word = bb->rows[plane] + row * bb->row_words + w;
+    uint64_t  flipped  = *row_word ^ value;
+    *row_word = value;
+
+    // Only the changed bits touch the column lines
+    uint64_t col_bit = (uint64_t)1 << (row % BB_WORD_BITS);
+    while (flipped != 0)
+    {
+        int col = w * BB_WORD_BITS + __builtin_ctzll(flipped);
+        bb->cols[plane][col * bb->col_words + row / BB_WORD_BITS] ^= col_bit;
+        flipped &= flipped - 1;
+    }
+}
+
+void bitline_set_range(uint64_t *line, int from, int to)
+{
+    while (from < to)
+    {
+        int w     = from / BB_WORD_BITS;
+        int shift = from % BB_WORD_BITS;
+        int n     = MIN(to - from, BB_WORD_BITS - shift);
+
+        uint64_t mask = (n == BB_WORD_BITS) ? ~(uint64_t)0 
+                                            : (((uint64_t)1 << n) - 1);
+        line[w] |= mask << shift;
+        from += n;
+    }
+}
+
+int bitline_next_set(const uint64_t *line, int len, int from)
+{
+    if (from >= len) return len;
+
+    int w = from / BB_WORD_BITS;
+    uint64_t word = line[w] & (~(uint64_t)0 << (from % BB_WORD_BITS));
+    int n_words = BB_N_WORDS(len);
+    for (;;)
+    {
+        if (word != 0)
+        {
+            int i = w * BB_WORD_BITS + __builtin_ctzll(word);
+            return MIN(i, len);
+        }
+        if (++w >= n_words) return len;
+        word = line[w];
+    }
+}
+
+int bitline_next_clear(const uint64_t *line, int len, int from)
+{
+    if (from >= len) return len;
+
+    int w = from / BB_WORD_BITS;
+    uint64_t word = ~line[w] & (~(uint64_t)0 << (from % BB_WORD_BITS));
+    int n_words = BB_N_WORDS(len);
+    for (;;)
+    {
+        if (word != 0)
+        {
+            int i = w * BB_WORD_BITS + __builtin_ctzll(word);
+            return MIN(i, len);
+        }
+        if (++w >= n_words) return len;
+        word = ~line[w];
+    }
+}
+
+bool bitline_matches_clues(const uint64_t *line, int len,
+                           const int *clueline, int clueline_size)
+{
+    // Skip padding
+    int clue_idx = 0;
+    while (clue_idx < clueline_size && clueline[clue_idx] == 0)
+    {
+        clue_idx++;
+    }
+
+    int pos = bitline_next_set(line, len, 0);
+    while (pos < len)
+    {
+        int run_end = bitline_next_clear(line, len, pos);
+        if (clue_idx >= clueline_size || run_end - pos != clueline[clue_idx])
+        {
+            return false;
+        }
+        clue_idx++;
+        pos = bitline_next_set(line, len, run_end);
+    }
+
+    return clue_idx == clueline_size;
+}
+
+/* Private */
+
+size_t bitboard_plane_words(const struct bitboard *bb, enum axis axis)
+{
+    return (axis == AXIS_ROW) ? (size_t)bb->n_rows * bb->row_words
+                              : (size_t)bb->n_cols * bb->col_words;
+}
@@ -0,0 +1,187 @@
+#include "capture_set.h"
+#include "utils.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Function prototypes */
+
+/**
+ * @return Copy of a row of the board with one reference, NULL if
+ *         allocation failed
+ */
+struct capture_row *capture_row_create(struct capture_set *cs,
+                                       const struct bitboard *bb, int row);
+
+/**
+ * Drop a reference, the row is freed with the last one.
+ */
+void capture_row_release(struct capture_set *cs, struct capture_row *row);
+
+size_t capture_row_bytes(const struct capture_set *cs);
+
+/**
+ * Release the rows of the oldest capture and drop its slot.
+ */
+void capture_set_drop_oldest(struct capture_set *cs);
+
+/* Public */
+
+struct capture_set *capture_set_create(const struct bitboard *bb, int max_slots)
+{
+    assert(bb != NULL);
+    assert(max_slots > 0);
+
+    struct capture_set *cs = calloc(1, sizeof(struct capture_set));
+    ALLOC_CHECK_RETURN(cs, NULL);
+
+    cs->n_rows     = bb->n_rows;
+    cs->row_words  = bb->row_words;
+    cs->max_slots  = max_slots;
+    cs->slots      = calloc(max_slots, sizeof(struct capture));
+    cs->shared     = calloc(cs->n_rows, sizeof(struct capture_row *));
+    cs->rows_dirty = calloc(BB_N_WORDS(cs->n_rows), sizeof(uint64_t));
+    if (cs->slots == NULL || cs->shared == NULL || cs->rows_dirty == NULL)
+    {
+        LOG(LOG_ERROR, "Memory allocation failed");
+        capture_set_destroy(cs);
+        return NULL;
+    }
+    return cs;
+}
+
+void capture_set_destroy(struct capture_set *cs)
+{
+    if (cs != NULL)
+    {
+        while (cs->n_slots > 0)
+        {
+            capture_set_drop_oldest(cs);
+        }
+        if (cs->shared != NULL)
+        {
+            for (int r = 0; r < cs->n_rows; r++)
+            {
+                capture_row_release(cs, cs->shared[r]);
+            }
+        }
+        free(cs->slots);
+        free(cs->shared);
+        free(cs->rows_dirty);
+    }
+    free(cs); cs = NULL;
+}
+
+int capture_set_store(struct capture_set *cs, const struct bitboard *bb,
+                      const char *desc)
+{
+    assert(cs != NULL);
+    assert(bb != NULL);
+    assert(bb->n_rows == cs->n_rows && bb->row_words == cs->row_words);
+
+    struct capture_row **rows = malloc(cs->n_rows * sizeof(struct capture_row *));
+    ALLOC_CHECK_RETURN(rows, -1);
+
+    // Rows changed since the last capture or restore are copied, the
+    // others are shared with it
+    for (int r = 0; r < cs->n_rows; r++)
+    {
+        if (cs->shared[r] == NULL || bitline_test(cs->rows_dirty, r))
+        {
+            struct capture_row *row = capture_row_create(cs, bb, r);
+            if (row == NULL)
+            {
+                for (int i = 0; i < r; i++)
+                {
+                    capture_row_release(cs, rows[i]);
+                }
+                free(rows);
+                return -1;
+            }
+            capture_row_release(cs, cs->shared[r]);
+            cs->shared[r] = row;
+        }
+        rows[r] = cs->shared[r];
+        rows[r]->refs++;
+    }
+    memset(cs->rows_dirty, 0, BB_N_WORDS(cs->n_rows) * sizeof(uint64_t));
+
+    if (cs->n_slots == cs->max_slots)
+    {
+        capture_set_drop_oldest(cs);
+    }
+
+    struct capture *capt = &cs->slots[cs->n_slots];
+    capt->rows = rows;
+    snprintf(capt->name, sizeof(capt->name), "Capture %d", ++cs->n_stored);
+    snprintf(capt->desc, sizeof(capt->desc), "%s", desc);
+    cs->bytes_in_use += cs->n_rows * sizeof(struct capture_row *);
+    return cs->n_slots++;
+}
+
+void capture_set_restored(struct capture_set *cs, int slot)
+{
+    assert(cs != NULL);
+    assert(slot >= 0 && slot < cs->n_slots);
+
+    struct capture_row **rows = cs->slots[slot].rows;
+    for (int r = 0; r < cs->n_rows; r++)
+    {
+        if (cs->shared[r] != rows[r])
+        {
+            capture_row_release(cs, cs->shared[r]);
+            cs->shared[r] = rows[r];
+            cs->shared[r]->refs++;
+        }
+    }
+    memset(cs->rows_dirty, 0, BB_N_WORDS(cs->n_rows) * sizeof(uint64_t));
+}
+
+/* Private */
+
+struct capture_row *capture_row_create(struct capture_set *cs,
+                                       const struct bitboard *bb, int row)
+{
+    struct capture_row *capt_row = malloc(capture_row_bytes(cs));
+    ALLOC_CHECK_RETURN(capt_row, NULL);
+
+    capt_row->refs = 1;
+    uint64_t *words = capt_row->words;
+    for (int w = 0; w < cs->row_words; w++)
+    {
+        for (int p = 0; p < BB_N_PLANES; p++)
+        {
+            *words++ = bitboard_line(bb, p, AXIS_ROW, row)[w];
+        }
+    }
+    cs->bytes_in_use += capture_row_bytes(cs);
+    return capt_row;
+}
+
+void capture_row_release(struct capture_set *cs, struct capture_row *row)
+{
+    if (row != NULL && --row->refs == 0)
+    {
+        cs->bytes_in_use -= capture_row_bytes(cs);
+        free(row);
+    }
+}
+
+size_t capture_row_bytes(const struct capture_set *cs)
+{
+    return sizeof(struct capture_row)
+           + (size_t)cs->row_words * BB_N_PLANES * sizeof(uint64_t);
+}
+
+void capture_set_drop_oldest(struct capture_set *cs)
+{
+    struct capture_row **rows = cs->slots[0].rows;
+    for (int r = 0; r < cs->n_rows; r++)
+    {
+        capture_row_release(cs, rows[r]);
+    }
+    free(rows);
+    cs->bytes_in_use -= cs->n_rows * sizeof(struct capture_row *);
+
+    cs->n_slots--;
+    memmove(cs->slots, cs->slots + 1, cs->n_slots * sizeof(struct capture));
+}
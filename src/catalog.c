@@ -0,0 +1,368 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "catalog.h"
+#include "utils.h"
+
+// Scanning is I/O bound, use more threads than CPUs
+#define CATALOG_THREADS_PER_CPU 2
+
+struct catalog_header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entry_size; // sizeof(struct catalog_entry) of the writer
+    uint32_t n_entries;
+};
+
+/**
+ * Files to scan, shared by the worker threads.
+ *  - Each file has its own slot in entries and found, workers only write
+ *    their own slots so results do not depend on completion order.
+ */
+struct catalog_scan
+{
+    char **file_names;
+    int n_files;
+    const struct catalog_entry *cached; // Sorted by file name
+    int n_cached;
+
+    struct catalog_entry *entries;
+    bool *found;  // File still exists
+    bool *parsed; // Entry was rebuilt from the file
+
+    int next_file;
+    pthread_mutex_t lock;
+};
+
+/* Function Prototypes */
+
+/**
+ * Read the entries of an index file, sorted by file name.
+ * @retval NULL if the file is missing or invalid, *n_entries_out is 0
+ */
+struct catalog_entry *catalog_read(const char *index_file_name,
+                                   int *n_entries_out);
+int catalog_write(const struct catalog *catalog, const char *index_file_name);
+
+/**
+ * Parse a puzzle set file into an entry, marked invalid if it fails to load.
+ */
+void catalog_entry_build(struct catalog_entry *entry, const char *file_name,
+                         struct file_info info);
+
+void *catalog_scan_worker(void *arg);
+void catalog_scan_file(struct catalog_scan *scan, int idx);
+void catalog_scan_run(struct catalog_scan *scan, int n_threads);
+
+void catalog_entry_terminate(struct catalog_entry *entry);
+int  compare_entry_file_names(const void *a, const void *b);
+
+/* Public */
+
+struct catalog *catalog_load(const char *dir_name, const char *index_file_name,
+                             int n_threads)
+{
+    assert(dir_name != NULL);
+    assert(index_file_name != NULL);
+
+    int n_files;
+    char **file_names = list_puzzle_set_files(dir_name, &n_files);
+    if (file_names == NULL) return NULL;
+
+    struct catalog *catalog = malloc(sizeof(struct catalog));
+    if (catalog == NULL)
+    {
+        LOG(LOG_ERROR, "Memory allocation failed");
+        free_ptr_array((void **) file_names, n_files);
+        return NULL;
+    }
+
+    struct catalog_scan scan =
+    {
+        .file_names = file_names,
+        .n_files    = n_files,
+        .entries    = malloc(MAX(n_files, 1) * sizeof(struct catalog_entry)),
+        .found      = calloc(MAX(n_files, 1), sizeof(bool)),
+        .parsed     = calloc(MAX(n_files, 1), sizeof(bool)),
+        .next_file  = 0,
+    };
+    if (scan.entries == NULL || scan.found == NULL || scan.parsed == NULL)
+    {
+        LOG(LOG_ERROR, "Memory allocation failed");
+        free(scan.entries);
+        free(scan.found);
+        free(scan.parsed);
+        free_ptr_array((void **) file_names, n_files);
+        free(catalog);
+        return NULL;
+    }
+
+    struct catalog_entry *cached = catalog_read(index_file_name, &scan.n_cached);
+    scan.cached = cached;
+
+    catalog_scan_run(&scan, n_threads);
+
+    // Keep files that still exist, in file name order
+    catalog->entries   = scan.entries;
+    catalog->n_entries = 0;
+    catalog->n_parsed  = 0;
+    for (int i = 0; i < n_files; i++)
+    {
+        if (!scan.found[i]) continue;
+
+        catalog->entries[catalog->n_entries++] = scan.entries[i];
+        catalog->n_parsed += scan.parsed[i];
+    }
+
+    // Rewrite when anything was added, changed or removed
+    if (catalog->n_parsed > 0 || catalog->n_entries != scan.n_cached)
+    {
+        catalog_write(catalog, index_file_name);
+    }
+
+    free(cached);
+    free(scan.found);
+    free(scan.parsed);
+    free_ptr_array((void **) file_names, n_files);
+    return catalog;
+}
+
+void catalog_destroy(struct catalog *catalog)
+{
+    if (catalog != NULL)
+    {
+        free(catalog->entries);
+    }
+    free(catalog); catalog = NULL;
+}
+
+void catalog_entry_get_metadata(const struct catalog_entry *entry,
+                                struct puzzle_set *pset)
+{
+    assert(entry != NULL);
+    assert(pset != NULL);
+
+    strncpy(pset->file_name,  entry->file_name,  MAX_PZ_FILE_NAME_LEN + 1);
+    strncpy(pset->format_ver, entry->format_ver, JSON_FMT_VER_LEN + 1);
+    strncpy(pset->title,      entry->title,      MAX_PZ_TITLE_LEN + 1);
+    strncpy(pset->desc,       entry->desc,       MAX_PZ_DESC_LEN + 1);
+    pset->num_puzzles = entry->num_puzzles;
+}
+
+/* Private */
+
+void catalog_scan_run(struct catalog_scan *scan, int n_threads)
+{
+    if (n_threads <= 0)
+    {
+        n_threads = (int)sysconf(_SC_NPROCESSORS_ONLN) * CATALOG_THREADS_PER_CPU;
+    }
+    n_threads = MAX(1, MIN(n_threads, scan->n_files));
+
+    pthread_mutex_init(&scan->lock, NULL);
+
+    // The calling thread is the first worker
+    pthread_t threads[n_threads];
+    int n_started = 0;
+    for (int i = 1; i < n_threads; i++)
+    {
+        if (pthread_create(&threads[n_started], NULL,
+                           catalog_scan_worker, scan) != 0)
+        {
+            LOG(LOG_WARNING, "Failed to start scan thread");
+            break;
+        }
+        n_started++;
+    }
+    catalog_scan_worker(scan);
+    for (int i = 0; i < n_started; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    pthread_mutex_destroy(&scan->lock);
+}
+
+void *catalog_scan_worker(void *arg)
+{
+    struct catalog_scan *scan = arg;
+    while (true)
+    {
+        pthread_mutex_lock(&scan->lock);
+        int idx = scan->next_file++;
+        pthread_mutex_unlock(&scan->lock);
+
+        if (idx >= scan->n_files) break;
+        catalog_scan_file(scan, idx);
+    }
+    return NULL;
+}
+
+void catalog_scan_file(struct catalog_scan *scan, int idx)
+{
+    const char *file_name = scan->file_names[idx];
+
+    struct file_info info;
+    if (!get_file_info(file_name, &info))
+    {
+        return;
+    }
+    scan->found[idx] = true;
+
+    struct catalog_entry key;
+    strncpy(key.file_name, file_name, MAX_PZ_FILE_NAME_LEN);
+    key.file_name[MAX_PZ_FILE_NAME_LEN] = '\0';
+
+    const struct catalog_entry *hit = NULL;
+    if (scan->cached != NULL)
+    {
+        hit = bsearch(&key, scan->cached, scan->n_cached,
+                      sizeof(*scan->cached), compare_entry_file_names);
+    }
+
+    if (hit != NULL && hit->info.mtime_ns == info.mtime_ns
+        && hit->info.size == info.size)
+    {
+        scan->entries[idx] = *hit;
+    }
+    else
+    {
+        catalog_entry_build(&scan->entries[idx], file_name, info);
+        scan->parsed[idx] = true;
+    }
+}
+
+struct catalog_entry *catalog_read(const char *index_file_name,
+                                   int *n_entries_out)
+{
+    *n_entries_out = 0;
+
+    FILE *fp = fopen(index_file_name, "rb");
+    if (fp == NULL)
+    {
+        // First run, nothing cached yet
+        return NULL;
+    }
+
+    struct catalog_header header;
+    if (fread(&header, sizeof(header), 1, fp) != 1
+        || header.magic != CATALOG_MAGIC
+        || header.version != CATALOG_VERSION
+        || header.entry_size != sizeof(struct catalog_entry))
+    {
+        LOGF(LOG_INFO, "Rebuilding catalog: '%s'", index_file_name);
+        fclose(fp);
+        return NULL;
+    }
+
+    struct catalog_entry *entries =
+        malloc(MAX(header.n_entries, 1) * sizeof(struct catalog_entry));
+    if (entries == NULL)
+    {
+        LOG(LOG_ERROR, "Memory allocation failed");
+        fclose(fp);
+        return NULL;
+    }
+
+    if (fread(entries, sizeof(*entries), header.n_entries, fp)
+        != header.n_entries)
+    {
+        LOGF(LOG_WARNING, "Truncated catalog: '%s'", index_file_name);
+        free(entries);
+        fclose(fp);
+        return NULL;
+    }
+    fclose(fp);
+
+    for (uint32_t i = 0; i < header.n_entries; i++)
+    {
+        catalog_entry_terminate(&entries[i]);
+        entries[i].num_puzzles = MAX(0, MIN(entries[i].num_puzzles,
+                                            MAX_PZ_PER_SET));
+    }
+    qsort(entries, header.n_entries, sizeof(*entries),
+          compare_entry_file_names);
+
+    *n_entries_out = header.n_entries;
+    return entries;
+}
+
+int catalog_write(const struct catalog *catalog, const char *index_file_name)
+{
+    // Write a temporary file and rename it, a crash never leaves a torn index
+    int tmp_len = strlen(index_file_name) + sizeof(".tmp");
+    char tmp_name[tmp_len];
+    snprintf(tmp_name, tmp_len, "%s.tmp", index_file_name);
+
+    FILE *fp = fopen(tmp_name, "wb");
+    if (fp == NULL)
+    {
+        LOGF(LOG_WARNING, "Failed to open file: '%s'", tmp_name);
+        return -1;
+    }
+
+    struct catalog_header header =
+    {
+        .magic      = CATALOG_MAGIC,
+        .version    = CATALOG_VERSION,
+        .entry_size = sizeof(struct catalog_entry),
+        .n_entries  = catalog->n_entries,
+    };
+
+    bool ok = fwrite(&header, sizeof(header), 1, fp) == 1
+              && fwrite(catalog->entries, sizeof(struct catalog_entry),
+                        catalog->n_entries, fp)
+                 == (size_t)catalog->n_entries;
+
+    if (fclose(fp) != 0 || !ok || rename(tmp_name, index_file_name) != 0)
+    {
+        LOGF(LOG_WARNING, "Failed to write catalog: '%s'", index_file_name);
+        remove(tmp_name);
+        return -1;
+    }
+
+    return 0;
+}
+
+void catalog_entry_build(struct catalog_entry *entry, const char *file_name,
+                         struct file_info info)
+{
+    // Zero padding too, entries are written to disk as they are
+    memset(entry, 0, sizeof(*entry));
+    strncpy(entry->file_name, file_name, MAX_PZ_FILE_NAME_LEN);
+    entry->info = info;
+
+    // The puzzles are left for when the set is chosen
+    struct puzzle_set *pset = puzzle_set_create(file_name, LOAD_METADATA_ONLY);
+    if (pset == NULL)
+    {
+        entry->valid = false;
+        return;
+    }
+
+    entry->valid = true;
+    strncpy(entry->format_ver, pset->format_ver, JSON_FMT_VER_LEN);
+    strncpy(entry->title,      pset->title,      MAX_PZ_TITLE_LEN);
+    strncpy(entry->desc,       pset->desc,       MAX_PZ_DESC_LEN);
+    entry->num_puzzles = pset->num_puzzles;
+
+    puzzle_set_destroy(pset);
+}
+
+void catalog_entry_terminate(struct catalog_entry *entry)
+{
+    entry->file_name[MAX_PZ_FILE_NAME_LEN] = '\0';
+    entry->format_ver[JSON_FMT_VER_LEN]    = '\0';
+    entry->title[MAX_PZ_TITLE_LEN]         = '\0';
+    entry->desc[MAX_PZ_DESC_LEN]           = '\0';
+}
+
+int compare_entry_file_names(const void *a, const void *b)
+{
+    const struct catalog_entry *entry_a = a;
+    const struct catalog_entry *entry_b = b;
+    return strcmp(entry_a->file_name, entry_b->file_name);
+}
@@ -1,4 +1,5 @@
 #include "game_control.h"
+#include "capture_set.h"
 #include "config.h"
 #include "game_core.h"
 #include "game_ui.h"
@@ -6,6 +7,11 @@
 #include "puzzle.h"
 #include "tui.h"
 #include "utils.h"
+#include <time.h>
+
+// Resizes are laid out together, at most this long after the first one, so
+// dragging the terminal edge stays live without a layout per event
+#define RESIZE_DEBOUNCE_MS 30
 
 enum controller_mode 
 {
@@ -22,6 +28,10 @@ struct game_controller
     enum controller_mode mode;
     struct cell cursor;
     struct cell selection_pivot; // For visual mode selection area
+
+    // Terminal was resized, laid out once the resizes stop coming
+    bool resize_pending;
+    struct timespec resize_time; // First resize not laid out yet
 };
 
 char *command_mode_choices[CMD_N] =
@@ -31,6 +41,12 @@ char *command_mode_choices[CMD_N] =
     [CMD_CLEAR]             = "Clear",
     [CMD_CAPTURE]           = "Capture",
     [CMD_RESTORE_CAPTURE]   = "Restore Capture",
+    [CMD_EARLIER_STATE]     = "Earlier State",
+    [CMD_LATER_STATE]       = "Later State",
+    [CMD_OLDEST_STATE]      = "Oldest State",
+    [CMD_NEWEST_STATE]      = "Newest State",
+    [CMD_GOTO_MOVE]         = "Go to Move",
+    [CMD_CELL_MODE]         = "Cell Size",
     [CMD_SAVE]              = "Save",
     [CMD_QUIT]              = "Quit",
 };
@@ -40,8 +56,14 @@ char *command_mode_desc[CMD_N] =
     [CMD_AUTO_XMARK]        = "X mark all cells on correct axis",
     [CMD_DELETE_TEMP_MARKS] = "Delete all temporary marks",
     [CMD_CLEAR]             = "Clear the board",
-    [CMD_CAPTURE]           = "Capture current state",
-    [CMD_RESTORE_CAPTURE]   = "Restore captured state",
+    [CMD_CAPTURE]           = "Capture current state in a new slot",
+    [CMD_RESTORE_CAPTURE]   = "Restore one of the captured states",
+    [CMD_EARLIER_STATE]     = "Go back in time one move, across undo branches",
+    [CMD_LATER_STATE]       = "Go forward in time one move, across undo branches",
+    [CMD_OLDEST_STATE]      = "Go to the oldest state in the undo history",
+    [CMD_NEWEST_STATE]      = "Go to the last move made, in any undo branch",
+    [CMD_GOTO_MOVE]         = "Go to a move by its number, in any undo branch",
+    [CMD_CELL_MODE]         = "Switch boxed, compact and half-block cells",
     [CMD_SAVE]              = "Save the current state",
     [CMD_QUIT]              = "Quit the game",
 };
@@ -55,6 +77,13 @@ void game_controller_destroy(struct game_controller *game);
 enum game_return_code play(struct game_controller *game);
 enum game_return_code run_game_loop(struct game_controller *game);
 
+/**
+ * Apply one key to the game.
+ * @return True if the game is over, *ret_out is set to its return code
+ */
+bool process_key(struct game_controller *game, int key,
+                 enum game_return_code *ret_out);
+
 int  handle_key_input(struct game_controller *game, int key);
 bool handle_cursor_movement(struct game_controller *game, int key);
 bool handle_edit(struct game_controller *game, int key);
@@ -70,13 +99,40 @@ struct cell selection_end(struct game_controller *game);
 
 int open_command_mode(struct game_controller *game);
 
+/**
+ * Let the user pick one of the captures, newest first.
+ * @return Slot of the capture, MENU_NOT_SELECTED if none was picked
+ */
+int select_capture(struct game_controller *game);
+
+/**
+ * Ask for a move number and go to the board right after it.
+ */
+void goto_move(struct game_controller *game);
+
+/**
+ * Switch to the next cell mode the terminal can draw.
+ */
+void switch_cell_mode(struct game_controller *game);
+
+/**
+ * @return Milliseconds left before pending resizes are laid out, 0 if it
+ *         is time
+ */
+int get_resize_wait_ms(const struct game_controller *game);
+
+/**
+ * Lay the windows out for the new terminal size, the game state and clue
+ * values are kept.
+ */
+void relayout(struct game_controller *game);
+
 /* Public */
 
 enum game_return_code new_game(void)
 {
     struct puzzle_set      *selected_pset = NULL;
     struct puzzle          *selected_pz   = NULL;
-    struct game_controller *game          = NULL;
 
     enum game_return_code ret;
 
@@ -91,10 +147,8 @@ enum game_return_code new_game(void)
         return GAME_RET_ERROR_LOAD;
     }
 
-    game = game_controller_create(selected_pz);
-    ret  = play(game);
+    ret = play_puzzle(selected_pz);
 
-    game_controller_destroy(game);
     puzzle_set_destroy(selected_pset);
     return ret;
 }
@@ -132,6 +186,17 @@ enum game_return_code continue_game(void)
     return ret;
 }
 
+enum game_return_code play_puzzle(const struct puzzle *pz)
+{
+    assert(pz != NULL);
+
+    struct game_controller *game = game_controller_create(pz);
+    enum game_return_code ret    = play(game);
+
+    game_controller_destroy(game);
+    return ret;
+}
+
 /* Private */
 
 enum game_return_code play(struct game_controller *game)
@@ -140,7 +205,13 @@ enum game_return_code play(struct game_controller *game)
 
     game_ui_set_windows(game->ui);
     display_base_board(game->ui);
-    return run_game_loop(game);
+    enum game_return_code ret = run_game_loop(game);
+
+    const struct frame_stats *stats = get_frame_stats();
+    LOGF(LOG_INFO, "Frames: %ld, last %lld bytes, max %lld bytes, total %lld bytes",
+         stats->n_frames, stats->last_bytes, stats->max_bytes,
+         stats->total_bytes);
+    return ret;
 }
 
 struct game_controller *game_controller_create(const struct puzzle *pz)
@@ -159,6 +230,8 @@ struct game_controller *game_controller_create(const struct puzzle *pz)
     game->cursor = (struct cell){0, 0};
     game->mode   = MODE_NORMAL;
 
+    game->resize_pending = false;
+
     return game;
 }
 
@@ -177,6 +250,7 @@ enum game_return_code run_game_loop(struct game_controller *game)
 {
     assert (game != NULL);
 
+    enum game_return_code ret;
     for (;;)
     {
         if (game->mode == MODE_NORMAL)
@@ -187,27 +261,71 @@ enum game_return_code run_game_loop(struct game_controller *game)
         struct cell start = selection_start(game);
         struct cell end   = selection_end(game);
 
-        highlight_area(game->ui, start, end, COLOR_P_DEFAULT_HIGHLIGHTED);
+        scroll_to_cell(game->ui, game->cursor);
+        draw_selection(game->ui, game->state, start, end);
         display_game_state(game->ui, game->state);
-        int key = wgetch(game->ui->win);
-        highlight_area(game->ui, start, end, COLOR_P_DEFAULT);
+        clear_changes(game->state);
+        frame_display();
 
-        if (handle_key_input(game, key) == GAME_RET_QUIT)
+        int key = wgetch(game->ui->win);
+        if (key == ERR)
         {
+            // Input closed, nothing more will come
             return GAME_RET_QUIT;
         }
 
-        if (game_solved(game->state))
+        // Apply every queued key (key repeat, paste) before the next frame
+        do
+        {
+            if (process_key(game, key, &ret))
+            {
+                return ret;
+            }
+
+            key = get_pending_key(game->ui->win);
+            if (key == ERR && game->resize_pending)
+            {
+                // Dragging the terminal edge sends a storm of resizes
+                int wait_ms = get_resize_wait_ms(game);
+                key = (wait_ms > 0) ? get_key_within(game->ui->win, wait_ms)
+                                    : ERR;
+            }
+        } while (key != ERR);
+
+        if (game->resize_pending)
         {
-            // @TODO: Make cool display
-            display_notification("Goodjob");
-            return 0;
+            relayout(game);
         }
     }
 
     return 0;
 }
 
+bool process_key(struct game_controller *game, int key,
+                 enum game_return_code *ret_out)
+{
+    if (handle_key_input(game, key) == GAME_RET_QUIT)
+    {
+        *ret_out = GAME_RET_QUIT;
+        return true;
+    }
+
+    if (game_solved(game->state))
+    {
+        // @TODO: Make cool display
+        display_notification("Goodjob");
+        *ret_out = GAME_RET_SUCCESS;
+        return true;
+    }
+
+    // Later keys of the batch see the selection as it would be drawn
+    if (game->mode == MODE_NORMAL)
+    {
+        game->selection_pivot = game->cursor;
+    }
+    return false;
+}
+
 bool handle_cursor_movement(struct game_controller *game, int key)
 {
     switch (key)
@@ -326,6 +444,12 @@ bool handle_operation(struct game_controller *game, int key)
         case 'U': 
             redo(game->state);
             break;
+        case '-':
+            undo_jump(game->state, UNDO_JUMP_EARLIER);
+            break;
+        case '+':
+            undo_jump(game->state, UNDO_JUMP_LATER);
+            break;
         case '?':
             // @TODO: help
             break;
@@ -382,7 +506,12 @@ int handle_key_input(struct game_controller *game, int key)
 
     if (key == KEY_RESIZE)
     {
-        // @TODO:
+        if (!game->resize_pending)
+        {
+            game->resize_pending = true;
+            clock_gettime(CLOCK_MONOTONIC, &game->resize_time);
+        }
+        return 0;
     }
 
     // Any Unhandled key will exit visual mode
@@ -436,8 +565,9 @@ struct cell selection_end(struct game_controller *game)
 int open_command_mode(struct game_controller *game)
 {
     int cmd_choice = menu_set_get_user_choice(game->ui->cmd_menu);
-    wclear(game->ui->cmd_menu->win);
-    wrefresh(game->ui->cmd_menu->win);
+
+    // Menu may have covered the board
+    display_base_board(game->ui);
 
     switch (cmd_choice)
     {
@@ -454,7 +584,25 @@ int open_command_mode(struct game_controller *game)
             store_capture(game->state);
             break;
         case CMD_RESTORE_CAPTURE:
-            restore_capture(game->state);
+            restore_capture(game->state, select_capture(game));
+            break;
+        case CMD_EARLIER_STATE:
+            undo_jump(game->state, UNDO_JUMP_EARLIER);
+            break;
+        case CMD_LATER_STATE:
+            undo_jump(game->state, UNDO_JUMP_LATER);
+            break;
+        case CMD_OLDEST_STATE:
+            undo_jump(game->state, UNDO_JUMP_OLDEST);
+            break;
+        case CMD_NEWEST_STATE:
+            undo_jump(game->state, UNDO_JUMP_NEWEST);
+            break;
+        case CMD_GOTO_MOVE:
+            goto_move(game);
+            break;
+        case CMD_CELL_MODE:
+            switch_cell_mode(game);
             break;
         case CMD_SAVE:
             game_state_save(game->state);
@@ -470,3 +618,94 @@ int open_command_mode(struct game_controller *game)
     }
     return 0;
 }
+
+int select_capture(struct game_controller *game)
+{
+    const struct capture_set *cs = game->state->captures;
+    if (cs->n_slots == 0)
+    {
+        display_notification("No capture yet");
+        display_base_board(game->ui);
+        return MENU_NOT_SELECTED;
+    }
+
+    char *choices[cs->n_slots];
+    char *descriptions[cs->n_slots];
+    for (int i = 0; i < cs->n_slots; i++)
+    {
+        const struct capture *capt = &cs->slots[cs->n_slots - 1 - i];
+        choices[i]      = (char *)capt->name;
+        descriptions[i] = (char *)capt->desc;
+    }
+
+    struct menu_param param =
+    {
+        .title = "RESTORE CAPTURE",
+        .choices = choices,
+        .n_choices = cs->n_slots,
+        .descriptions = descriptions,
+        .start = {0, 0},
+        .size = {0, 0}
+    };
+
+    struct menu_config config = menu_config_default;
+    struct menu_set *mset = menu_set_create(&param);
+    ALLOC_CHECK_RETURN(mset, MENU_NOT_SELECTED);
+    menu_set_configure(mset, config);
+
+    int selected = menu_set_get_user_choice(mset);
+    menu_set_destroy(mset);
+    display_base_board(game->ui);
+
+    if (selected == MENU_NOT_SELECTED)
+    {
+        return MENU_NOT_SELECTED;
+    }
+    return cs->n_slots - 1 - selected;
+}
+
+void goto_move(struct game_controller *game)
+{
+    char msg[64];
+    snprintf(msg, sizeof(msg), "Go to move (now %u): ",
+             undo_current_move(game->state));
+
+    long move;
+    if (prompt_number(msg, UINT32_MAX, &move)
+        && undo_goto(game->state, move) < 0)
+    {
+        display_notification("Move not in the undo history");
+    }
+    display_base_board(game->ui);
+}
+
+int get_resize_wait_ms(const struct game_controller *game)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    double waited_ms = elapsed_us(game->resize_time, now) / 1000.0;
+    return MAX(0, RESIZE_DEBOUNCE_MS - (int)waited_ms);
+}
+
+void relayout(struct game_controller *game)
+{
+    game->resize_pending = false;
+
+    resize_screen();
+    LOGF(LOG_DEBUG, "Relayout for %dx%d", LINES, COLS);
+    game_ui_set_windows(game->ui);
+    display_base_board(game->ui);
+}
+
+void switch_cell_mode(struct game_controller *game)
+{
+    // Boxed mode is always available
+    enum cell_mode mode = game->ui->cell_mode;
+    do
+    {
+        mode = (mode + 1) % CELL_MODE_N;
+    } while (game_ui_set_cell_mode(game->ui, mode) != 0);
+
+    display_base_board(game->ui);
+}
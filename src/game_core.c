@@ -1,49 +1,210 @@
 #include "game_core.h"
+#include "capture_set.h"
 #include "config.h"
 #include "puzzle.h"
+#include "save.h"
+#include "undo_history.h"
 #include "utils.h"
 #include <string.h>
 
-#define UNDO_LIMIT 1024 // Should be power of 2
-#define UNDO_NEXT_INDEX(i) (((i) + 1) & (UNDO_LIMIT - 1))
-#define UNDO_PREV_INDEX(i) (((i) - 1) & (UNDO_LIMIT - 1))
+// Cell entry of an UNDO_DELTA_CELLS record: cell index, then plane bits
+#define UNDO_CELL_ENTRY(index, planes) ((uint32_t)(index) << BB_N_PLANES \
+                                        | (planes))
+#define UNDO_CELL_INDEX(entry)  ((entry) >> BB_N_PLANES)
+#define UNDO_CELL_PLANES(entry) ((entry) & ((1U << BB_N_PLANES) - 1))
 
-#define UNDO_ENTRY_UNMODIFIED 0
+/* Bit planes set for each cell state */
+static const unsigned cell_state_planes[] =
+{
+    [CELL_EMPTY]        = 0,
+    [CELL_FILLED]       = 1 << BB_PLANE_FILL,
+    [CELL_XMARKED]      = 1 << BB_PLANE_XMARK,
+    [CELL_TEMP_FILLED]  = 1 << BB_PLANE_FILL  | 1 << BB_PLANE_TEMP,
+    [CELL_TEMP_XMARKED] = 1 << BB_PLANE_XMARK | 1 << BB_PLANE_TEMP,
+};
+
+enum undo_delta_kind
+{
+    UNDO_DELTA_AREA,  // Plane words of a rectangle of row line words
+    UNDO_DELTA_CELLS, // 4 byte cell entries, zero entries are padding
+};
 
-struct undo_entry 
+/**
+ * Undo record of one operation, the planes it flipped: old ^ new.
+ *  - The same record undoes and redoes the operation.
+ *  - Kept in whichever form is smaller.
+ */
+struct undo_delta
 {
-    struct cell cell;
-    enum cell_state state;
-    int n_modified;
+    uint8_t kind;           // enum undo_delta_kind
+    uint8_t row_start;      // UNDO_DELTA_AREA: rows covered
+    uint8_t n_rows;
+    uint8_t word_start : 4; // and words covered in each row line
+    uint8_t n_words    : 4;
+    // Followed by the cell entries, or by 4 bytes of padding and the word
+    // (r, w) of plane p at (r * n_words + w) * BB_N_PLANES + p
 };
 
-struct undo_queue 
+#if MAX_PZ_N_ROWS > UINT8_MAX || BB_N_WORDS(MAX_PZ_N_COLS) > 15
+#error "Board too large for struct undo_delta"
+#endif
+
+// Delta and padding, the plane words stay 8-byte aligned
+#define UNDO_AREA_HEADER_SIZE sizeof(uint64_t)
+
+/**
+ * Planes of the area an operation may change, saved before it runs.
+ */
+struct undo_pending
 {
-    int head, tail;
-    struct undo_entry data[UNDO_LIMIT];
-}; 
+    int row_start, n_rows;
+    int word_start, n_words;
+    uint64_t *planes; // Same layout as an UNDO_DELTA_AREA record
+    size_t cap;       // Words allocated
+    bool active;
+};
+
+/**
+ * Board state in the undo tree, one undo history record each.
+ *  - Moves made after an undo start a new branch, the old one is kept.
+ *  - Its id in the history is the move number, 0 is the start.
+ */
+struct undo_node
+{
+    struct undo_node *parent;     // NULL at the start of the history
+    struct undo_node *redo_child; // Where redo() goes, NULL if nowhere
+    uint32_t parent_id;           // parent is gone once the history drops it
+    uint32_t depth;               // Moves from the start
+    // Followed by the board snapshot if depth is a multiple of
+    // UNDO_SNAPSHOT_INTERVAL, then by the struct undo_delta from the parent
+};
+
+struct undo_tree
+{
+    struct undo_history *history;
+    struct undo_node *current; // Node of the board as it is
+    uint32_t current_id;
+    size_t snapshot_size;      // Bytes, row line words of every plane
+    struct undo_pending pending;
+};
+
+
+/* Function prototypes */
+
+/**
+ * @return Undo tree whose start is the board as it is now
+ */
+struct undo_tree *undo_tree_create(const struct game_state *gs);
+void undo_tree_destroy(struct undo_tree *t);
+
+/**
+ * Push a node for the move just made on the board, as a child of the
+ * current node, and make it current.
+ *  - A board snapshot is taken every UNDO_SNAPSHOT_INTERVAL moves.
+ * @return Delta of delta_size bytes to fill, NULL if allocation failed
+ */
+struct undo_delta *undo_node_push(struct game_state *gs, size_t delta_size);
+
+bool undo_node_has_snapshot(const struct undo_node *node);
+
+/**
+ * @param size Set to the bytes of the delta, zero padding included
+ */
+struct undo_delta *undo_node_delta(const struct undo_tree *t,
+                                   const struct undo_node *node, size_t *size);
+
+/**
+ * @return Parent of the node, NULL if none or no longer kept
+ */
+struct undo_node *undo_node_parent(const struct undo_tree *t,
+                                   const struct undo_node *node);
+
+/**
+ * Try undo_goto() from move `move` on, a step at a time, until a move that
+ * can still be reached.
+ */
+bool undo_goto_nearest(struct game_state *gs, uint32_t move, int step);
+
+/**
+ * Start recording an operation that changes cells in [start, end] only.
+ *  - The planes of the area are saved, cells are then changed with
+ *    set_cell_state_internal() and undo_record_end() pushes the record.
+ */
+void undo_record_begin(struct game_state *gs, struct cell start, struct cell end);
+
+/**
+ * Push the planes that changed as an undo record, in the smaller form,
+ * nothing is pushed if no cell changed.
+ */
+void undo_record_end(struct game_state *gs);
+
+/**
+ * Push a single cell change, without saving an area first.
+ * @param planes Bit p set if plane p flipped
+ */
+void undo_push_cell(struct game_state *gs, struct cell cell, unsigned planes);
+
+/**
+ * Flip the planes of the record on the board.
+ *  - Area records are applied a word at a time.
+ */
+void undo_delta_apply(struct game_state *gs, const struct undo_delta *delta,
+                      size_t size);
+
+/**
+ * @param words Row line words of every plane, see struct undo_delta
+ */
+void undo_snapshot_take(const struct game_state *gs, uint64_t *words);
+void undo_snapshot_restore(struct game_state *gs, const uint64_t *words);
+
+/**
+ * Write a rectangle of row line words on the board, mark the changed cells
+ * and re-validate the lines whose filled cells changed.
+ * @param words Layout of an UNDO_DELTA_AREA record
+ * @param flip  Words are planes to flip if true, the new planes otherwise
+ */
+void board_write_area(struct game_state *gs, int row_start, int n_rows,
+                      int word_start, int n_words,
+                      const uint64_t *words, bool flip);
 
+/**
+ * Set cell's state to new_state, update the line cache and change set.
+ *  - No undo record, see undo_record_begin()
+ * @return State before the change
+ */
+enum cell_state set_cell_state_internal(struct game_state *gs, 
+                                        struct cell curr, 
+                                        enum cell_state new_state);
 
-/* Function prototypes */ 
+struct bitboard *board_create(const struct puzzle *pz);
 
-struct undo_queue *undo_queue_create(void);
-void undo_queue_destroy(struct undo_queue *q);
-void undo_queue_push(struct undo_queue *q, struct undo_entry entry);
+void line_cache_create(struct game_state *gs);
+void line_cache_destroy(struct game_state *gs);
 
 /**
- * Set cell's state to new_state, push undo entry if modified
- *  - Multiple function calls with same modified_cnt addr will be backtracked 
- *    with a single undo/redo operation
- *
- * @param modified_cnt addr of modified counter
- *  - Must be Initialized with UNDO_ENTRY_UNMODIFIED
- *  - NULL if undo entry is not needed
+ * Re-validate a single line and update the cached status.
  */
-void set_cell_state_internal(struct game_state *gs, 
-                             struct cell curr, enum cell_state new_state,
-                             int *modified_cnt);
+void line_cache_update(struct game_state *gs, enum axis axis, int idx);
+void line_cache_update_all(struct game_state *gs);
 
-enum cell_state **board_state_create(const struct puzzle *pz);
+void change_set_create(struct game_state *gs);
+void change_set_destroy(struct game_state *gs);
+void change_set_mark_cell(struct game_state *gs, struct cell cell);
+void change_set_mark_line(struct game_state *gs, enum axis axis, int idx);
+
+/**
+ * @param planes Bit p set if the cell is set on plane p
+ */
+enum cell_state cell_state_from_planes(unsigned planes);
+enum cell_state board_get_cell(const struct bitboard *bb, struct cell cell);
+void board_put_cell(struct bitboard *bb, struct cell cell, enum cell_state state);
+
+/**
+ * Get the line of cells in CELL_FILLED state, temporary fills excluded.
+ * @param out Must hold bitboard_line_words() words
+ */
+void board_filled_line(const struct bitboard *bb, enum axis axis, int idx,
+                       uint64_t *out);
 
 /* Public */
 
@@ -55,9 +216,12 @@ struct game_state *game_state_create(const struct puzzle *pz)
     ALLOC_CHECK_EXIT(gs);
 
     gs->puzzle        = pz;
-    gs->board_state   = board_state_create(pz);
-    gs->board_capture = NULL;
-    gs->undo_queue    = undo_queue_create();
+    gs->board         = board_create(pz);
+    gs->captures      = capture_set_create(gs->board, CAPTURE_MAX_SLOTS);
+    ALLOC_CHECK_EXIT(gs->captures);
+    gs->undo_tree     = undo_tree_create(gs);
+    change_set_create(gs);
+    line_cache_create(gs);
     return gs;
 }
 
@@ -65,9 +229,12 @@ void game_state_destroy(struct game_state *gs)
 {
     if (gs != NULL)
     {
-        undo_queue_destroy(gs->undo_queue);
-        free2d((void **)gs->board_capture, gs->puzzle->n_rows);
-        free2d((void **)gs->board_state, gs->puzzle->n_rows);
+        LOGF(LOG_DEBUG, "Undo history: %zu bytes", undo_bytes_in_use(gs));
+        line_cache_destroy(gs);
+        change_set_destroy(gs);
+        undo_tree_destroy(gs->undo_tree);
+        capture_set_destroy(gs->captures);
+        bitboard_destroy(gs->board);
     }
     free(gs); gs = NULL;
 }
@@ -75,18 +242,22 @@ void game_state_destroy(struct game_state *gs)
 void set_cell_state(struct game_state *gs, 
                     struct cell cell, enum cell_state new_state)
 {
-    int modified_cnt = UNDO_ENTRY_UNMODIFIED;
-    set_cell_state_internal(gs, cell, new_state, &modified_cnt);
+    enum cell_state old_state = set_cell_state_internal(gs, cell, new_state);
+    if (old_state != new_state)
+    {
+        undo_push_cell(gs, cell, cell_state_planes[old_state] 
+                                 ^ cell_state_planes[new_state]);
+    }
 }
 
 enum cell_state get_cell_state(const struct game_state *gs, struct cell cell)
 {
     assert(gs != NULL);
-    assert(gs->board_state != NULL);
+    assert(gs->board != NULL);
     assert(cell.row >= 0 && cell.row < gs->puzzle->n_rows);
     assert(cell.col >= 0 && cell.col < gs->puzzle->n_cols);
 
-    return gs->board_state[cell.row][cell.col];
+    return board_get_cell(gs->board, cell);
 }
 
 void toggle_cell_state(struct game_state *gs, 
@@ -100,22 +271,23 @@ void set_area_state(struct game_state *gs,
                     struct cell start, struct cell end, 
                     enum cell_state new_state)
 {
-    int modified_cnt = UNDO_ENTRY_UNMODIFIED;
+    undo_record_begin(gs, start, end);
     struct cell curr;
     for (curr.row = start.row; curr.row <= end.row; curr.row++)
     {
         for (curr.col = start.col; curr.col <= end.col; curr.col++)
         {
-            set_cell_state_internal(gs, curr, new_state, &modified_cnt);
+            set_cell_state_internal(gs, curr, new_state);
         }
     }
+    undo_record_end(gs);
 }
 
 void set_area_if_empty(struct game_state *gs, 
                        struct cell start, struct cell end, 
                        enum cell_state new_state)
 {
-    int modified_cnt = UNDO_ENTRY_UNMODIFIED;
+    undo_record_begin(gs, start, end);
     struct cell curr;
     for (curr.row = start.row; curr.row <= end.row; curr.row++)
     {
@@ -123,33 +295,37 @@ void set_area_if_empty(struct game_state *gs,
         {
             if (get_cell_state(gs, curr) == CELL_EMPTY)
             {
-                set_cell_state_internal(gs, curr, new_state, &modified_cnt);
+                set_cell_state_internal(gs, curr, new_state);
             }
         }
     }
+    undo_record_end(gs);
 }
 
 void delete_temp_marks(struct game_state *gs)
 {
     struct cell curr;
-    int modified_cnt = UNDO_ENTRY_UNMODIFIED;
+    int n_cols = gs->puzzle->n_cols;
+    undo_record_begin(gs, (struct cell){0, 0}, 
+                      (struct cell){gs->puzzle->n_rows - 1, n_cols - 1});
     for (curr.row = 0; curr.row < gs->puzzle->n_rows; curr.row++)
     {
-        for (curr.col = 0; curr.col < gs->puzzle->n_cols; curr.col++)
+        const uint64_t *temp = bitboard_line(gs->board, BB_PLANE_TEMP,
+                                             AXIS_ROW, curr.row);
+        curr.col = bitline_next_set(temp, n_cols, 0);
+        while (curr.col < n_cols)
         {
-            if (get_cell_state(gs, curr) == CELL_TEMP_FILLED
-                || get_cell_state(gs, curr) == CELL_TEMP_XMARKED)
-            {
-                set_cell_state_internal(gs, curr, CELL_EMPTY, &modified_cnt);
-            }
+            set_cell_state_internal(gs, curr, CELL_EMPTY);
+            curr.col = bitline_next_set(temp, n_cols, curr.col + 1);
         }
     }
+    undo_record_end(gs);
 }
 
 void switch_case(struct game_state *gs, struct cell start, struct cell end)
 {
     struct cell curr;
-    int modified_cnt = UNDO_ENTRY_UNMODIFIED;
+    undo_record_begin(gs, start, end);
     for (curr.row = start.row; curr.row <= end.row; curr.row++)
     {
         for (curr.col = start.col; curr.col <= end.col; curr.col++)
@@ -172,9 +348,10 @@ void switch_case(struct game_state *gs, struct cell start, struct cell end)
                 default:
                     continue;
             }
-            set_cell_state_internal(gs, curr, new_state, &modified_cnt);
+            set_cell_state_internal(gs, curr, new_state);
         }
     }
+    undo_record_end(gs);
 }
 
 void clear_board(struct game_state *gs)
@@ -186,124 +363,249 @@ void clear_board(struct game_state *gs)
 
 void auto_xmark(struct game_state *gs)
 {
-    int n_modified = 0;
-    struct cell curr;
+    undo_record_begin(gs, (struct cell){0, 0}, 
+                      (struct cell){gs->puzzle->n_rows - 1, 
+                                    gs->puzzle->n_cols - 1});
 
-    for (curr.row = 0; curr.row < gs->puzzle->n_rows; curr.row++)
+    for (enum axis axis = AXIS_ROW; axis <= AXIS_COL; axis++)
     {
-        if (validate_axis(gs, AXIS_ROW, curr.row))
+        int n_lines  = (axis == AXIS_ROW) ? gs->puzzle->n_rows 
+                                          : gs->puzzle->n_cols;
+        int line_len = bitboard_line_len(gs->board, axis);
+        int n_words  = bitboard_line_words(gs->board, axis);
+
+        for (int i = 0; i < n_lines; i++)
         {
-            for (curr.col = 0; curr.col < gs->puzzle->n_cols; curr.col++)
+            if (!is_axis_solved(gs, axis, i))
             {
-                if (get_cell_state(gs, curr) == CELL_EMPTY)
-                {
-                    set_cell_state_internal(gs, curr, CELL_XMARKED, &n_modified);
-                }
+                continue;
             }
-        }
-    }
 
-    for (curr.col = 0; curr.col < gs->puzzle->n_cols; curr.col++)
-    {
-        if (validate_axis(gs, AXIS_COL, curr.col))
-        {
-            for (curr.row = 0; curr.row < gs->puzzle->n_rows; curr.row++)
+            // Empty cells: neither filled nor marked (temp marks included)
+            const uint64_t *fill  = bitboard_line(gs->board, BB_PLANE_FILL, 
+                                                  axis, i);
+            const uint64_t *xmark = bitboard_line(gs->board, BB_PLANE_XMARK,
+                                                  axis, i);
+            uint64_t empty[BB_MAX_LINE_WORDS];
+            for (int w = 0; w < n_words; w++)
             {
-                if (get_cell_state(gs, curr) == CELL_EMPTY)
-                {
-                    set_cell_state_internal(gs, curr, CELL_XMARKED, &n_modified);
-                }
+                empty[w] = ~(fill[w] | xmark[w]) & bitline_word_mask(line_len, w);
+            }
+
+            int pos = bitline_next_set(empty, line_len, 0);
+            while (pos < line_len)
+            {
+                struct cell curr = (axis == AXIS_ROW) ? (struct cell){i, pos}
+                                                      : (struct cell){pos, i};
+                set_cell_state_internal(gs, curr, CELL_XMARKED);
+                pos = bitline_next_set(empty, line_len, pos + 1);
             }
         }
     }
+    undo_record_end(gs);
 }
 
-void store_capture(struct game_state *gs)
+int store_capture(struct game_state *gs)
 {
     assert(gs != NULL);
-    if (gs->board_capture == NULL)
+
+    char desc[CAPTURE_NAME_LEN];
+    snprintf(desc, sizeof(desc), "Move %u", undo_current_move(gs));
+    return capture_set_store(gs->captures, gs->board, desc);
+}
+
+void restore_capture(struct game_state *gs, int slot)
+{
+    assert(gs != NULL);
+    if (slot < 0 || slot >= gs->captures->n_slots)
     {
-        gs->board_capture = board_state_create(gs->puzzle);
+        return;
     }
 
-    for (int i = 0; i < gs->puzzle->n_rows; i++)
+    // Rows gathered in one area, only the words that differ are written
+    int n_rows  = gs->puzzle->n_rows;
+    int n_words = gs->board->row_words;
+    size_t row_size = (size_t)n_words * BB_N_PLANES * sizeof(uint64_t);
+    uint64_t *words = malloc(n_rows * row_size);
+    if (words == NULL)
     {
-        for (int j = 0; j < gs->puzzle->n_cols; j++)
-        {
-            gs->board_capture[i][j] = gs->board_state[i][j];
-        }
+        LOG(LOG_ERROR, "Memory allocation failed");
+        return;
+    }
+    for (int r = 0; r < n_rows; r++)
+    {
+        memcpy((char *)words + r * row_size, 
+               capture_set_row(gs->captures, slot, r), row_size);
     }
+
+    undo_record_begin(gs, (struct cell){0, 0}, 
+                      (struct cell){n_rows - 1, gs->puzzle->n_cols - 1});
+    board_write_area(gs, 0, n_rows, 0, n_words, words, false);
+    undo_record_end(gs);
+    capture_set_restored(gs->captures, slot);
+
+    free(words);
 }
 
-void restore_capture(struct game_state *gs)
+bool undo(struct game_state *gs)
 {
     assert(gs != NULL);
-    if (gs->board_capture == NULL)
+    assert(gs->undo_tree != NULL);
+
+    struct undo_tree *t = gs->undo_tree;
+    struct undo_node *parent = undo_node_parent(t, t->current);
+    if (parent == NULL)
     {
-        return;
+        return false;
     }
 
-    struct cell curr;
-    int n_modified = UNDO_ENTRY_UNMODIFIED;
+    size_t size;
+    const struct undo_delta *delta = undo_node_delta(t, t->current, &size);
+    undo_delta_apply(gs, delta, size);
 
-    for (curr.row = 0; curr.row < gs->puzzle->n_rows; curr.row++)
+    parent->redo_child = t->current;
+    t->current_id      = t->current->parent_id;
+    t->current         = parent;
+    return true;
+}
+
+bool redo(struct game_state *gs)
+{
+    assert(gs != NULL);
+    assert(gs->undo_tree != NULL);
+
+    // A child is newer than its parent, it's kept as long as the parent is
+    struct undo_tree *t = gs->undo_tree;
+    struct undo_node *child = t->current->redo_child;
+    if (child == NULL)
     {
-        for (curr.col = 0; curr.col < gs->puzzle->n_cols; curr.col++)
-        {
-            set_cell_state_internal(gs, curr, 
-                                    gs->board_capture[curr.row][curr.col], 
-                                    &n_modified);
-        }
+        return false;
     }
 
+    size_t size;
+    const struct undo_delta *delta = undo_node_delta(t, child, &size);
+    undo_delta_apply(gs, delta, size);
+
+    t->current    = child;
+    t->current_id = undo_history_id(child);
+    return true;
 }
 
-void undo(struct game_state *gs)
+int undo_goto(struct game_state *gs, uint32_t move)
 {
     assert(gs != NULL);
-    assert(gs->undo_queue != NULL);
+    assert(gs->undo_tree != NULL);
+
+    struct undo_tree *t = gs->undo_tree;
+    struct undo_node *target = undo_history_get(t->history, move);
+    if (target == NULL)
+    {
+        return -1;
+    }
 
-    struct undo_queue *q = gs->undo_queue;
+    // Next to the current node, a single delta does it
+    if (target == t->current)
+    {
+        return 0;
+    }
+    if (target == undo_node_parent(t, t->current))
+    {
+        undo(gs);
+        return 1;
+    }
+    if (undo_node_parent(t, target) == t->current)
+    {
+        t->current->redo_child = target;
+        redo(gs);
+        return 1;
+    }
 
-    struct undo_entry curr_entry = q->data[UNDO_PREV_INDEX(q->tail)];
-    int n_undo = curr_entry.n_modified;
-    while (n_undo-- > 0 && q->head != q->tail)
+    // Nodes from the target up to the nearest snapshot, excluded
+    struct undo_node *path[UNDO_SNAPSHOT_INTERVAL];
+    int n_path = 0;
+    struct undo_node *node = target;
+    while (!undo_node_has_snapshot(node))
     {
-        q->tail = UNDO_PREV_INDEX(q->tail);
-        curr_entry = q->data[q->tail];
+        path[n_path++] = node;
+        node = undo_node_parent(t, node);
+        if (node == NULL)
+        {
+            return -1;
+        }
+    }
 
-        // Store current state for redo
-        q->data[q->tail].state = get_cell_state(gs, curr_entry.cell);
-        set_cell_state_internal(gs, curr_entry.cell, curr_entry.state, NULL);
+    struct undo_node *snapshot_node = node;
+    undo_snapshot_restore(gs, (const uint64_t *)(node + 1));
+    for (int i = n_path - 1; i >= 0; i--)
+    {
+        size_t size;
+        const struct undo_delta *delta = undo_node_delta(t, path[i], &size);
+        undo_delta_apply(gs, delta, size);
+        node->redo_child = path[i];
+        node             = path[i];
     }
+
+    // Redo follows the branch of the target from further up too, up to
+    // where it already does
+    node = snapshot_node;
+    struct undo_node *parent = undo_node_parent(t, node);
+    while (parent != NULL && parent->redo_child != node)
+    {
+        parent->redo_child = node;
+        node   = parent;
+        parent = undo_node_parent(t, node);
+    }
+
+    t->current    = target;
+    t->current_id = move;
+    return n_path;
 }
 
-void redo(struct game_state *gs)
+bool undo_jump(struct game_state *gs, enum undo_jump jump)
 {
     assert(gs != NULL);
-    assert(gs->undo_queue != NULL);
+    assert(gs->undo_tree != NULL);
 
-    struct undo_queue *q = gs->undo_queue;
+    const struct undo_tree *t = gs->undo_tree;
+    switch (jump)
+    {
+        case UNDO_JUMP_EARLIER:
+            return undo_goto_nearest(gs, t->current_id - 1, -1);
+        case UNDO_JUMP_LATER:
+            return undo_goto_nearest(gs, t->current_id + 1, 1);
+        case UNDO_JUMP_OLDEST:
+            return undo_goto_nearest(gs, t->history->first_id, 1);
+        case UNDO_JUMP_NEWEST:
+            return undo_goto_nearest(gs, t->history->end_id - 1, -1);
+    }
+    return false;
+}
 
-    struct undo_entry next_entry = q->data[q->tail];
-    int n_modified = 0;
+uint32_t undo_current_move(const struct game_state *gs)
+{
+    assert(gs != NULL);
+    return gs->undo_tree->current_id;
+}
 
-    // Redo until n_modified stops increasing
-    while (next_entry.n_modified > n_modified)
-    {
-        // Store current state for undo
-        q->data[q->tail].state = get_cell_state(gs, next_entry.cell);
-        set_cell_state_internal(gs, next_entry.cell, next_entry.state, NULL);
+size_t undo_bytes_in_use(const struct game_state *gs)
+{
+    assert(gs != NULL);
 
-        n_modified = next_entry.n_modified;
-        q->tail = UNDO_NEXT_INDEX(q->tail);
-        next_entry = q->data[q->tail];
+    const struct undo_tree *t = gs->undo_tree;
+    return sizeof(struct undo_tree) + t->pending.cap * sizeof(uint64_t)
+           + sizeof(struct undo_history) + undo_history_bytes(t->history);
+}
 
-        if (q->tail == q->head)
-        {
-            break;
-        }
+void clear_changes(struct game_state *gs)
+{
+    assert(gs != NULL);
+    if (!gs->changes.any)
+    {
+        return;
     }
+
+    memset(gs->changes.cells, 0, gs->changes.n_words * sizeof(uint64_t));
+    gs->changes.any = false;
 }
 
 bool validate_axis(const struct game_state *gs, enum axis axis, int idx)
@@ -312,187 +614,647 @@ bool validate_axis(const struct game_state *gs, enum axis axis, int idx)
                     ? gs->puzzle->row_clues[idx] 
                     : gs->puzzle->col_clues[idx];
 
-    int curr_clue_idx = axis == AXIS_ROW 
-                        ? get_row_clueline_size(gs->puzzle) - 1
-                        : get_col_clueline_size(gs->puzzle) - 1;
-    struct cell curr = 
+    int clueline_size = axis == AXIS_ROW 
+                        ? get_row_clueline_size(gs->puzzle)
+                        : get_col_clueline_size(gs->puzzle);
+
+    uint64_t filled[BB_MAX_LINE_WORDS];
+    board_filled_line(gs->board, axis, idx, filled);
+
+    return bitline_matches_clues(filled, bitboard_line_len(gs->board, axis),
+                                 clueline, clueline_size);
+}
+
+void game_state_save(const struct game_state *gs)
+{
+    assert(gs != NULL);
+
+    const struct puzzle *pz = gs->puzzle;
+
+    // Board state, one cell_state value per cell
+    uint8_t *cells = malloc(pz->n_rows * pz->n_cols);
+    if (cells == NULL)
     {
-        .row = (axis == AXIS_ROW) ? idx : gs->puzzle->n_rows - 1,
-        .col = (axis == AXIS_ROW) ? gs->puzzle->n_cols - 1 : idx
-    };
+        LOG(LOG_ERROR, "Memory allocation failed");
+        return;
+    }
 
-    int run_length;
-    while (curr_clue_idx >= 0)
+    struct cell curr;
+    for (curr.row = 0; curr.row < pz->n_rows; curr.row++)
     {
-        run_length = 0;
-        while (curr.row >= 0 && curr.col >= 0
-               && get_cell_state(gs, curr) != CELL_FILLED)
+        for (curr.col = 0; curr.col < pz->n_cols; curr.col++)
         {
-            curr.row -= (axis == AXIS_COL);
-            curr.col -= (axis == AXIS_ROW);
+            cells[curr.row * pz->n_cols + curr.col] = get_cell_state(gs, curr);
         }
+    }
 
-        while (curr.row >= 0 && curr.col >= 0
-               && get_cell_state(gs, curr) == CELL_FILLED)
-        {
-            run_length++;
-            curr.row -= (axis == AXIS_COL);
-            curr.col -= (axis == AXIS_ROW);
-        }
+    if (save_write(SAVE_FILE_NAME, pz, cells) != 0)
+    {
+        LOGF(LOG_WARNING, "Failed to save game: %s", SAVE_FILE_NAME);
+    }
+    free(cells);
+}
+
+int game_state_load_save(struct game_state *gs)
+{
+    uint8_t *cells = malloc(gs->puzzle->n_rows * gs->puzzle->n_cols);
+    ALLOC_CHECK_RETURN(cells, -1);
+
+    if (save_load_cells(SAVE_FILE_NAME, gs->puzzle, cells) != 0)
+    {
+        LOG(LOG_WARNING, "Failed to read board state from file");
+        free(cells);
+        return -1;
+    }
 
-        if (run_length != clueline[curr_clue_idx])
+    struct cell curr;
+    for (curr.row = 0; curr.row < gs->puzzle->n_rows; curr.row++)
+    {
+        for (curr.col = 0; curr.col < gs->puzzle->n_cols; curr.col++)
         {
-            return false;
+            enum cell_state state = cells[curr.row * gs->puzzle->n_cols + curr.col];
+            if (state > CELL_TEMP_XMARKED)
+            {
+                LOGF(LOG_WARNING, "Invalid cell state in save file: %d", state);
+                state = CELL_EMPTY;
+            }
+            board_put_cell(gs->board, curr, state);
+            change_set_mark_cell(gs, curr);
+            capture_set_mark_row(gs->captures, curr.row);
         }
+    }
+    line_cache_update_all(gs);
 
-        curr_clue_idx--;
+    // The loaded board is the start of the history
+    undo_tree_destroy(gs->undo_tree);
+    gs->undo_tree = undo_tree_create(gs);
+
+    free(cells);
+    return 0;
+}
+
+struct undo_tree *undo_tree_create(const struct game_state *gs)
+{
+    struct undo_tree *t = calloc(1, sizeof(struct undo_tree));
+    ALLOC_CHECK_EXIT(t);
+
+    t->history = undo_history_create(UNDO_MEMORY_CAP);
+    ALLOC_CHECK_EXIT(t->history);
+
+    t->snapshot_size = (size_t)gs->puzzle->n_rows 
+                       * bitboard_line_words(gs->board, AXIS_ROW) 
+                       * BB_N_PLANES * sizeof(uint64_t);
+
+    // The start has no parent, no delta, and a snapshot
+    t->current = undo_history_push(t->history, sizeof(struct undo_node) 
+                                               + t->snapshot_size);
+    ALLOC_CHECK_EXIT(t->current);
+    *t->current   = (struct undo_node){0};
+    t->current_id = undo_history_id(t->current);
+    undo_snapshot_take(gs, (uint64_t *)(t->current + 1));
+    return t;
+}
+
+void undo_tree_destroy(struct undo_tree *t)
+{
+    if (t != NULL)
+    {
+        undo_history_destroy(t->history);
+        free(t->pending.planes);
     }
+    free(t); t = NULL;
+}
 
-    return true;
+struct undo_delta *undo_node_push(struct game_state *gs, size_t delta_size)
+{
+    struct undo_tree *t = gs->undo_tree;
+
+    // The current node may be dropped by the push
+    uint32_t depth = t->current->depth + 1;
+    size_t snapshot_size = (depth % UNDO_SNAPSHOT_INTERVAL == 0) 
+                           ? t->snapshot_size : 0;
+
+    struct undo_node *node = undo_history_push(t->history, 
+                                               sizeof(struct undo_node) 
+                                               + snapshot_size + delta_size);
+    if (node == NULL)
+    {
+        return NULL;
+    }
+
+    node->parent     = NULL;
+    node->redo_child = NULL;
+    node->parent_id  = t->current_id;
+    node->depth      = depth;
+    if (undo_history_has(t->history, t->current_id))
+    {
+        node->parent           = t->current;
+        t->current->redo_child = node;
+    }
+    if (snapshot_size > 0)
+    {
+        undo_snapshot_take(gs, (uint64_t *)(node + 1));
+    }
+
+    t->current    = node;
+    t->current_id = undo_history_id(node);
+    return (struct undo_delta *)((char *)(node + 1) + snapshot_size);
 }
 
-bool game_solved(const struct game_state *gs)
+bool undo_node_has_snapshot(const struct undo_node *node)
 {
-    for (int i = 0; i < gs->puzzle->n_rows; i++)
+    return node->depth % UNDO_SNAPSHOT_INTERVAL == 0;
+}
+
+struct undo_delta *undo_node_delta(const struct undo_tree *t,
+                                   const struct undo_node *node, size_t *size)
+{
+    size_t offset = sizeof(struct undo_node) 
+                    + (undo_node_has_snapshot(node) ? t->snapshot_size : 0);
+
+    *size = undo_history_size(node) - offset;
+    return (struct undo_delta *)((char *)node + offset);
+}
+
+struct undo_node *undo_node_parent(const struct undo_tree *t,
+                                   const struct undo_node *node)
+{
+    if (node->parent == NULL || !undo_history_has(t->history, node->parent_id))
+    {
+        return NULL;
+    }
+    return node->parent;
+}
+
+bool undo_goto_nearest(struct game_state *gs, uint32_t move, int step)
+{
+    while (undo_history_has(gs->undo_tree->history, move))
     {
-        if (!validate_axis(gs, AXIS_ROW, i))
+        if (undo_goto(gs, move) >= 0)
         {
-            return false;
+            return true;
         }
+        move += step;
     }
+    return false;
+}
 
-    for (int j = 0; j < gs->puzzle->n_cols; j++)
+void undo_record_begin(struct game_state *gs, struct cell start, struct cell end)
+{
+    assert(gs != NULL);
+    assert(start.row <= end.row && start.col <= end.col);
+
+    struct undo_pending *pending = &gs->undo_tree->pending;
+    assert(!pending->active);
+
+    pending->row_start  = start.row;
+    pending->n_rows     = end.row - start.row + 1;
+    pending->word_start = start.col / BB_WORD_BITS;
+    pending->n_words    = end.col / BB_WORD_BITS - pending->word_start + 1;
+
+    // Kept between operations, grows to the largest area
+    size_t n_words = (size_t)pending->n_rows * pending->n_words * BB_N_PLANES;
+    if (n_words > pending->cap)
     {
-        if (!validate_axis(gs, AXIS_COL, j))
+        uint64_t *planes = realloc(pending->planes, n_words * sizeof(uint64_t));
+        if (planes == NULL)
         {
-            return false;
+            // The operation still runs, it just can't be undone
+            LOG(LOG_ERROR, "Memory allocation failed");
+            return;
         }
+        pending->planes = planes;
+        pending->cap    = n_words;
     }
 
-    return true;
+    uint64_t *saved = pending->planes;
+    for (int r = 0; r < pending->n_rows; r++)
+    {
+        for (int w = 0; w < pending->n_words; w++)
+        {
+            for (int p = 0; p < BB_N_PLANES; p++)
+            {
+                *saved++ = bitboard_line(gs->board, p, AXIS_ROW, 
+                                         pending->row_start + r)
+                                        [pending->word_start + w];
+            }
+        }
+    }
+    pending->active = true;
 }
 
-void game_state_save(const struct game_state *gs)
+void undo_record_end(struct game_state *gs)
 {
-    assert(gs != NULL);
+    struct undo_pending *pending = &gs->undo_tree->pending;
+    if (!pending->active)
+    {
+        return;
+    }
+    pending->active = false;
+
+    // Planes that flipped, and the bounding rectangle of their words
+    int row_min = pending->n_rows, row_max = -1;
+    int word_min = pending->n_words, word_max = -1;
+    int n_cells = 0;
+    uint64_t *flipped = pending->planes;
+    for (int r = 0; r < pending->n_rows; r++)
+    {
+        for (int w = 0; w < pending->n_words; w++, flipped += BB_N_PLANES)
+        {
+            uint64_t diff = 0;
+            for (int p = 0; p < BB_N_PLANES; p++)
+            {
+                flipped[p] ^= bitboard_line(gs->board, p, AXIS_ROW, 
+                                            pending->row_start + r)
+                                           [pending->word_start + w];
+                diff       |= flipped[p];
+            }
+            if (diff != 0)
+            {
+                n_cells += __builtin_popcountll(diff);
+                row_min  = MIN(row_min, r);
+                row_max  = MAX(row_max, r);
+                word_min = MIN(word_min, w);
+                word_max = MAX(word_max, w);
+            }
+        }
+    }
 
-    FILE *fp = fopen(SAVE_FILE_NAME, "wb");
-    if (fp == NULL)
+    if (row_max < 0)
     {
-        LOGF(LOG_WARNING, "Failed to open file: %s", SAVE_FILE_NAME);
         return;
     }
 
-    // Puzzle 
-    
-    const struct puzzle *pz = gs->puzzle;
+    int n_rows  = row_max - row_min + 1;
+    int n_words = word_max - word_min + 1;
+    size_t area_size  = (size_t)n_rows * n_words * BB_N_PLANES * sizeof(uint64_t);
+    size_t cells_size = (size_t)n_cells * sizeof(uint32_t);
+    bool   as_cells   = cells_size < area_size;
+
+    struct undo_delta *delta = undo_node_push(gs, as_cells 
+                                                  ? sizeof(struct undo_delta) 
+                                                    + cells_size
+                                                  : UNDO_AREA_HEADER_SIZE 
+                                                    + area_size);
+    if (delta == NULL)
+    {
+        LOG(LOG_ERROR, "Memory allocation failed");
+        return;
+    }
 
-    fwrite(pz->title, sizeof(char), MAX_PZ_TITLE_LEN + 1, fp);
-    fwrite(pz->author, sizeof(char), MAX_PZ_AUTHOR_LEN + 1, fp);
-    fwrite(&pz->difficulty, sizeof(int), 1, fp);
-    fwrite(&pz->n_rows, sizeof(int), 1, fp);
-    fwrite(&pz->n_cols, sizeof(int), 1, fp);
+    delta->kind       = as_cells ? UNDO_DELTA_CELLS : UNDO_DELTA_AREA;
+    delta->row_start  = pending->row_start + row_min;
+    delta->n_rows     = n_rows;
+    delta->word_start = pending->word_start + word_min;
+    delta->n_words    = n_words;
 
-    fwrite(pz->row_clues[0], sizeof(int), pz->n_rows * get_row_clueline_size(pz), fp);
-    fwrite(pz->col_clues[0], sizeof(int), pz->n_cols * get_col_clueline_size(pz), fp);
+    uint64_t *words   = (uint64_t *)delta + 1;
+    uint32_t *entries = (uint32_t *)(delta + 1);
+    for (int r = row_min; r <= row_max; r++)
+    {
+        int row = pending->row_start + r;
+        for (int w = word_min; w <= word_max; w++)
+        {
+            flipped = pending->planes + (r * pending->n_words + w) * BB_N_PLANES;
+            if (!as_cells)
+            {
+                memcpy(words, flipped, BB_N_PLANES * sizeof(uint64_t));
+                words += BB_N_PLANES;
+                continue;
+            }
 
-    // Board state
-    fwrite(gs->board_state[0], sizeof(enum cell_state), pz->n_rows * pz->n_cols, fp);
-    
-    fclose(fp);
+            uint64_t diff = 0;
+            for (int p = 0; p < BB_N_PLANES; p++)
+            {
+                diff |= flipped[p];
+            }
+            while (diff != 0)
+            {
+                int bit = __builtin_ctzll(diff);
+                int col = (pending->word_start + w) * BB_WORD_BITS + bit;
+                unsigned planes = 0;
+                for (int p = 0; p < BB_N_PLANES; p++)
+                {
+                    planes |= ((flipped[p] >> bit) & 1) << p;
+                }
+                *entries++ = UNDO_CELL_ENTRY(row * gs->puzzle->n_cols + col, 
+                                             planes);
+                diff &= diff - 1;
+            }
+        }
+    }
 }
 
-int game_state_load_save(struct game_state *gs)
+void undo_push_cell(struct game_state *gs, struct cell cell, unsigned planes)
 {
-    FILE *fp = fopen(SAVE_FILE_NAME, "rb");
-    if (fp == NULL)
+    struct undo_delta *delta = undo_node_push(gs, sizeof(struct undo_delta) 
+                                                  + sizeof(uint32_t));
+    if (delta == NULL)
     {
-        LOGF(LOG_WARNING, "Failed to open file: %s", SAVE_FILE_NAME);
-        return -1;
+        LOG(LOG_ERROR, "Memory allocation failed");
+        return;
     }
 
-    if (!skip_puzzle_from_file(fp, gs->puzzle))
-    {
-        LOG(LOG_WARNING, "Failed to skip puzzle from file");
-        fclose(fp);
-        return -1;
-    }
-    
-    // Read board state
+    *delta = (struct undo_delta){.kind = UNDO_DELTA_CELLS};
+    *(uint32_t *)(delta + 1) = UNDO_CELL_ENTRY(cell.row * gs->puzzle->n_cols 
+                                               + cell.col, planes);
+}
 
-    fread(gs->board_state[0], 
-          sizeof(enum cell_state), gs->puzzle->n_rows * gs->puzzle->n_cols, fp);
+void undo_delta_apply(struct game_state *gs, const struct undo_delta *delta,
+                      size_t size)
+{
+    struct bitboard *bb = gs->board;
 
-    fclose(fp);
+    if (delta->kind == UNDO_DELTA_CELLS)
+    {
+        // Few cells, each one is set on its own
+        const uint32_t *entries = (const uint32_t *)(delta + 1);
+        size_t n_entries = (size - sizeof(struct undo_delta)) / sizeof(uint32_t);
+        for (size_t i = 0; i < n_entries; i++)
+        {
+            unsigned planes = UNDO_CELL_PLANES(entries[i]);
+            if (planes == 0)
+            {
+                continue;
+            }
 
-    return 0;
+            int index = UNDO_CELL_INDEX(entries[i]);
+            struct cell cell = {index / gs->puzzle->n_cols, 
+                                index % gs->puzzle->n_cols};
+            planes ^= cell_state_planes[board_get_cell(bb, cell)];
+            set_cell_state_internal(gs, cell, cell_state_from_planes(planes));
+        }
+        return;
+    }
+
+    board_write_area(gs, delta->row_start, delta->n_rows, 
+                     delta->word_start, delta->n_words, 
+                     (const uint64_t *)delta + 1, true);
 }
 
-struct undo_queue *undo_queue_create(void)
+void undo_snapshot_take(const struct game_state *gs, uint64_t *words)
 {
-    // head, tail and data entry (especially n_modified) initializes to 0
-    struct undo_queue *q = calloc(1, sizeof(struct undo_queue));
-    ALLOC_CHECK_EXIT(q);
-    return q;
+    int n_words = bitboard_line_words(gs->board, AXIS_ROW);
+    for (int row = 0; row < gs->puzzle->n_rows; row++)
+    {
+        for (int w = 0; w < n_words; w++)
+        {
+            for (int p = 0; p < BB_N_PLANES; p++)
+            {
+                *words++ = bitboard_line(gs->board, p, AXIS_ROW, row)[w];
+            }
+        }
+    }
 }
 
-void undo_queue_destroy(struct undo_queue *q)
+void undo_snapshot_restore(struct game_state *gs, const uint64_t *words)
 {
-    free(q); q = NULL;
+    board_write_area(gs, 0, gs->puzzle->n_rows, 
+                     0, bitboard_line_words(gs->board, AXIS_ROW), 
+                     words, false);
 }
 
-void undo_queue_push(struct undo_queue *q, struct undo_entry entry)
+void board_write_area(struct game_state *gs, int row_start, int n_rows,
+                      int word_start, int n_words,
+                      const uint64_t *words, bool flip)
 {
-    assert(q != NULL);
+    struct bitboard *bb = gs->board;
+
+    // Lines whose filled cells changed, validated once at the end
+    uint64_t rows_changed[BB_MAX_LINE_WORDS] = {0};
+    uint64_t cols_changed[BB_MAX_LINE_WORDS] = {0};
+
+    for (int r = 0; r < n_rows; r++)
+    {
+        int row = row_start + r;
+        uint64_t *changes_line = gs->changes.cells 
+                                 + row * gs->changes.row_words;
+
+        for (int w = 0; w < n_words; w++, words += BB_N_PLANES)
+        {
+            int word = word_start + w;
+
+            uint64_t live[BB_N_PLANES];
+            uint64_t flipped[BB_N_PLANES];
+            uint64_t diff = 0;
+            for (int p = 0; p < BB_N_PLANES; p++)
+            {
+                live[p]    = bitboard_line(bb, p, AXIS_ROW, row)[word];
+                flipped[p] = flip ? words[p] : live[p] ^ words[p];
+                diff      |= flipped[p];
+            }
+            if (diff == 0)
+            {
+                continue;
+            }
+
+            for (int p = 0; p < BB_N_PLANES; p++)
+            {
+                bitboard_put_row_word(bb, p, row, word, live[p] ^ flipped[p]);
+            }
+
+            uint64_t filled_diff = 
+                (live[BB_PLANE_FILL] & ~live[BB_PLANE_TEMP])
+                ^ ((live[BB_PLANE_FILL] ^ flipped[BB_PLANE_FILL])
+                   & ~(live[BB_PLANE_TEMP] ^ flipped[BB_PLANE_TEMP]));
+
+            changes_line[word] |= diff;
+            gs->changes.any     = true;
+            capture_set_mark_row(gs->captures, row);
+            cols_changed[word] |= filled_diff;
+            if (filled_diff != 0)
+            {
+                bitline_set_range(rows_changed, row, row + 1);
+            }
+        }
+    }
 
-    q->data[q->tail] = entry;
-    q->tail = UNDO_NEXT_INDEX(q->tail);
-    
-    // If queue is full, remove the oldest entry
-    if (q->tail == q->head)
+    for (enum axis axis = AXIS_ROW; axis <= AXIS_COL; axis++)
     {
-        q->data[q->head].n_modified = UNDO_ENTRY_UNMODIFIED;
-        q->head = UNDO_NEXT_INDEX(q->head);
+        const uint64_t *changed = (axis == AXIS_ROW) ? rows_changed 
+                                                     : cols_changed;
+        int n_lines = (axis == AXIS_ROW) ? gs->puzzle->n_rows 
+                                         : gs->puzzle->n_cols;
+        int i = bitline_next_set(changed, n_lines, 0);
+        while (i < n_lines)
+        {
+            line_cache_update(gs, axis, i);
+            i = bitline_next_set(changed, n_lines, i + 1);
+        }
     }
 }
 
-void set_cell_state_internal(struct game_state *gs, struct cell curr,
-                             enum cell_state new_state, int *modified_cnt)
+enum cell_state set_cell_state_internal(struct game_state *gs, struct cell curr,
+                                        enum cell_state new_state)
 {
     assert(gs != NULL);
-    assert(gs->board_state != NULL);
+    assert(gs->board != NULL);
     assert(curr.row >= 0 && curr.row < gs->puzzle->n_rows);
     assert(curr.col >= 0 && curr.col < gs->puzzle->n_cols);
 
     enum cell_state old_state = get_cell_state(gs, curr);
     if (old_state != new_state)
     {
-        if (modified_cnt != NULL)
+        board_put_cell(gs->board, curr, new_state);
+        change_set_mark_cell(gs, curr);
+        capture_set_mark_row(gs->captures, curr.row);
+
+        // Only CELL_FILLED cells count towards the clues
+        if (old_state == CELL_FILLED || new_state == CELL_FILLED)
         {
-            (*modified_cnt)++;
-            struct undo_entry entry = {curr, old_state, *modified_cnt};
-            undo_queue_push(gs->undo_queue, entry);
+            line_cache_update(gs, AXIS_ROW, curr.row);
+            line_cache_update(gs, AXIS_COL, curr.col);
         }
-        gs->board_state[curr.row][curr.col] = new_state;
     }
+    return old_state;
 }
 
-enum cell_state **board_state_create(const struct puzzle *pz)
+struct bitboard *board_create(const struct puzzle *pz)
 {
     assert(pz != NULL);
-    enum cell_state **board_state;
 
-    board_state = (enum cell_state **)alloc2d(pz->n_rows, pz->n_cols,
-                                              sizeof(enum cell_state));
-    ALLOC_CHECK_EXIT(board_state);
-    for (int i = 0; i < pz->n_rows; i++)
+    // All planes start cleared, every cell is CELL_EMPTY
+    struct bitboard *bb = bitboard_create(pz->n_rows, pz->n_cols);
+    ALLOC_CHECK_EXIT(bb);
+    return bb;
+}
+
+enum cell_state cell_state_from_planes(unsigned planes)
+{
+    bool temp = planes & (1 << BB_PLANE_TEMP);
+
+    if (planes & (1 << BB_PLANE_FILL))
     {
-        for (int j = 0; j < pz->n_cols; j++)
-        {
-            board_state[i][j] = CELL_EMPTY;
-        }
+        return temp ? CELL_TEMP_FILLED : CELL_FILLED;
+    }
+    if (planes & (1 << BB_PLANE_XMARK))
+    {
+        return temp ? CELL_TEMP_XMARKED : CELL_XMARKED;
     }
+    return CELL_EMPTY;
+}
 
-    return board_state;
+enum cell_state board_get_cell(const struct bitboard *bb, struct cell cell)
+{
+    return cell_state_from_planes(bitboard_get_planes(bb, cell));
 }
 
+void board_put_cell(struct bitboard *bb, struct cell cell, enum cell_state state)
+{
+    unsigned planes = cell_state_planes[state];
+    for (int p = 0; p < BB_N_PLANES; p++)
+    {
+        bitboard_put(bb, p, cell, planes & (1 << p));
+    }
+}
+
+void board_filled_line(const struct bitboard *bb, enum axis axis, int idx,
+                       uint64_t *out)
+{
+    const uint64_t *fill = bitboard_line(bb, BB_PLANE_FILL, axis, idx);
+    const uint64_t *temp = bitboard_line(bb, BB_PLANE_TEMP, axis, idx);
+    for (int w = 0; w < bitboard_line_words(bb, axis); w++)
+    {
+        out[w] = fill[w] & ~temp[w];
+    }
+}
+
+void line_cache_create(struct game_state *gs)
+{
+    int row_words = BB_N_WORDS(gs->puzzle->n_rows);
+    int col_words = BB_N_WORDS(gs->puzzle->n_cols);
+
+    uint64_t *data = calloc(row_words + col_words, sizeof(uint64_t));
+    ALLOC_CHECK_EXIT(data);
+
+    gs->line_solved[AXIS_ROW] = data;
+    gs->line_solved[AXIS_COL] = data + row_words;
+    gs->n_unsolved_lines      = gs->puzzle->n_rows + gs->puzzle->n_cols;
+
+    line_cache_update_all(gs);
+}
+
+void line_cache_destroy(struct game_state *gs)
+{
+    free(gs->line_solved[AXIS_ROW]);
+    gs->line_solved[AXIS_ROW] = NULL;
+    gs->line_solved[AXIS_COL] = NULL;
+}
+
+void line_cache_update(struct game_state *gs, enum axis axis, int idx)
+{
+    uint64_t *word = gs->line_solved[axis] + idx / BB_WORD_BITS;
+    uint64_t  bit  = (uint64_t)1 << (idx % BB_WORD_BITS);
+
+    bool was_solved = (*word & bit) != 0;
+    bool solved     = validate_axis(gs, axis, idx);
+    if (solved == was_solved)
+    {
+        return;
+    }
+
+    if (solved)
+    {
+        *word |= bit;
+        gs->n_unsolved_lines--;
+    }
+    else
+    {
+        *word &= ~bit;
+        gs->n_unsolved_lines++;
+    }
+    change_set_mark_line(gs, axis, idx);
+}
+
+void line_cache_update_all(struct game_state *gs)
+{
+    for (int i = 0; i < gs->puzzle->n_rows; i++)
+    {
+        line_cache_update(gs, AXIS_ROW, i);
+    }
+    for (int j = 0; j < gs->puzzle->n_cols; j++)
+    {
+        line_cache_update(gs, AXIS_COL, j);
+    }
+}
+
+void change_set_create(struct game_state *gs)
+{
+    int row_words  = BB_N_WORDS(gs->puzzle->n_cols);
+    int cell_words = gs->puzzle->n_rows * row_words;
+    int line_words = BB_N_WORDS(gs->puzzle->n_rows);
+    int n_words    = cell_words + line_words + BB_N_WORDS(gs->puzzle->n_cols);
+
+    // Single block: cells, then row lines, then column lines
+    uint64_t *data = calloc(n_words, sizeof(uint64_t));
+    ALLOC_CHECK_EXIT(data);
+
+    gs->changes.cells           = data;
+    gs->changes.lines[AXIS_ROW] = data + cell_words;
+    gs->changes.lines[AXIS_COL] = data + cell_words + line_words;
+    gs->changes.row_words       = row_words;
+    gs->changes.n_words         = n_words;
+    gs->changes.any             = false;
+}
+
+void change_set_destroy(struct game_state *gs)
+{
+    free(gs->changes.cells);
+    gs->changes.cells           = NULL;
+    gs->changes.lines[AXIS_ROW] = NULL;
+    gs->changes.lines[AXIS_COL] = NULL;
+}
+
+void change_set_mark_cell(struct game_state *gs, struct cell cell)
+{
+    uint64_t *line = gs->changes.cells + cell.row * gs->changes.row_words;
+    line[cell.col / BB_WORD_BITS] |= (uint64_t)1 << (cell.col % BB_WORD_BITS);
+    gs->changes.any = true;
+}
+
+void change_set_mark_line(struct game_state *gs, enum axis axis, int idx)
+{
+    uint64_t *line = gs->changes.lines[axis];
+    line[idx / BB_WORD_BITS] |= (uint64_t)1 << (idx % BB_WORD_BITS);
+    gs->changes.any = true;
+}
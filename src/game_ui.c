@@ -10,35 +10,178 @@
 #define CELL_WIDTH 4
 #define CELL_HEIGHT 2
 
+// Foreground is the upper cell, background the lower one
+#define HALF_BLOCK_UPPER L"\u2580"
+
 #define UI_WIN_PADDING 1
 
+// Guide grid spacing, the view scrolls by whole blocks when it can
+#define GUIDE_BLOCK_SIZE 5
+
 #define NTERM_COLOR_FILLED       COLOR_P_BLUE
 #define NTERM_COLOR_CLUE_CORRECT COLOR_P_GREEN_HIGHLIGHTED
 #define NTERM_COLOR_DEFAULT      COLOR_P_DEFAULT
 
+#define NTERM_COLOR_SELECTED        COLOR_P_DEFAULT_HIGHLIGHTED
+#define NTERM_COLOR_FILLED_SELECTED COLOR_P_BLUE_HIGHLIGHTED
+
+struct style
+{
+    attr_t attr;
+    short color_p;
+};
+
 /* Function prototypes */ 
-int get_clueline_render_size(const struct puzzle *pz, enum axis axis);
 
 /**
- * @return position of the cell's top-left corner relative to the board window
+ * Read the clues of every line, clue counts and widths do not depend on
+ * the layout.
  */
-struct pos cell_to_board_pos(struct game_ui *ui, struct cell cell);
+void clue_layout_init(struct game_ui *ui);
+void clue_layout_free(struct game_ui *ui);
+
+/**
+ * Place the clues and clue line regions for the current windows and view.
+ */
+void layout_clues(struct game_ui *ui);
+void layout_row_clues(struct game_ui *ui, struct pos board_start, int row);
+void layout_col_clues(struct game_ui *ui, struct pos board_start, int col);
+
+/**
+ * @return Terminal columns (row clues) or rows (column clues) taken by the
+ *         clues of the axis
+ */
+int get_clueline_render_size(const struct game_ui *ui, enum axis axis);
+
+/**
+ * Color the region of a clue line, if it is in view.
+ */
+void colorize_clue_line(struct game_ui *ui, const struct clue_line *line,
+                        short color_p);
+
+/**
+ * @return Cells have grid lines between them, one extra row and column
+ */
+bool has_grid(const struct game_ui *ui);
+
+/**
+ * @return Board rows drawn on one terminal row
+ */
+int get_rows_per_line(const struct game_ui *ui);
+
+/**
+ * @return Row shares a terminal row with the one above it, its clues are
+ *         drawn right of the board
+ */
+bool is_lower_half_row(const struct game_ui *ui, int row);
+
+/**
+ * @return Cell is in an odd 5x5 guide block, drawn on a shade when there
+ *         are no grid lines
+ */
+bool is_shaded_block(struct cell cell);
+short get_shade_color(void);
+
+/**
+ * @return Cells of a line shown when n_fit cells fit the screen
+ */
+int get_view_len(int n_fit, int n_cells);
+
+/**
+ * @return Start of the view along one axis, moved only if target is not
+ *         visible
+ */
+int get_view_scroll_start(int start, int size, int n_cells, int target);
+
+/**
+ * @return One past the last visible cell
+ */
+struct cell get_view_end(const struct game_ui *ui);
+bool is_cell_in_view(const struct game_ui *ui, struct cell cell);
+
+/**
+ * @param  line Row or column index of the grid line above/left of the cell
+ * @return Line is part of the 5x5 guide grid, view edges always are
+ */
+bool is_guide_line(const struct game_ui *ui, enum axis axis, int line);
 
 /**
- * @return position of the cell's top-left corner relative to the main window
+ * Box, grids and clues of the visible part of the board.
  */
-struct pos cell_to_win_pos(struct game_ui *ui, struct cell cell);
+void draw_base_board(struct game_ui *ui);
+
+/**
+ * @return position of the cell's top-left corner relative to the board window
+ */
+struct pos cell_to_board_pos(struct game_ui *ui, struct cell cell);
 
 void draw_1x1_cell_grid(struct game_ui *ui);
 void draw_5x5_guide_grid(struct game_ui *ui);
 void draw_clues(struct game_ui *ui);
-chtype get_corner_char(struct cell curr, struct cell max);
+chtype get_corner_char(struct cell curr, struct cell first, struct cell last);
 
 void draw_board_state(struct game_ui *ui, const struct game_state *state);
+void draw_changed_cells(struct game_ui *ui, const struct game_state *state);
+void draw_area_state(struct game_ui *ui, const struct game_state *state,
+                     struct cell start, struct cell end);
 void colorize_correct_rows(struct game_ui *ui, const struct game_state *state);
 void colorize_correct_cols(struct game_ui *ui, const struct game_state *state);
-void draw_cell(struct game_ui *ui, struct cell cell, enum cell_state state);
-void highlight_cell(struct game_ui *ui, struct cell cell, short color_p);
+void colorize_changed_lines(struct game_ui *ui, const struct game_state *state);
+void colorize_row_clues(struct game_ui *ui, const struct game_state *state, int row);
+void colorize_col_clues(struct game_ui *ui, const struct game_state *state, int col);
+void draw_cell(struct game_ui *ui, const struct game_state *state,
+               struct cell cell);
+
+/**
+ * Draw the terminal row holding the cell and the other cell of its pair.
+ */
+void draw_half_block_cell(struct game_ui *ui, const struct game_state *state,
+                          struct cell cell);
+
+/**
+ * @return Attributes of the inside of a cell
+ */
+struct style get_cell_style(const struct game_ui *ui, struct cell cell,
+                            enum cell_state state, bool selected);
+
+/**
+ * @return Color of a half-block cell
+ */
+short get_half_block_color(const struct game_ui *ui,
+                           const struct game_state *state, struct cell cell);
+
+bool is_cell_selected(const struct game_ui *ui, struct cell cell);
+bool is_cell_in_area(struct cell cell, struct cell start, struct cell end);
+
+/**
+ * Redraw the cells entering or leaving the selection, for modes without
+ * grid lines to restyle.
+ */
+void redraw_selection_cells(struct game_ui *ui, const struct game_state *state,
+                            bool had_selection, struct cell old_start,
+                            struct cell old_end);
+
+/**
+ * @return Screen area covered by the visible selected cells and their
+ *         borders, inclusive, relative to the board window. Empty area has
+ *         bottom_right above/left of top_left.
+ */
+void selection_board_area(struct game_ui *ui, struct cell start, struct cell end,
+                          struct pos *top_left, struct pos *bottom_right);
+
+/**
+ * @return Attributes the board window position is drawn with
+ */
+struct style get_board_pos_style(struct game_ui *ui,
+                                 const struct game_state *state,
+                                 struct pos pos, bool selected);
+
+/**
+ * Restyle positions [from_x, to_x] of a board window line, one call per
+ * run of positions with the same style.
+ */
+void restyle_board_line(struct game_ui *ui, const struct game_state *state,
+                        int y, int from_x, int to_x, bool selected);
 
 /* Public */ 
 struct game_ui *game_ui_create(const struct puzzle *pz)
@@ -52,6 +195,13 @@ struct game_ui *game_ui_create(const struct puzzle *pz)
     ui->win = NULL;
     ui->board = NULL;
     ui->cmd_menu = NULL;
+    ui->full_repaint = true;
+    ui->has_selection = false;
+    ui->view_start = (struct cell){0, 0};
+    ui->view_size = get_puzzle_size(pz);
+    ui->cell_mode = CELL_MODE_BOXED;
+    ui->cell_size = (struct pos){CELL_HEIGHT, CELL_WIDTH};
+    clue_layout_init(ui);
     /*game_ui_set_windows(ui);*/
     return ui;
 }
@@ -68,67 +218,400 @@ void game_ui_destroy(struct game_ui *ui)
     /*menu_set_destroy(ui->cmd_menu);*/
     delwin(ui->board);
     delwin(ui->win);
+    clue_layout_free(ui);
     free(ui);
 }
 
+int game_ui_set_cell_mode(struct game_ui *ui, enum cell_mode mode)
+{
+    assert(ui != NULL);
+    assert(mode >= 0 && mode < CELL_MODE_N);
+
+    if (mode == CELL_MODE_HALF_BLOCK && !has_unicode())
+    {
+        LOG(LOG_INFO, "Half-block cells need a UTF-8 locale");
+        return -1;
+    }
+
+    ui->cell_mode = mode;
+    return game_ui_set_windows(ui);
+}
+
 void display_base_board(struct game_ui *ui)
 {
     clear();
-    refresh();
-    box(ui->win, 0, 0);
-    draw_1x1_cell_grid(ui);
-    draw_5x5_guide_grid(ui);
-    draw_clues(ui);
-    wrefresh(ui->win);
+    frame_stage(stdscr);
+    draw_base_board(ui);
+    frame_stage(ui->win);
+
+    // Screen was cleared, cells, clue colors and selection are drawn again
+    ui->full_repaint  = true;
+    ui->has_selection = false;
 }
 
-void highlight_area(struct game_ui *ui, struct cell start, struct cell end, attr_t attr)
+void scroll_to_cell(struct game_ui *ui, struct cell cell)
 {
-    struct cell curr;
-    for (curr.row = start.row; curr.row <= end.row; curr.row++)
+    assert(ui != NULL);
+
+    struct cell start =
     {
-        for (curr.col = start.col; curr.col <= end.col; curr.col++)
+        .row = get_view_scroll_start(ui->view_start.row, ui->view_size.row,
+                                     ui->puzzle->n_rows, cell.row),
+        .col = get_view_scroll_start(ui->view_start.col, ui->view_size.col,
+                                     ui->puzzle->n_cols, cell.col),
+    };
+    if (start.row == ui->view_start.row && start.col == ui->view_start.col)
+    {
+        return;
+    }
+
+    ui->view_start = start;
+    layout_clues(ui);
+    draw_base_board(ui);
+    frame_stage(ui->win);
+
+    ui->full_repaint  = true;
+    ui->has_selection = false;
+}
+
+void draw_selection(struct game_ui *ui, const struct game_state *state,
+                    struct cell start, struct cell end)
+{
+    assert(ui != NULL);
+    assert(ui->board != NULL);
+
+    if (!has_grid(ui))
+    {
+        bool had_selection    = ui->has_selection;
+        struct cell old_start = ui->sel_start;
+        struct cell old_end   = ui->sel_end;
+
+        ui->has_selection = true;
+        ui->sel_start     = start;
+        ui->sel_end       = end;
+        redraw_selection_cells(ui, state, had_selection, old_start, old_end);
+        return;
+    }
+
+    struct pos new_tl, new_br;
+    selection_board_area(ui, start, end, &new_tl, &new_br);
+
+    // No previous selection: empty area
+    struct pos old_tl = {0, 0};
+    struct pos old_br = {-1, -1};
+    if (ui->has_selection)
+    {
+        selection_board_area(ui, ui->sel_start, ui->sel_end, &old_tl, &old_br);
+    }
+
+    ui->has_selection = true;
+    ui->sel_start     = start;
+    ui->sel_end       = end;
+
+    // Restyle positions in exactly one of the two areas
+    for (int y = MIN(old_tl.y, new_tl.y); y <= MAX(old_br.y, new_br.y); y++)
+    {
+        bool in_old = y >= old_tl.y && y <= old_br.y;
+        bool in_new = y >= new_tl.y && y <= new_br.y;
+        bool overlap = old_tl.x <= new_br.x && new_tl.x <= old_br.x;
+
+        if (in_old && in_new && !overlap)
+        {
+            // Jumped past the old columns, nothing in between changes
+            restyle_board_line(ui, state, y, old_tl.x, old_br.x, false);
+            restyle_board_line(ui, state, y, new_tl.x, new_br.x, true);
+        }
+        else if (in_old && in_new)
+        {
+            // Left and right edges moving in or out
+            restyle_board_line(ui, state, y, MIN(old_tl.x, new_tl.x),
+                               MAX(old_tl.x, new_tl.x) - 1,
+                               new_tl.x < old_tl.x);
+            restyle_board_line(ui, state, y, MIN(old_br.x, new_br.x) + 1,
+                               MAX(old_br.x, new_br.x),
+                               new_br.x > old_br.x);
+        }
+        else if (in_old)
         {
-            highlight_cell(ui, curr, attr);
+            restyle_board_line(ui, state, y, old_tl.x, old_br.x, false);
+        }
+        else if (in_new)
+        {
+            restyle_board_line(ui, state, y, new_tl.x, new_br.x, true);
         }
     }
 }
 
 void display_game_state(struct game_ui *ui, const struct game_state *state)
 {
-    draw_board_state(ui, state);
-    colorize_correct_rows(ui, state);
-    colorize_correct_cols(ui, state);
-    wrefresh(ui->board);
+    if (ui->full_repaint)
+    {
+        draw_board_state(ui, state);
+        colorize_correct_rows(ui, state);
+        colorize_correct_cols(ui, state);
+        ui->full_repaint = false;
+    }
+    else
+    {
+        if (has_changes(state))
+        {
+            draw_changed_cells(ui, state);
+            colorize_changed_lines(ui, state);
+        }
+    }
+
+    // Clue colors are on the main window, cells on the board
+    frame_stage(ui->win);
+    frame_stage(ui->board);
 }
 
 /* Private */
 
-int get_clueline_render_size(const struct puzzle *pz, enum axis axis)
+void clue_layout_init(struct game_ui *ui)
 {
-    int max_n_valid_clues = 0;
-    int **clues           = (axis == AXIS_ROW) ? pz->row_clues : pz->col_clues;
-    int n_clueline        = (axis == AXIS_ROW) ? pz->n_rows : pz->n_cols;
-    int clueline_size     = (axis == AXIS_ROW) ? get_row_clueline_size(pz)
-                                               : get_col_clueline_size(pz);
+    const struct puzzle *pz   = ui->puzzle;
+    struct clue_layout *clues = &ui->clues;
+
+    int n_lines[2]   = {pz->n_rows, pz->n_cols};
+    int line_size[2] = {get_row_clueline_size(pz), get_col_clueline_size(pz)};
+    int **values[2]  = {pz->row_clues, pz->col_clues};
+
+    int n_spans = 0;
+    for (int axis = AXIS_ROW; axis <= AXIS_COL; axis++)
+    {
+        for (int i = 0; i < n_lines[axis]; i++)
+        {
+            for (int j = 0; j < line_size[axis]; j++)
+            {
+                n_spans += values[axis][i][j] != 0;
+            }
+        }
+    }
+
+    clues->lines[AXIS_ROW] = calloc(pz->n_rows, sizeof(struct clue_line));
+    clues->lines[AXIS_COL] = calloc(pz->n_cols, sizeof(struct clue_line));
+    clues->spans           = calloc(MAX(n_spans, 1), sizeof(struct clue_span));
+    ALLOC_CHECK_EXIT(clues->lines[AXIS_ROW]);
+    ALLOC_CHECK_EXIT(clues->lines[AXIS_COL]);
+    ALLOC_CHECK_EXIT(clues->spans);
 
-    for (int i = 0; i < n_clueline; i++)
+    struct clue_span *span = clues->spans;
+    for (int axis = AXIS_ROW; axis <= AXIS_COL; axis++)
     {
-        int n_valid_clues = 0;
-        for (int j = 0; j < clueline_size; j++)
+        int max_value = 0;
+        clues->max_clues[axis] = 0;
+        for (int i = 0; i < n_lines[axis]; i++)
         {
-            if (clues[i][j] != 0)
+            struct clue_line *line = &clues->lines[axis][i];
+            line->clues = span;
+            for (int j = 0; j < line_size[axis]; j++)
             {
-                n_valid_clues++;
+                int value = values[axis][i][j];
+                if (value != 0)
+                {
+                    span->value = value;
+                    span++;
+                    line->n_clues++;
+                    max_value = MAX(max_value, value);
+                }
             }
+            clues->max_clues[axis] = MAX(clues->max_clues[axis], line->n_clues);
+        }
+
+        clues->digits[axis] = 1;
+        for (; max_value >= 10; max_value /= 10)
+        {
+            clues->digits[axis]++;
+        }
+    }
+
+    // Space before the digits, at least 2 of them
+    clues->row_clue_width = MAX(clues->digits[AXIS_ROW], 2) + 1;
+    clues->col_clue_width = MAX(clues->digits[AXIS_COL], 2);
+}
+
+void clue_layout_free(struct game_ui *ui)
+{
+    free(ui->clues.lines[AXIS_ROW]);
+    free(ui->clues.lines[AXIS_COL]);
+    free(ui->clues.spans);
+}
+
+void layout_clues(struct game_ui *ui)
+{
+    // Boxed cells have room for a space, compact ones are sized to the clues
+    ui->clues.col_clue_width = has_grid(ui)
+                               ? MAX(ui->clues.digits[AXIS_COL], 2)
+                               : ui->cell_size.x;
+
+    struct pos board_start;
+    getparyx(ui->board, board_start.y, board_start.x);
+
+    struct cell end = get_view_end(ui);
+    for (int i = 0; i < ui->puzzle->n_rows; i++)
+    {
+        ui->clues.lines[AXIS_ROW][i].in_view = i >= ui->view_start.row
+                                               && i < end.row;
+        if (ui->clues.lines[AXIS_ROW][i].in_view)
+        {
+            layout_row_clues(ui, board_start, i);
         }
-        max_n_valid_clues = MAX(max_n_valid_clues, n_valid_clues);
     }
-    
-    // Row : 3 one for space, two for number (max 2 digits)  
+    for (int j = 0; j < ui->puzzle->n_cols; j++)
+    {
+        ui->clues.lines[AXIS_COL][j].in_view = j >= ui->view_start.col
+                                               && j < end.col;
+        if (ui->clues.lines[AXIS_COL][j].in_view)
+        {
+            layout_col_clues(ui, board_start, j);
+        }
+    }
+}
+
+void layout_row_clues(struct game_ui *ui, struct pos board_start, int row)
+{
+    struct clue_line *line = &ui->clues.lines[AXIS_ROW][row];
+    int width      = ui->clues.row_clue_width;
+    int grid_width = has_grid(ui) ? 1 : 0;
+
+    // Middle of the cell height when inside a grid
+    struct cell curr = {row, ui->view_start.col};
+    int y = board_start.y + cell_to_board_pos(ui, curr).y + grid_width;
+
+    // Left of the board, right aligned, or right of it in half-block mode
+    int x;
+    if (is_lower_half_row(ui, row))
+    {
+        x = board_start.x + getmaxx(ui->board);
+        line->region_start = (struct pos){y, x};
+        line->region_width = line->n_clues * width;
+    }
+    else
+    {
+        x = board_start.x - line->n_clues * width;
+        line->region_start = (struct pos){y, UI_WIN_PADDING};
+        line->region_width = board_start.x - UI_WIN_PADDING;
+    }
+    line->region_height = 1;
+
+    for (int i = 0; i < line->n_clues; i++, x += width)
+    {
+        line->clues[i].start = (struct pos){y, x};
+        line->clues[i].width = width;
+    }
+}
+
+void layout_col_clues(struct game_ui *ui, struct pos board_start, int col)
+{
+    struct clue_line *line = &ui->clues.lines[AXIS_COL][col];
+    int grid_width = has_grid(ui) ? 1 : 0;
+
+    // Right of the grid line, bottom clue on the row above the board
+    struct cell curr = {ui->view_start.row, col};
+    int x = board_start.x + cell_to_board_pos(ui, curr).x + grid_width;
+    int y = board_start.y - line->n_clues;
+
+    line->region_start  = (struct pos){UI_WIN_PADDING, x};
+    line->region_width  = ui->cell_size.x - grid_width;
+    line->region_height = board_start.y - UI_WIN_PADDING;
+
+    for (int i = 0; i < line->n_clues; i++, y++)
+    {
+        line->clues[i].start = (struct pos){y, x};
+        line->clues[i].width = ui->clues.col_clue_width;
+    }
+}
+
+int get_clueline_render_size(const struct game_ui *ui, enum axis axis)
+{
+    // Row : one for space, then the digits (at least 2)
     // Col : 1 one for number since it's vertical
-    int space_per_clue = (axis == AXIS_ROW) ? 3 : 1;
-    return max_n_valid_clues * space_per_clue;
+    int space_per_clue = (axis == AXIS_ROW) ? ui->clues.row_clue_width : 1;
+    return ui->clues.max_clues[axis] * space_per_clue;
+}
+
+bool has_grid(const struct game_ui *ui)
+{
+    return ui->cell_mode == CELL_MODE_BOXED;
+}
+
+int get_rows_per_line(const struct game_ui *ui)
+{
+    return (ui->cell_mode == CELL_MODE_HALF_BLOCK) ? 2 : 1;
+}
+
+bool is_lower_half_row(const struct game_ui *ui, int row)
+{
+    return get_rows_per_line(ui) == 2 && (row - ui->view_start.row) % 2 == 1;
+}
+
+bool is_shaded_block(struct cell cell)
+{
+    return (cell.row / GUIDE_BLOCK_SIZE + cell.col / GUIDE_BLOCK_SIZE) % 2 == 1;
+}
+
+short get_shade_color(void)
+{
+    return (COLORS > COLOR_SHADE) ? COLOR_SHADE : COLOR_BLACK;
+}
+
+int get_view_len(int n_fit, int n_cells)
+{
+    // Whole guide blocks, so the view edges fall on guide lines
+    if (n_fit >= GUIDE_BLOCK_SIZE)
+    {
+        n_fit -= n_fit % GUIDE_BLOCK_SIZE;
+    }
+    return MAX(1, MIN(n_fit, n_cells));
+}
+
+int get_view_scroll_start(int start, int size, int n_cells, int target)
+{
+    if (target >= start && target < start + size)
+    {
+        return start;
+    }
+
+    // Center the target, aligned to a guide block when it stays visible
+    int new_start = MAX(0, MIN(target - size / 2, n_cells - size));
+    int aligned   = new_start - new_start % GUIDE_BLOCK_SIZE;
+    return (target < aligned + size) ? aligned : new_start;
+}
+
+struct cell get_view_end(const struct game_ui *ui)
+{
+    struct cell end =
+    {
+        .row = ui->view_start.row + ui->view_size.row,
+        .col = ui->view_start.col + ui->view_size.col,
+    };
+    return end;
+}
+
+bool is_cell_in_view(const struct game_ui *ui, struct cell cell)
+{
+    struct cell end = get_view_end(ui);
+    return cell.row >= ui->view_start.row && cell.row < end.row
+           && cell.col >= ui->view_start.col && cell.col < end.col;
+}
+
+bool is_guide_line(const struct game_ui *ui, enum axis axis, int line)
+{
+    int first = (axis == AXIS_ROW) ? ui->view_start.row : ui->view_start.col;
+    int size  = (axis == AXIS_ROW) ? ui->view_size.row : ui->view_size.col;
+    return line % GUIDE_BLOCK_SIZE == 0 || line == first || line == first + size;
+}
+
+void draw_base_board(struct game_ui *ui)
+{
+    werase(ui->win);
+    box(ui->win, 0, 0);
+    if (has_grid(ui))
+    {
+        draw_1x1_cell_grid(ui);
+        draw_5x5_guide_grid(ui);
+    }
+    draw_clues(ui);
 }
 
 int game_ui_set_windows(struct game_ui *ui)
@@ -144,30 +627,115 @@ int game_ui_set_windows(struct game_ui *ui)
     int right_space  = 0;
     int bottom_space = 0;
 
-    int board_width      = ui->puzzle->n_cols * CELL_WIDTH + 1;
-    int board_height     = ui->puzzle->n_rows * CELL_HEIGHT + 1;
-    int row_clues_width  = get_clueline_render_size(ui->puzzle, AXIS_ROW);
-    int col_clues_height = get_clueline_render_size(ui->puzzle, AXIS_COL);
+    // Laid out again after a resize or cell mode change
+    if (ui->win != NULL)
+    {
+        delwin(ui->board);
+        delwin(ui->win);
+        ui->board = NULL;
+        ui->win   = NULL;
+    }
 
-    struct menu_param params =
+    switch (ui->cell_mode)
     {
-        .title = "COMMAND MODE",
-        .size = {.x = 0, .y = 0},
-        .start = {.x = win_padding + left_space + row_clues_width + board_width,
-                .y = win_padding + top_space + col_clues_height + 1},
-        .n_choices = CMD_N,
-        .choices = command_mode_choices,
-        .descriptions = command_mode_desc,
-    };
+        case CELL_MODE_BOXED:
+            ui->cell_size = (struct pos){CELL_HEIGHT, CELL_WIDTH};
+            break;
+        case CELL_MODE_COMPACT:
+        case CELL_MODE_HALF_BLOCK:
+        default:
+            // Column clues need a space between them
+            ui->cell_size = (struct pos)
+            {
+                .y = 1,
+                .x = ui->clues.digits[AXIS_COL] + 1
+            };
+            break;
+    }
+
+    int grid_width    = has_grid(ui) ? 1 : 0;
+    int rows_per_line = get_rows_per_line(ui);
+
+    // Half-block mode shows the clues of every other row right of the board
+    int row_clues_width  = get_clueline_render_size(ui, AXIS_ROW)
+                           * rows_per_line;
+    int col_clues_height = get_clueline_render_size(ui, AXIS_COL);
+
+    if (ui->cmd_menu == NULL)
+    {
+        // Placed next to the board once the board size is known
+        struct menu_param params =
+        {
+            .title = "COMMAND MODE",
+            .size = {.x = 0, .y = 0},
+            .start = {.x = 0, .y = 0},
+            .n_choices = CMD_N,
+            .choices = command_mode_choices,
+            .descriptions = command_mode_desc,
+        };
 
-    struct menu_config config = menu_config_default;
+        struct menu_config config = menu_config_default;
 
-    ui->cmd_menu = menu_set_create(&params);
-    ALLOC_CHECK_EXIT(ui->cmd_menu);
-    menu_set_configure(ui->cmd_menu, config);
+        ui->cmd_menu = menu_set_create(&params);
+        ALLOC_CHECK_EXIT(ui->cmd_menu);
+        menu_set_configure(ui->cmd_menu, config);
+    }
 
     right_space = getmaxx(ui->cmd_menu->win);
 
+    // Show the cells that fit the terminal, the rest is scrolled to
+    struct pos term_size;
+    getmaxyx(stdscr, term_size.y, term_size.x);
+
+    struct pos board_space =
+    {
+        .y = term_size.y - win_padding * 2 - top_space - col_clues_height
+             - bottom_space - grid_width,
+        .x = term_size.x - win_padding * 2 - left_space - row_clues_width
+             - grid_width,
+    };
+
+    // Menu is only shown in command mode, it covers the board rather than
+    // hiding columns when both do not fit side by side
+    int menu_width = right_space;
+    if (board_space.x - menu_width >= ui->puzzle->n_cols * ui->cell_size.x)
+    {
+        board_space.x -= menu_width;
+    }
+    else
+    {
+        right_space = 0;
+    }
+
+    ui->view_size = (struct cell)
+    {
+        .row = get_view_len(board_space.y / ui->cell_size.y * rows_per_line,
+                            ui->puzzle->n_rows),
+        .col = get_view_len(board_space.x / ui->cell_size.x,
+                            ui->puzzle->n_cols),
+    };
+
+    // View stays where it was, unless it would now pass the board's end
+    ui->view_start.row = MAX(0, MIN(ui->view_start.row,
+                                    ui->puzzle->n_rows - ui->view_size.row));
+    ui->view_start.col = MAX(0, MIN(ui->view_start.col,
+                                    ui->puzzle->n_cols - ui->view_size.col));
+
+    int board_lines  = (ui->view_size.row + rows_per_line - 1) / rows_per_line;
+    int board_width  = ui->view_size.col * ui->cell_size.x + grid_width;
+    int board_height = board_lines * ui->cell_size.y + grid_width;
+
+    struct pos menu_start =
+    {
+        .y = win_padding + top_space + col_clues_height + 1,
+        .x = win_padding + left_space + row_clues_width + board_width,
+    };
+    menu_start.x = MAX(0, MIN(menu_start.x, term_size.x - menu_width));
+    if (menu_set_move(ui->cmd_menu, menu_start) != 0)
+    {
+        LOG(LOG_WARNING, "Command menu does not fit next to the board");
+    }
+
     struct pos win_size = 
     {
         .y = win_padding * 2 + top_space + col_clues_height + board_height
@@ -179,45 +747,29 @@ int game_ui_set_windows(struct game_ui *ui)
     ui->win = newwin(win_size.y, win_size.x, 0, 0);
     ALLOC_CHECK_EXIT(ui->win);
 
+    // Right side row clues are after the board
+    int left_clues_width = row_clues_width / rows_per_line;
     ui->board = derwin(ui->win, board_height, board_width, 
                        win_padding + top_space + col_clues_height, 
-                       win_padding + left_space + row_clues_width);
+                       win_padding + left_space + left_clues_width);
     ALLOC_CHECK_EXIT(ui->board);
 
+    layout_clues(ui);
     return 0;
 }
 
 struct pos cell_to_board_pos(struct game_ui *ui, struct cell cell)
 {
+    int rows_per_line = get_rows_per_line(ui);
     struct pos cell_pos = 
     {
-        .y = cell.row * CELL_HEIGHT,
-        .x = cell.col * CELL_WIDTH
+        .y = (cell.row - ui->view_start.row) / rows_per_line * ui->cell_size.y,
+        .x = (cell.col - ui->view_start.col) * ui->cell_size.x
     };
 
     return cell_pos;
 }
 
-struct pos cell_to_win_pos(struct game_ui *ui, struct cell cell)
-{
-    assert(ui != NULL);
-    assert(ui->puzzle != NULL);
-    assert(ui->win != NULL);
-    assert(ui->board != NULL);
-
-    struct pos cell_board_pos = cell_to_board_pos(ui, cell);
-    struct pos board_start;
-    getparyx(ui->board, board_start.y, board_start.x);
-
-    struct pos cell_win_pos = 
-    {
-        .y = board_start.y + cell_board_pos.y,
-        .x = board_start.x + cell_board_pos.x
-    };
-
-    return cell_win_pos;
-}
-
 void draw_1x1_cell_grid(struct game_ui *ui)
 {
     assert(ui != NULL);
@@ -225,11 +777,11 @@ void draw_1x1_cell_grid(struct game_ui *ui)
     assert(ui->board != NULL);
 
     struct cell curr;
-    struct cell max = get_puzzle_size(ui->puzzle);
+    struct cell end = get_view_end(ui);
     // Does not draw edges properly, but 5x5 grid will override anyway
-    for (curr.row = 0; curr.row < max.row; curr.row++)
+    for (curr.row = ui->view_start.row; curr.row < end.row; curr.row++)
     {
-        for (curr.col = 0; curr.col < max.col; curr.col++)
+        for (curr.col = ui->view_start.col; curr.col < end.col; curr.col++)
         {
             struct pos cell_pos = cell_to_board_pos(ui, curr);
             mvwprintw(ui->board, cell_pos.y, cell_pos.x, CELL_ROW_TOP);
@@ -238,18 +790,16 @@ void draw_1x1_cell_grid(struct game_ui *ui)
     }
 }
 
-chtype get_corner_char(struct cell curr, struct cell max)
+chtype get_corner_char(struct cell curr, struct cell first, struct cell last)
 {
-    assert(curr.row % 5 == 0 || curr.col % 5 == 0);
-
     chtype left_corner, right_corner, mid_corner;
-    if (curr.row == 0)
+    if (curr.row == first.row)
     {
         left_corner  = ACS_ULCORNER;
         right_corner = ACS_URCORNER;
         mid_corner   = ACS_TTEE;
     }
-    else if (curr.row == max.row)
+    else if (curr.row == last.row)
     {
         left_corner  = ACS_LLCORNER;
         right_corner = ACS_LRCORNER;
@@ -262,9 +812,9 @@ chtype get_corner_char(struct cell curr, struct cell max)
         mid_corner   = ACS_PLUS;
     }
 
-    return (curr.col == 0) ? left_corner 
-                           : (curr.col == max.col) ? right_corner 
-                                                   : mid_corner;
+    return (curr.col == first.col) ? left_corner 
+                                   : (curr.col == last.col) ? right_corner 
+                                                            : mid_corner;
 }
 
 void draw_5x5_guide_grid(struct game_ui *ui)
@@ -275,12 +825,14 @@ void draw_5x5_guide_grid(struct game_ui *ui)
 
     struct cell curr;
     struct pos cell_pos;
-    struct cell max = get_puzzle_size(ui->puzzle);
+    struct cell first = ui->view_start;
+    struct cell last  = get_view_end(ui);
 
     // Horizontal Guideline
-    for (curr.row = 0; curr.row <= max.row; curr.row += 5)
+    for (curr.row = first.row; curr.row <= last.row; curr.row++)
     {
-        for (curr.col = 0; curr.col <= max.col; curr.col++)
+        if (!is_guide_line(ui, AXIS_ROW, curr.row)) continue;
+        for (curr.col = first.col; curr.col < last.col; curr.col++)
         {
             cell_pos = cell_to_board_pos(ui, curr);
             for (int w = 0; w < CELL_WIDTH; w++)
@@ -291,10 +843,11 @@ void draw_5x5_guide_grid(struct game_ui *ui)
     }
 
     // Vertical Guideline
-    for (curr.row = 0; curr.row <= max.row; curr.row++)
+    for (curr.row = first.row; curr.row < last.row; curr.row++)
     {
-        for (curr.col = 0; curr.col <= max.col; curr.col += 5)
+        for (curr.col = first.col; curr.col <= last.col; curr.col++)
         {
+            if (!is_guide_line(ui, AXIS_COL, curr.col)) continue;
             cell_pos = cell_to_board_pos(ui, curr);
             for (int h = 0; h < CELL_HEIGHT; h++)
             {
@@ -304,11 +857,13 @@ void draw_5x5_guide_grid(struct game_ui *ui)
     }
 
     // Corners
-    for (curr.row = 0; curr.row <= max.row; curr.row += 5)
+    for (curr.row = first.row; curr.row <= last.row; curr.row++)
     {
-        for (curr.col = 0; curr.col <= max.col; curr.col += 5)
+        if (!is_guide_line(ui, AXIS_ROW, curr.row)) continue;
+        for (curr.col = first.col; curr.col <= last.col; curr.col++)
         {
-            chtype corner_char = get_corner_char(curr, max);
+            if (!is_guide_line(ui, AXIS_COL, curr.col)) continue;
+            chtype corner_char = get_corner_char(curr, first, last);
             cell_pos = cell_to_board_pos(ui, curr);
             mvwaddch(ui->board, cell_pos.y, cell_pos.x, corner_char);
         }
@@ -317,147 +872,399 @@ void draw_5x5_guide_grid(struct game_ui *ui)
 
 void draw_clues(struct game_ui *ui)
 {
-    int row_clues_size = get_row_clueline_size(ui->puzzle);
-    int col_clues_size = get_col_clueline_size(ui->puzzle);
-
-    struct cell curr = {0, 0};
-    for (; curr.row < ui->puzzle->n_rows; curr.row++)
+    for (int axis = AXIS_ROW; axis <= AXIS_COL; axis++)
     {
-        struct pos win_pos = cell_to_win_pos(ui, curr);
-        for (int i = row_clues_size - 1; i >= 0; i--)
+        int n_lines = (axis == AXIS_ROW) ? ui->puzzle->n_rows
+                                         : ui->puzzle->n_cols;
+        for (int i = 0; i < n_lines; i++)
         {
-            int clue = ui->puzzle->row_clues[curr.row][i];
-            if (clue != 0)
+            const struct clue_line *line = &ui->clues.lines[axis][i];
+            if (!line->in_view)
             {
-                // y + 1 for middle of the cell height 
-                // x - 3 for space + digits width
-                mvwprintw(ui->win, win_pos.y + 1, win_pos.x - 3, "%3d", clue);
-                win_pos.x -= 3;
+                continue;
             }
-        }
-    }
-
-    curr = (struct cell){0, 0};
-    for (; curr.col < ui->puzzle->n_cols; curr.col++)
-    {
-        struct pos win_pos = cell_to_win_pos(ui, curr);
-        for (int i = col_clues_size - 1; i >= 0; i--)
-        {
-            int clue = ui->puzzle->col_clues[curr.col][i];
-            if (clue != 0)
+            for (int j = 0; j < line->n_clues; j++)
             {
-                // y - 1 for space above the board 
-                // x + 1 to make single digit clue to be in the middle
-                mvwprintw(ui->win, win_pos.y - 1, win_pos.x + 1, "%2d", clue);
-                win_pos.y -= 1;
+                const struct clue_span *clue = &line->clues[j];
+                mvwprintw(ui->win, clue->start.y, clue->start.x,
+                          "%*d", clue->width, clue->value);
             }
         }
     }
 }
 
-void draw_cell(struct game_ui *ui, struct cell cell, enum cell_state state)
+void draw_cell(struct game_ui *ui, const struct game_state *state,
+               struct cell cell)
 {
-    struct pos cell_pos = cell_to_board_pos(ui, cell);
-
-    // Altchar
-    if (state == CELL_FILLED)
+    if (!is_cell_in_view(ui, cell))
     {
-        wattron(ui->board, COLOR_PAIR(NTERM_COLOR_FILLED));
-        for (int dx = 1; dx < CELL_WIDTH; dx++)
-        {
-            mvwaddch(ui->board, cell_pos.y + 1, cell_pos.x + dx, ACS_CKBOARD);
-        }
-        wattroff(ui->board, COLOR_PAIR(NTERM_COLOR_FILLED));
+        return;
+    }
+    if (ui->cell_mode == CELL_MODE_HALF_BLOCK)
+    {
+        draw_half_block_cell(ui, state, cell);
         return;
     }
 
-    // Normal char
-    char *cell_state_str;
-    switch (state)
+    // Inside of the cell, right of and below the grid lines
+    int grid_width      = has_grid(ui) ? 1 : 0;
+    int width           = ui->cell_size.x - grid_width;
+    struct pos cell_pos = cell_to_board_pos(ui, cell);
+    cell_pos.y += grid_width;
+    cell_pos.x += grid_width;
+
+    enum cell_state cell_state = get_cell_state(state, cell);
+    struct style style = get_cell_style(ui, cell, cell_state,
+                                        is_cell_selected(ui, cell));
+
+    // Marks are repeated over the width, or drawn once in the middle
+    chtype mark;
+    bool centered = false;
+    switch (cell_state)
     {
         case CELL_EMPTY:
-            cell_state_str = "   ";
+            mark = ' ';
+            break;
+        case CELL_FILLED:
+            mark = ACS_CKBOARD;
             break;
         case CELL_XMARKED:
-            cell_state_str = "XXX";
+            mark = 'X';
             break;
         case CELL_TEMP_FILLED:
-            cell_state_str = " . ";
+            mark = '.';
+            centered = true;
             break;
         case CELL_TEMP_XMARKED:
-            cell_state_str = " x ";
+            mark = 'x';
+            centered = true;
             break;
         default:
-            LOGF(LOG_WARNING, "Unhandled cell_state: %d", state);
-            cell_state_str = "   ";
+            LOGF(LOG_WARNING, "Unhandled cell_state: %d", cell_state);
+            mark = ' ';
             break;
     }
-    mvwprintw(ui->board, cell_pos.y + 1, cell_pos.x + 1, "%s", cell_state_str);
+
+    wattron(ui->board, COLOR_PAIR(style.color_p));
+    for (int dx = 0; dx < width; dx++)
+    {
+        chtype ch = (centered && dx != width / 2) ? ' ' : mark;
+        mvwaddch(ui->board, cell_pos.y, cell_pos.x + dx, ch);
+    }
+    wattroff(ui->board, COLOR_PAIR(style.color_p));
 }
 
-void highlight_cell(struct game_ui *ui, struct cell cell, short color_p)
+void draw_half_block_cell(struct game_ui *ui, const struct game_state *state,
+                          struct cell cell)
 {
-    assert(ui != NULL);
-    assert(ui->board != NULL);
+    // Pairs start at the top of the view
+    struct cell upper =
+    {
+        .row = ui->view_start.row + (cell.row - ui->view_start.row) / 2 * 2,
+        .col = cell.col
+    };
+    struct cell lower = {upper.row + 1, upper.col};
+
+    short fg = get_half_block_color(ui, state, upper);
+    short bg = is_cell_in_view(ui, lower)
+               ? get_half_block_color(ui, state, lower) : COLOR_BLACK;
+
+    cchar_t half_block;
+    setcchar(&half_block, HALF_BLOCK_UPPER, A_NORMAL, get_color_pair(fg, bg),
+             NULL);
 
-    struct pos curr = cell_to_board_pos(ui, cell);
-    for (int dy = 0; dy <= CELL_HEIGHT; dy++)
+    struct pos cell_pos = cell_to_board_pos(ui, upper);
+    for (int dx = 0; dx < ui->cell_size.x; dx++)
     {
-        for (int dx = 0; dx <= CELL_WIDTH; dx++)
+        mvwadd_wch(ui->board, cell_pos.y, cell_pos.x + dx, &half_block);
+    }
+}
+
+struct style get_cell_style(const struct game_ui *ui, struct cell cell,
+                            enum cell_state state, bool selected)
+{
+    bool shaded = !has_grid(ui) && is_shaded_block(cell);
+
+    struct style style = {.attr = A_NORMAL};
+    if (state == CELL_FILLED)
+    {
+        style.attr    = A_ALTCHARSET;
+        style.color_p = selected ? NTERM_COLOR_FILLED_SELECTED
+                        : shaded ? get_color_pair(COLOR_BLUE, get_shade_color())
+                                 : NTERM_COLOR_FILLED;
+    }
+    else
+    {
+        style.color_p = selected ? NTERM_COLOR_SELECTED
+                        : shaded ? get_color_pair(COLOR_WHITE, get_shade_color())
+                                 : NTERM_COLOR_DEFAULT;
+    }
+    return style;
+}
+
+short get_half_block_color(const struct game_ui *ui,
+                           const struct game_state *state, struct cell cell)
+{
+    bool selected = is_cell_selected(ui, cell);
+
+    short color;
+    switch (get_cell_state(state, cell))
+    {
+        case CELL_FILLED:
+            color = COLOR_BLUE;
+            break;
+        case CELL_XMARKED:
+            color = COLOR_RED;
+            break;
+        case CELL_TEMP_FILLED:
+            color = COLOR_YELLOW;
+            break;
+        case CELL_TEMP_XMARKED:
+            color = COLOR_MAGENTA;
+            break;
+        default:
+            if (selected)
+            {
+                return (COLORS >= 255) ? COLOR_DARK_GREY : COLOR_WHITE;
+            }
+            return is_shaded_block(cell) ? get_shade_color() : COLOR_BLACK;
+    }
+
+    // Bright variant under the selection
+    if (selected)
+    {
+        return (COLORS >= 16) ? color + 8 : COLOR_WHITE;
+    }
+    return color;
+}
+
+bool is_cell_selected(const struct game_ui *ui, struct cell cell)
+{
+    return ui->has_selection
+           && is_cell_in_area(cell, ui->sel_start, ui->sel_end);
+}
+
+bool is_cell_in_area(struct cell cell, struct cell start, struct cell end)
+{
+    return cell.row >= start.row && cell.row <= end.row
+           && cell.col >= start.col && cell.col <= end.col;
+}
+
+void redraw_selection_cells(struct game_ui *ui, const struct game_state *state,
+                            bool had_selection, struct cell old_start,
+                            struct cell old_end)
+{
+    struct cell first = ui->sel_start;
+    struct cell last  = ui->sel_end;
+    if (had_selection)
+    {
+        first.row = MIN(first.row, old_start.row);
+        first.col = MIN(first.col, old_start.col);
+        last.row  = MAX(last.row, old_end.row);
+        last.col  = MAX(last.col, old_end.col);
+    }
+
+    // Only the visible part
+    struct cell view_end = get_view_end(ui);
+    first.row = MAX(first.row, ui->view_start.row);
+    first.col = MAX(first.col, ui->view_start.col);
+    last.row  = MIN(last.row, view_end.row - 1);
+    last.col  = MIN(last.col, view_end.col - 1);
+
+    struct cell curr;
+    for (curr.row = first.row; curr.row <= last.row; curr.row++)
+    {
+        for (curr.col = first.col; curr.col <= last.col; curr.col++)
         {
-            attr_t curr_attr = A_NORMAL;
-            // Altcharset/normal char should be handled differently
-            if (mvwinch(ui->board, curr.y + dy, curr.x + dx) & A_ALTCHARSET)
+            bool in_old = had_selection
+                          && is_cell_in_area(curr, old_start, old_end);
+            if (in_old != is_cell_selected(ui, curr))
             {
-                curr_attr |= A_ALTCHARSET;
+                draw_cell(ui, state, curr);
             }
+        }
+    }
+}
+
+void selection_board_area(struct game_ui *ui, struct cell start, struct cell end,
+                          struct pos *top_left, struct pos *bottom_right)
+{
+    // Only the visible part
+    struct cell view_end = get_view_end(ui);
+    start.row = MAX(start.row, ui->view_start.row);
+    start.col = MAX(start.col, ui->view_start.col);
+    end.row   = MIN(end.row, view_end.row - 1);
+    end.col   = MIN(end.col, view_end.col - 1);
+    if (start.row > end.row || start.col > end.col)
+    {
+        *top_left     = (struct pos){0, 0};
+        *bottom_right = (struct pos){-1, -1};
+        return;
+    }
+
+    // Borders are shared with the neighbouring cells
+    end.row++;
+    end.col++;
+    *top_left     = cell_to_board_pos(ui, start);
+    *bottom_right = cell_to_board_pos(ui, end);
+}
+
+struct style get_board_pos_style(struct game_ui *ui,
+                                 const struct game_state *state,
+                                 struct pos pos, bool selected)
+{
+    bool on_row_line = pos.y % CELL_HEIGHT == 0;
+    bool on_col_line = pos.x % CELL_WIDTH == 0;
+    struct cell cell =
+    {
+        .row = ui->view_start.row + pos.y / CELL_HEIGHT,
+        .col = ui->view_start.col + pos.x / CELL_WIDTH,
+    };
 
-            mvwchgat(ui->board, 
-                     curr.y + dy, curr.x + dx, 1, curr_attr, color_p, NULL);
+    struct style style =
+    {
+        .attr    = A_NORMAL,
+        .color_p = selected ? NTERM_COLOR_SELECTED : NTERM_COLOR_DEFAULT,
+    };
+
+    if (on_row_line || on_col_line)
+    {
+        // 5x5 guide lines are line drawing chars, the 1x1 grid is ascii
+        if ((on_row_line && is_guide_line(ui, AXIS_ROW, cell.row))
+            || (on_col_line && is_guide_line(ui, AXIS_COL, cell.col)))
+        {
+            style.attr = A_ALTCHARSET;
         }
     }
+    else if (pos.y % CELL_HEIGHT == 1)
+    {
+        style = get_cell_style(ui, cell, get_cell_state(state, cell), selected);
+    }
+
+    return style;
+}
+
+void restyle_board_line(struct game_ui *ui, const struct game_state *state,
+                        int y, int from_x, int to_x, bool selected)
+{
+    int x = from_x;
+    while (x <= to_x)
+    {
+        struct style style = get_board_pos_style(ui, state, (struct pos){y, x},
+                                                 selected);
+        int run_start = x;
+        for (x++; x <= to_x; x++)
+        {
+            struct style next = get_board_pos_style(ui, state,
+                                                    (struct pos){y, x},
+                                                    selected);
+            if (next.attr != style.attr || next.color_p != style.color_p)
+            {
+                break;
+            }
+        }
+        mvwchgat(ui->board, y, run_start, x - run_start,
+                 style.attr, style.color_p, NULL);
+    }
 }
 
 void draw_board_state(struct game_ui *ui, const struct game_state *state)
+{
+    struct cell end = get_view_end(ui);
+    end.row--;
+    end.col--;
+    draw_area_state(ui, state, ui->view_start, end);
+}
+
+void draw_area_state(struct game_ui *ui, const struct game_state *state,
+                     struct cell start, struct cell end)
 {
     struct cell curr;
-    for (curr.row = 0; curr.row < ui->puzzle->n_rows; curr.row++)
+    for (curr.row = start.row; curr.row <= end.row; curr.row++)
     {
-        for (curr.col = 0; curr.col < ui->puzzle->n_cols; curr.col++)
+        for (curr.col = start.col; curr.col <= end.col; curr.col++)
         {
-            enum cell_state cell_state = get_cell_state(state, curr);
-            draw_cell(ui, curr, cell_state);
+            draw_cell(ui, state, curr);
         }
     }
 }
 
-void colorize_correct_rows(struct game_ui *ui, const struct game_state *state)
+void draw_changed_cells(struct game_ui *ui, const struct game_state *state)
 {
-    int left_padding = UI_WIN_PADDING;
-    for (int i = 0; i < ui->puzzle->n_rows; i++)
+    struct cell end = get_view_end(ui);
+
+    struct cell curr;
+    for (curr.row = ui->view_start.row; curr.row < end.row; curr.row++)
     {
-        /*attr_t attr = validate_axis(state, AXIS_ROW, i) ? A_REVERSE : A_NORMAL;*/
-        short color_p = validate_axis(state, AXIS_ROW, i) ? NTERM_COLOR_CLUE_CORRECT : NTERM_COLOR_DEFAULT;
+        const uint64_t *changed = changed_cells(state, curr.row);
+        curr.col = bitline_next_set(changed, end.col, ui->view_start.col);
+        while (curr.col < end.col)
+        {
+            draw_cell(ui, state, curr);
+            curr.col = bitline_next_set(changed, end.col, curr.col + 1);
+        }
+    }
+}
 
-        struct cell curr   = {i, 0};
-        struct pos win_pos = cell_to_win_pos(ui, curr);
-        mvwchgat(ui->win, 
-                 win_pos.y + 1, left_padding, 
-                 win_pos.x - left_padding, A_NORMAL, color_p, NULL);
+void colorize_correct_rows(struct game_ui *ui, const struct game_state *state)
+{
+    struct cell end = get_view_end(ui);
+    for (int i = ui->view_start.row; i < end.row; i++)
+    {
+        colorize_row_clues(ui, state, i);
     }
 }
+
 void colorize_correct_cols(struct game_ui *ui, const struct game_state *state)
 {
-    int top_padding = UI_WIN_PADDING;
-    for (int j = 0; j < ui->puzzle->n_cols; j++)
+    struct cell end = get_view_end(ui);
+    for (int j = ui->view_start.col; j < end.col; j++)
     {
-        short color_p = validate_axis(state, AXIS_COL, j) ? NTERM_COLOR_CLUE_CORRECT : NTERM_COLOR_DEFAULT;
+        colorize_col_clues(ui, state, j);
+    }
+}
 
-        struct cell curr   = {0, j};
-        struct pos win_pos = cell_to_win_pos(ui, curr);
-        for (int y = top_padding; y < win_pos.y; y++)
+void colorize_changed_lines(struct game_ui *ui, const struct game_state *state)
+{
+    struct cell end = get_view_end(ui);
+    for (int i = ui->view_start.row; i < end.row; i++)
+    {
+        if (is_axis_changed(state, AXIS_ROW, i))
         {
-            mvwchgat(ui->win, y, win_pos.x + 1, 3, A_NORMAL, color_p, NULL);
+            colorize_row_clues(ui, state, i);
         }
     }
+    for (int j = ui->view_start.col; j < end.col; j++)
+    {
+        if (is_axis_changed(state, AXIS_COL, j))
+        {
+            colorize_col_clues(ui, state, j);
+        }
+    }
+}
+
+void colorize_row_clues(struct game_ui *ui, const struct game_state *state, int row)
+{
+    short color_p = is_axis_solved(state, AXIS_ROW, row) ? NTERM_COLOR_CLUE_CORRECT : NTERM_COLOR_DEFAULT;
+    colorize_clue_line(ui, &ui->clues.lines[AXIS_ROW][row], color_p);
+}
+
+void colorize_col_clues(struct game_ui *ui, const struct game_state *state, int col)
+{
+    short color_p = is_axis_solved(state, AXIS_COL, col) ? NTERM_COLOR_CLUE_CORRECT : NTERM_COLOR_DEFAULT;
+    colorize_clue_line(ui, &ui->clues.lines[AXIS_COL][col], color_p);
+}
+
+void colorize_clue_line(struct game_ui *ui, const struct clue_line *line,
+                        short color_p)
+{
+    if (!line->in_view)
+    {
+        return;
+    }
+    for (int dy = 0; dy < line->region_height; dy++)
+    {
+        mvwchgat(ui->win, line->region_start.y + dy, line->region_start.x,
+                 line->region_width, A_NORMAL, color_p, NULL);
+    }
 }
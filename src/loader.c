@@ -1,20 +1,50 @@
 #include <dirent.h>
 #include <errno.h>
 #include <string.h>
+#include <sys/stat.h>
 
 #include "loader.h"
 #include "utils.h"
 
+#define JSON_MAX_NUMBER_LEN 63
+
 /* Function Prototypes */
 
 long get_file_size(FILE *fp);
 DIR *open_directory(const char *dir_name);
 
-struct dirent *next_json_entry(DIR *dir);
+struct dirent *next_entry_with_ext(DIR *dir, const char *ext);
 char *construct_file_path(const char *dir_name, const char *file_name);
 
-bool is_valid_property_type(const cJSON *obj, struct json_property prop);
-bool is_valid_property_range(const cJSON *obj, struct json_property prop);
+bool reader_fill(struct json_reader *r);
+bool reader_fail(struct json_reader *r);
+
+/**
+ * Step into the object or array at the current position.
+ * @retval false if it is nested too deep
+ */
+bool reader_enter(struct json_reader *r);
+void reader_skip_ws(struct json_reader *r);
+bool reader_expect(struct json_reader *r, char c);
+bool reader_read_escape(struct json_reader *r, char *buf, size_t size,
+                        int *len);
+void reader_put_char(char *buf, size_t size, int *len, char c);
+bool reader_skip_literal(struct json_reader *r, const char *literal);
+
+static inline int reader_peek(struct json_reader *r)
+{
+    if (r->pos == r->len && !reader_fill(r)) return EOF;
+    return (unsigned char)r->buf[r->pos];
+}
+
+static inline void reader_advance(struct json_reader *r)
+{
+    r->pos++;
+}
+
+struct json_value_info json_value_info_from_cJSON(const cJSON *obj);
+
+const char *json_size_name(int type);
 
 /* Public */
 
@@ -68,9 +98,33 @@ cleanup:
     return NULL;
 }
 
+bool get_file_info(const char *file_name, struct file_info *info_out)
+{
+    assert(file_name != NULL);
+    assert(info_out != NULL);
+
+    struct stat st;
+    if (stat(file_name, &st) != 0 || !S_ISREG(st.st_mode))
+    {
+        return false;
+    }
+
+    info_out->mtime_ns = (long long)st.st_mtim.tv_sec * 1000000000LL
+                         + st.st_mtim.tv_nsec;
+    info_out->size     = st.st_size;
+    return true;
+}
+
 char **list_json_files(const char *dir_name, int *n_files_out)
+{
+    return list_files_with_ext(dir_name, ".json", n_files_out);
+}
+
+char **list_files_with_ext(const char *dir_name, const char *ext,
+                           int *n_files_out)
 {
     assert(dir_name != NULL);
+    assert(ext != NULL);
     assert(n_files_out != NULL);
 
     DIR *dir = NULL;
@@ -81,7 +135,7 @@ char **list_json_files(const char *dir_name, int *n_files_out)
     if (dir == NULL) return NULL;
 
     // Count numbers first to allocate memory
-    while (next_json_entry(dir) != NULL)
+    while (next_entry_with_ext(dir, ext) != NULL)
     {
         files_cnt++;
     }
@@ -99,7 +153,7 @@ char **list_json_files(const char *dir_name, int *n_files_out)
 
     // Store 
     struct dirent *entry;
-    while ((entry = next_json_entry(dir)) != NULL)
+    while ((entry = next_entry_with_ext(dir, ext)) != NULL)
     {
         char *file_path = construct_file_path(dir_name, entry->d_name);
         if (file_path == NULL)
@@ -122,9 +176,248 @@ cleanup:
 bool is_valid_json_property(const cJSON *json, const struct json_property prop)
 {
     cJSON *obj = get_cJSON(json, prop);
+    return is_valid_json_value(json_value_info_from_cJSON(obj), prop);
+}
 
-    return (is_valid_property_type(obj, prop) &&
-            is_valid_property_range(obj, prop));
+bool is_json_value_in_spec(struct json_value_info info,
+                           const struct json_property prop)
+{
+    return info.type == prop.type
+           && info.size >= prop.min && info.size <= prop.max;
+}
+
+bool is_valid_json_value(struct json_value_info info,
+                         const struct json_property prop)
+{
+    if (info.type != prop.type)
+    {
+        LOGF(LOG_WARNING,
+            "Invalid or missing JSON property: '%s'", prop.name);
+        return false;
+    }
+
+    if (info.size < prop.min || info.size > prop.max)
+    {
+        LOGF(LOG_WARNING, 
+             "Invalid range for JSON attribute '%s' %s: "
+             "Got %d, Expected %d to %d", 
+             prop.name, json_size_name(prop.type), info.size,
+             prop.min, prop.max);
+
+        return false;
+    }
+    return true;
+}
+
+bool json_reader_open(struct json_reader *r, const char *file_name)
+{
+    assert(r != NULL);
+    assert(file_name != NULL);
+
+    *r = (struct json_reader){.file_name = file_name};
+    r->fp = fopen(file_name, "r");
+    if (r->fp == NULL)
+    {
+        LOGF(LOG_ERROR, "Failed to open file: '%s'", file_name);
+        return false;
+    }
+    return true;
+}
+
+void json_reader_close(struct json_reader *r)
+{
+    if (r->fp != NULL)
+    {
+        fclose(r->fp);
+    }
+    r->fp = NULL;
+}
+
+int json_peek_type(struct json_reader *r)
+{
+    if (r->error) return cJSON_Invalid;
+
+    reader_skip_ws(r);
+    switch (reader_peek(r))
+    {
+        case '{': return cJSON_Object;
+        case '[': return cJSON_Array;
+        case '"': return cJSON_String;
+        case 't': return cJSON_True;
+        case 'f': return cJSON_False;
+        case 'n': return cJSON_NULL;
+        case '-':
+        case '0': case '1': case '2': case '3': case '4':
+        case '5': case '6': case '7': case '8': case '9':
+            return cJSON_Number;
+        default:
+            reader_fail(r);
+            return cJSON_Invalid;
+    }
+}
+
+bool json_enter_object(struct json_reader *r)
+{
+    if (json_peek_type(r) != cJSON_Object) return false;
+    return reader_enter(r);
+}
+
+bool json_enter_array(struct json_reader *r)
+{
+    if (json_peek_type(r) != cJSON_Array) return false;
+    return reader_enter(r);
+}
+
+bool json_next_member(struct json_reader *r, char *key, size_t key_size)
+{
+    if (r->error) return false;
+
+    reader_skip_ws(r);
+    if (reader_peek(r) == '}')
+    {
+        reader_advance(r);
+        r->need_comma = true;
+        r->depth--;
+        return false;
+    }
+    if (r->need_comma && !reader_expect(r, ','))
+    {
+        return reader_fail(r);
+    }
+
+    reader_skip_ws(r);
+    if (json_read_string(r, key, key_size) < 0) return false;
+
+    reader_skip_ws(r);
+    if (!reader_expect(r, ':'))
+    {
+        return reader_fail(r);
+    }
+    return true;
+}
+
+bool json_next_element(struct json_reader *r)
+{
+    if (r->error) return false;
+
+    reader_skip_ws(r);
+    if (reader_peek(r) == ']')
+    {
+        reader_advance(r);
+        r->need_comma = true;
+        r->depth--;
+        return false;
+    }
+    if (r->need_comma && !reader_expect(r, ','))
+    {
+        return reader_fail(r);
+    }
+    return true;
+}
+
+int json_read_string(struct json_reader *r, char *buf, size_t size)
+{
+    assert(buf != NULL && size > 0);
+
+    if (json_peek_type(r) != cJSON_String)
+    {
+        reader_fail(r);
+        return -1;
+    }
+    reader_advance(r);
+
+    int len = 0;
+    int c;
+    while ((c = reader_peek(r)) != '"')
+    {
+        if (c == EOF || c < 0x20)
+        {
+            reader_fail(r);
+            return -1;
+        }
+
+        reader_advance(r);
+        if (c == '\\')
+        {
+            if (!reader_read_escape(r, buf, size, &len))
+            {
+                reader_fail(r);
+                return -1;
+            }
+        }
+        else
+        {
+            reader_put_char(buf, size, &len, (char)c);
+        }
+    }
+    reader_advance(r);
+
+    buf[MIN((size_t)len, size - 1)] = '\0';
+    r->need_comma = true;
+    return len;
+}
+
+bool json_read_number(struct json_reader *r, double *value_out)
+{
+    if (json_peek_type(r) != cJSON_Number)
+    {
+        return reader_fail(r);
+    }
+
+    char num[JSON_MAX_NUMBER_LEN + 1];
+    int len = 0;
+    int c;
+    while (len < JSON_MAX_NUMBER_LEN && (c = reader_peek(r)) != EOF
+           && strchr("+-0123456789.eE", c) != NULL)
+    {
+        num[len++] = (char)c;
+        reader_advance(r);
+    }
+    num[len] = '\0';
+
+    char *end;
+    *value_out = strtod(num, &end);
+    if (*end != '\0')
+    {
+        return reader_fail(r);
+    }
+
+    r->need_comma = true;
+    return true;
+}
+
+bool json_skip_value(struct json_reader *r)
+{
+    char tmp[1];
+    double num;
+
+    switch (json_peek_type(r))
+    {
+        case cJSON_String: return json_read_string(r, tmp, sizeof(tmp)) >= 0;
+        case cJSON_Number: return json_read_number(r, &num);
+        case cJSON_True:   return reader_skip_literal(r, "true");
+        case cJSON_False:  return reader_skip_literal(r, "false");
+        case cJSON_NULL:   return reader_skip_literal(r, "null");
+
+        case cJSON_Object:
+            json_enter_object(r);
+            while (json_next_member(r, tmp, sizeof(tmp)))
+            {
+                if (!json_skip_value(r)) return false;
+            }
+            return !r->error;
+
+        case cJSON_Array:
+            json_enter_array(r);
+            while (json_next_element(r))
+            {
+                if (!json_skip_value(r)) return false;
+            }
+            return !r->error;
+
+        default:
+            return false;
+    }
 }
 
 cJSON *cJSON_parse_file(const char *file_name)
@@ -189,7 +482,7 @@ DIR *open_directory(const char *dir_name)
     return dir;
 }
 
-struct dirent *next_json_entry(DIR *dir)
+struct dirent *next_entry_with_ext(DIR *dir, const char *ext)
 {
     assert(dir != NULL);
 
@@ -198,8 +491,8 @@ struct dirent *next_json_entry(DIR *dir)
     {
         if (entry->d_type == DT_REG || entry->d_type == DT_UNKNOWN)
         {
-            char *ext = strrchr(entry->d_name, '.');
-            if (ext != NULL && strcmp(ext, ".json") == 0)
+            char *entry_ext = strrchr(entry->d_name, '.');
+            if (entry_ext != NULL && strcmp(entry_ext, ext) == 0)
             {
                 return entry;
             }
@@ -221,68 +514,159 @@ char *construct_file_path(const char *dir_name, const char *file_name)
     return full_path;
 }
 
-bool is_valid_property_type(const cJSON *obj, const struct json_property prop)
+bool reader_fill(struct json_reader *r)
 {
-    switch (prop.type)
+    if (r->fp == NULL) return false;
+
+    r->buf_offset += r->len;
+    r->len = fread(r->buf, 1, JSON_READER_BUF_SIZE, r->fp);
+    r->pos = 0;
+    return r->len > 0;
+}
+
+bool reader_fail(struct json_reader *r)
+{
+    // Only the first error is reported
+    if (!r->error)
     {
-        case cJSON_String:
-            if (cJSON_IsString(obj) && obj->valuestring)
-                return true;
-            break;
-        case cJSON_Number:
-            if (cJSON_IsNumber(obj))
-                return true;
-            break;
-        case cJSON_Array:
-            if (cJSON_IsArray(obj))
-                return true;
-            break;
-        default:
-            // @TODO Add more types when needed
-            return false;
-            break;
+        LOGF(LOG_WARNING, "JSON Error parsing '%s' at offset %ld",
+             r->file_name, r->buf_offset + (long)r->pos);
     }
-
-    LOGF(LOG_WARNING,
-        "Invalid or missing JSON property: '%s'", prop.name);
+    r->error = true;
     return false;
 }
 
-bool is_valid_property_range(const cJSON *obj, const struct json_property prop)
+bool reader_enter(struct json_reader *r)
+{
+    if (r->depth == JSON_READER_MAX_DEPTH)
+    {
+        return reader_fail(r);
+    }
+    reader_advance(r);
+    r->depth++;
+    r->need_comma = false;
+    return true;
+}
+
+void reader_skip_ws(struct json_reader *r)
 {
-    int         check_val;
-    const char *check_type;
+    int c;
+    while ((c = reader_peek(r)) == ' ' || c == '\t' || c == '\n' || c == '\r')
+    {
+        reader_advance(r);
+    }
+}
 
-    switch (prop.type)
+bool reader_expect(struct json_reader *r, char c)
+{
+    if (reader_peek(r) != c) return false;
+    reader_advance(r);
+    return true;
+}
+
+bool reader_read_escape(struct json_reader *r, char *buf, size_t size,
+                        int *len)
+{
+    int c = reader_peek(r);
+    reader_advance(r);
+
+    switch (c)
     {
-        case cJSON_String:
-            check_val  = strlen(obj->valuestring);
-            check_type = "text length";
-            break;
-        case cJSON_Number:
-            check_val  = obj->valueint;
-            check_type = "value";
-            break;
-        case cJSON_Array:
-            check_val  = cJSON_GetArraySize(obj);
-            check_type = "array size";
-            break;
-        default:
-            // @TODO Add more types when needed
-            return false;
-            break;
+        case '"':  reader_put_char(buf, size, len, '"');  return true;
+        case '\\': reader_put_char(buf, size, len, '\\'); return true;
+        case '/':  reader_put_char(buf, size, len, '/');  return true;
+        case 'b':  reader_put_char(buf, size, len, '\b'); return true;
+        case 'f':  reader_put_char(buf, size, len, '\f'); return true;
+        case 'n':  reader_put_char(buf, size, len, '\n'); return true;
+        case 'r':  reader_put_char(buf, size, len, '\r'); return true;
+        case 't':  reader_put_char(buf, size, len, '\t'); return true;
+        case 'u':  break;
+        default:   return false;
+    }
 
+    unsigned code = 0;
+    for (int i = 0; i < 4; i++, reader_advance(r))
+    {
+        int d = reader_peek(r);
+        if      (d >= '0' && d <= '9') code = code * 16 + (d - '0');
+        else if (d >= 'a' && d <= 'f') code = code * 16 + (d - 'a' + 10);
+        else if (d >= 'A' && d <= 'F') code = code * 16 + (d - 'A' + 10);
+        else return false;
     }
 
-    if (check_val < prop.min || check_val > prop.max)
+    // Surrogate pairs are not combined, the code point is written as is
+    if (code < 0x80)
     {
-        LOGF(LOG_WARNING, 
-             "Invalid range for JSON attribute '%s' %s: "
-             "Got %d, Expected %d to %d", 
-             prop.name, check_type, check_val, prop.min, prop.max);
+        reader_put_char(buf, size, len, (char)code);
+    }
+    else if (code < 0x800)
+    {
+        reader_put_char(buf, size, len, (char)(0xC0 | (code >> 6)));
+        reader_put_char(buf, size, len, (char)(0x80 | (code & 0x3F)));
+    }
+    else
+    {
+        reader_put_char(buf, size, len, (char)(0xE0 | (code >> 12)));
+        reader_put_char(buf, size, len, (char)(0x80 | ((code >> 6) & 0x3F)));
+        reader_put_char(buf, size, len, (char)(0x80 | (code & 0x3F)));
+    }
+    return true;
+}
 
-        return false;
+void reader_put_char(char *buf, size_t size, int *len, char c)
+{
+    // Count everything, keep what fits
+    if ((size_t)*len + 1 < size)
+    {
+        buf[*len] = c;
     }
+    (*len)++;
+}
+
+bool reader_skip_literal(struct json_reader *r, const char *literal)
+{
+    for (const char *p = literal; *p != '\0'; p++)
+    {
+        if (!reader_expect(r, *p)) return reader_fail(r);
+    }
+    r->need_comma = true;
     return true;
 }
 
+struct json_value_info json_value_info_from_cJSON(const cJSON *obj)
+{
+    struct json_value_info info = {.type = cJSON_Invalid, .size = 0};
+
+    if (cJSON_IsString(obj) && obj->valuestring)
+    {
+        info.type = cJSON_String;
+        info.size = strlen(obj->valuestring);
+    }
+    else if (cJSON_IsNumber(obj))
+    {
+        info.type = cJSON_Number;
+        info.size = obj->valueint;
+    }
+    else if (cJSON_IsArray(obj))
+    {
+        info.type = cJSON_Array;
+        info.size = cJSON_GetArraySize(obj);
+    }
+    else if (obj != NULL)
+    {
+        info.type = obj->type & 0xFF;
+    }
+
+    return info;
+}
+
+const char *json_size_name(int type)
+{
+    switch (type)
+    {
+        case cJSON_String: return "text length";
+        case cJSON_Number: return "value";
+        case cJSON_Array:  return "array size";
+        default:           return "size";
+    }
+}
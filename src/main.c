@@ -1,5 +1,9 @@
 #include <stdlib.h>
+#include <string.h>
+#include "batch.h"
+#include "bench.h"
 #include "game_control.h"
+#include "pack.h"
 #include "puzzle.h"
 #include "tui.h"
 #include "utils.h"
@@ -27,9 +31,32 @@ char *main_menu_choices[MAIN_MENU_N_CHOICES] =
 
 char *main_menu_title = "Main Menu";
 
-int main(void)
+/**
+ * Non-interactive mode, runs without starting ncurses.
+ * @return Process exit code
+ */
+int run_cli(int argc, char **argv);
+void print_usage(const char *prog_name);
+
+/**
+ * Compile each JSON puzzle set into a pack next to it.
+ * @return Process exit code
+ */
+int run_pack(int n_files, char **file_names);
+
+int main(int argc, char **argv)
 {
     log_init();
+
+    if (argc == 2 && strcmp(argv[1], "--ansi") == 0)
+    {
+        set_frame_renderer(RENDERER_ANSI);
+    }
+    else if (argc > 1)
+    {
+        return run_cli(argc, argv);
+    }
+
     init_screen();
 
     struct menu_param params = 
@@ -76,12 +103,14 @@ int main(void)
 
             case MAIN_MENU_DEBUG:
                 color_pairs_test();
-                refresh();
+                frame_stage(stdscr);
+                frame_display();
                 getch();
                 clear();
 
                 color_test();
-                refresh();
+                frame_stage(stdscr);
+                frame_display();
                 getch();
                 clear();
                 break;
@@ -103,3 +132,145 @@ int main(void)
     menu_set_destroy(mset);
     display_notification("Exiting...");
 }
+
+int run_cli(int argc, char **argv)
+{
+    const char *validate_dir   = NULL;
+    struct batch_config config = batch_config_default;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--pack") == 0 && has_value)
+        {
+            return run_pack(argc - i - 1, &argv[i + 1]);
+        }
+        else if (strcmp(argv[i], "--bench-scan") == 0 && has_value)
+        {
+            const char *tmp_dir = getenv("TMPDIR");
+            int ret = bench_scan(argv[i + 1], tmp_dir ? tmp_dir : "/tmp", stdout);
+            return (ret < 0) ? 2 : 0;
+        }
+        else if (strcmp(argv[i], "--bench-input") == 0 && has_value)
+        {
+            int ret = bench_input(argv[i + 1], stdout);
+            return (ret < 0) ? 2 : 0;
+        }
+        else if (strcmp(argv[i], "--bench-render") == 0 && has_value)
+        {
+            int ret = bench_render(argv[i + 1], stdout);
+            return (ret < 0) ? 2 : 0;
+        }
+        else if (strcmp(argv[i], "--bench-resize") == 0 && has_value)
+        {
+            int ret = bench_resize(argv[i + 1], stdout);
+            return (ret < 0) ? 2 : 0;
+        }
+        else if (strcmp(argv[i], "--bench-undo") == 0 && has_value)
+        {
+            int ret = bench_undo(argv[i + 1], stdout);
+            return (ret < 0) ? 2 : 0;
+        }
+        else if (strcmp(argv[i], "--bench-capture") == 0 && has_value)
+        {
+            int ret = bench_capture(argv[i + 1], stdout);
+            return (ret < 0) ? 2 : 0;
+        }
+        else if (strcmp(argv[i], "--snapshot") == 0 && i + 2 < argc)
+        {
+            int ret = render_snapshot(argv[i + 1], argv[i + 2], stdout);
+            return (ret < 0) ? 2 : 0;
+        }
+        else if (strcmp(argv[i], "--validate") == 0 && has_value)
+        {
+            validate_dir = argv[++i];
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && has_value)
+        {
+            config.n_threads = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--max-guesses") == 0 && has_value)
+        {
+            config.max_guesses = atol(argv[++i]);
+        }
+        else
+        {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (validate_dir == NULL)
+    {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    int ret = batch_validate(validate_dir, config, stdout);
+    return (ret < 0) ? 2 : ret;
+}
+
+int run_pack(int n_files, char **file_names)
+{
+    int n_failed = 0;
+    for (int i = 0; i < n_files; i++)
+    {
+        struct puzzle_set *pset = puzzle_set_create(file_names[i], LOAD_ALL);
+        char *pack_name = pack_file_name(file_names[i]);
+        if (pset == NULL || pack_name == NULL
+            || is_pack_file_name(file_names[i])
+            || pack_write(pset, pack_name) != 0)
+        {
+            fprintf(stderr, "Failed to pack: %s\n", file_names[i]);
+            n_failed++;
+        }
+        else
+        {
+            fprintf(stderr, "%s -> %s (%d puzzles)\n",
+                    file_names[i], pack_name, pset->num_puzzles);
+        }
+        free(pack_name);
+        puzzle_set_destroy(pset);
+    }
+    return (n_failed > 0) ? 1 : 0;
+}
+
+void print_usage(const char *prog_name)
+{
+    fprintf(stderr,
+            "Usage: %s [--ansi]\n"
+            "       %s --validate DIR [--threads N] [--max-guesses N]\n"
+            "       %s --pack FILE.json...\n"
+            "       %s --bench-scan FILE.json\n"
+            "       %s --bench-input FILE.json\n"
+            "       %s --bench-render FILE.json\n"
+            "       %s --bench-resize FILE.json\n"
+            "       %s --bench-undo FILE.json\n"
+            "       %s --bench-capture FILE.json\n"
+            "       %s --snapshot FILE.json KEYS\n"
+            "\n"
+            "  (no arguments)     Start the game\n"
+            "  --ansi             Start the game, drawn with plain ANSI\n"
+            "                     sequences instead of ncurses' output\n"
+            "  --validate DIR     Solve every puzzle in DIR, one JSON line each\n"
+            "  --threads N        Worker threads, default one per CPU\n"
+            "  --max-guesses N    Search budget per puzzle, default unlimited\n"
+            "  --pack FILE...     Compile JSON puzzle sets into .npk packs\n"
+            "  --bench-scan FILE  Time the puzzle set menu scan of 10 to 10,000\n"
+            "                     copies of FILE, in $TMPDIR or /tmp\n"
+            "  --bench-input FILE Frames drawn per key for bursts of repeated\n"
+            "                     keys on the first puzzle of FILE\n"
+            "  --bench-render FILE Screen cells, attribute changes, bytes and\n"
+            "                     time per frame of scripted keys, in each cell\n"
+            "                     mode, with ncurses and the ANSI renderer\n"
+            "  --bench-resize FILE Time to lay out and draw the first puzzle of\n"
+            "                     FILE after each resize of a terminal drag\n"
+            "  --bench-undo FILE  Time to push, undo and redo board operations\n"
+            "                     on the first puzzle of FILE, and undo memory\n"
+            "  --bench-capture FILE Time and memory of board captures that\n"
+            "                     differ by 1 to all cells, and their restores\n"
+            "  --snapshot FILE KEYS Play KEYS on the first puzzle of FILE and\n"
+            "                     print the final screen and its color pairs\n",
+            prog_name, prog_name, prog_name, prog_name, prog_name, prog_name,
+            prog_name, prog_name, prog_name, prog_name);
+}
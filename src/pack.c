@@ -0,0 +1,327 @@
+#include "pack.h"
+#include "utils.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Function prototypes */
+
+/**
+ * Check header, index and clue ranges of a mapped pack.
+ */
+bool is_valid_pack(const void *map, size_t map_size, const char *file_name);
+bool is_valid_pack_entry(const struct npk_entry *entry, size_t map_size);
+
+/**
+ * Build a puzzle whose clue lines point into the mapped clue data.
+ */
+struct puzzle *puzzle_create_from_pack(const void *map,
+                                       const struct npk_entry *entry);
+
+int **clue_lines_create(const void *map, uint32_t offset,
+                        int n_lines, int clueline_size);
+
+static inline size_t clue_data_size(int n_lines, int clueline_size)
+{
+    return (size_t)n_lines * clueline_size * sizeof(int);
+}
+
+static inline bool is_terminated(const char *str, size_t size)
+{
+    return memchr(str, '\0', size) != NULL;
+}
+
+/* Public */
+
+struct puzzle_set *pack_load(const char *file_name, enum load_mode mode)
+{
+    assert(file_name != NULL);
+
+    int fd = open(file_name, O_RDONLY);
+    if (fd < 0)
+    {
+        LOGF(LOG_ERROR, "Failed to open file: '%s'", file_name);
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(struct npk_header))
+    {
+        LOGF(LOG_WARNING, "Invalid pack file size: '%s'", file_name);
+        close(fd);
+        return NULL;
+    }
+
+    size_t map_size = st.st_size;
+    void *map = mmap(NULL, map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        LOGF(LOG_ERROR, "Failed to map file: '%s'", file_name);
+        return NULL;
+    }
+
+    if (!is_valid_pack(map, map_size, file_name))
+    {
+        munmap(map, map_size);
+        return NULL;
+    }
+
+    struct puzzle_set *pset = calloc(1, sizeof(struct puzzle_set));
+    if (pset == NULL)
+    {
+        LOG(LOG_ERROR, "Memory allocation failed");
+        munmap(map, map_size);
+        return NULL;
+    }
+
+    const struct npk_header *header = map;
+    strncpy(pset->file_name,  file_name,          MAX_PZ_FILE_NAME_LEN);
+    strncpy(pset->format_ver, header->format_ver, JSON_FMT_VER_LEN + 1);
+    strncpy(pset->title,      header->title,      MAX_PZ_TITLE_LEN + 1);
+    strncpy(pset->desc,       header->desc,       MAX_PZ_DESC_LEN + 1);
+
+    if (mode == LOAD_METADATA_ONLY)
+    {
+        // Puzzles are not created, keep num_puzzles for display only
+        pset->num_puzzles = header->n_puzzles;
+        munmap(map, map_size);
+        return pset;
+    }
+
+    pset->map      = map;
+    pset->map_size = map_size;
+
+    const struct npk_entry *index =
+        (const struct npk_entry *)((const char *)map + header->index_offset);
+    for (uint32_t i = 0; i < header->n_puzzles; i++)
+    {
+        struct puzzle *pz = puzzle_create_from_pack(map, &index[i]);
+        if (pz == NULL)
+        {
+            puzzle_set_destroy(pset);
+            return NULL;
+        }
+        pset->puzzles[pset->num_puzzles++] = pz;
+    }
+
+    return pset;
+}
+
+int pack_write(const struct puzzle_set *pset, const char *file_name)
+{
+    assert(pset != NULL);
+    assert(file_name != NULL);
+
+    FILE *fp = fopen(file_name, "wb");
+    if (fp == NULL)
+    {
+        LOGF(LOG_ERROR, "Failed to open file: '%s'", file_name);
+        return -1;
+    }
+
+    struct npk_header header =
+    {
+        .magic        = NPK_MAGIC,
+        .version      = NPK_VERSION,
+        .header_size  = sizeof(struct npk_header),
+        .int_size     = sizeof(int),
+        .n_puzzles    = pset->num_puzzles,
+        .index_offset = sizeof(struct npk_header),
+    };
+    strncpy(header.format_ver, pset->format_ver, JSON_FMT_VER_LEN);
+    strncpy(header.title,      pset->title,      MAX_PZ_TITLE_LEN);
+    strncpy(header.desc,       pset->desc,       MAX_PZ_DESC_LEN);
+
+    // Clue data follows the index
+    struct npk_entry index[MAX_PZ_PER_SET];
+    uint32_t offset = header.index_offset
+                      + pset->num_puzzles * sizeof(struct npk_entry);
+    for (int i = 0; i < pset->num_puzzles; i++)
+    {
+        const struct puzzle *pz = pset->puzzles[i];
+        struct npk_entry *entry = &index[i];
+
+        memset(entry, 0, sizeof(*entry));
+        strncpy(entry->title,  pz->title,  MAX_PZ_TITLE_LEN);
+        strncpy(entry->author, pz->author, MAX_PZ_AUTHOR_LEN);
+        entry->difficulty = pz->difficulty;
+        entry->n_rows     = pz->n_rows;
+        entry->n_cols     = pz->n_cols;
+
+        entry->row_clues_offset = offset;
+        offset += clue_data_size(pz->n_rows, get_row_clueline_size(pz));
+        entry->col_clues_offset = offset;
+        offset += clue_data_size(pz->n_cols, get_col_clueline_size(pz));
+    }
+
+    bool ok = fwrite(&header, sizeof(header), 1, fp) == 1
+              && fwrite(index, sizeof(*index), pset->num_puzzles, fp)
+                 == (size_t)pset->num_puzzles;
+
+    // Clue lines are written one by one, they may not be contiguous
+    for (int i = 0; ok && i < pset->num_puzzles; i++)
+    {
+        const struct puzzle *pz = pset->puzzles[i];
+        for (int r = 0; ok && r < pz->n_rows; r++)
+        {
+            ok = fwrite(pz->row_clues[r], sizeof(int),
+                        get_row_clueline_size(pz), fp)
+                 == (size_t)get_row_clueline_size(pz);
+        }
+        for (int c = 0; ok && c < pz->n_cols; c++)
+        {
+            ok = fwrite(pz->col_clues[c], sizeof(int),
+                        get_col_clueline_size(pz), fp)
+                 == (size_t)get_col_clueline_size(pz);
+        }
+    }
+
+    if (fclose(fp) != 0 || !ok)
+    {
+        LOGF(LOG_ERROR, "Failed to write pack: '%s'", file_name);
+        remove(file_name);
+        return -1;
+    }
+
+    return 0;
+}
+
+char *pack_file_name(const char *json_file_name)
+{
+    assert(json_file_name != NULL);
+
+    const char *ext = strrchr(json_file_name, '.');
+    size_t base_len = (ext != NULL) ? (size_t)(ext - json_file_name)
+                                    : strlen(json_file_name);
+
+    char *name = malloc(base_len + strlen(NPK_EXT) + 1);
+    ALLOC_CHECK_RETURN(name, NULL);
+
+    memcpy(name, json_file_name, base_len);
+    strcpy(name + base_len, NPK_EXT);
+    return name;
+}
+
+/* Private */
+
+bool is_valid_pack(const void *map, size_t map_size, const char *file_name)
+{
+    const struct npk_header *header = map;
+
+    if (header->magic != NPK_MAGIC || header->version != NPK_VERSION)
+    {
+        LOGF(LOG_WARNING, "Not a version %d pack file: '%s'",
+             NPK_VERSION, file_name);
+        return false;
+    }
+
+    if (header->header_size != sizeof(struct npk_header)
+        || header->int_size != sizeof(int))
+    {
+        LOGF(LOG_WARNING, "Pack built for a different platform: '%s'",
+             file_name);
+        return false;
+    }
+
+    if (!is_terminated(header->format_ver, sizeof(header->format_ver))
+        || !is_terminated(header->title, sizeof(header->title))
+        || !is_terminated(header->desc, sizeof(header->desc))
+        || strcmp(header->format_ver, JSON_FMT_VER) != 0)
+    {
+        LOGF(LOG_WARNING, "Invalid pack header: '%s'", file_name);
+        return false;
+    }
+
+    size_t index_end = (size_t)header->index_offset
+                       + (size_t)header->n_puzzles * sizeof(struct npk_entry);
+    if (header->n_puzzles < 1 || header->n_puzzles > MAX_PZ_PER_SET
+        || header->index_offset % _Alignof(struct npk_entry) != 0
+        || index_end > map_size)
+    {
+        LOGF(LOG_WARNING, "Invalid pack index: '%s'", file_name);
+        return false;
+    }
+
+    const struct npk_entry *index =
+        (const struct npk_entry *)((const char *)map + header->index_offset);
+    for (uint32_t i = 0; i < header->n_puzzles; i++)
+    {
+        if (!is_valid_pack_entry(&index[i], map_size))
+        {
+            LOGF(LOG_WARNING, "Invalid puzzle %u in pack: '%s'", i, file_name);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool is_valid_pack_entry(const struct npk_entry *entry, size_t map_size)
+{
+    if (!is_terminated(entry->title, sizeof(entry->title))
+        || !is_terminated(entry->author, sizeof(entry->author)))
+    {
+        return false;
+    }
+
+    if (entry->n_rows < 1 || entry->n_rows > MAX_PZ_N_ROWS
+        || entry->n_cols < 1 || entry->n_cols > MAX_PZ_N_COLS)
+    {
+        return false;
+    }
+
+    struct puzzle size = {.n_rows = entry->n_rows, .n_cols = entry->n_cols};
+    size_t row_end = (size_t)entry->row_clues_offset
+                     + clue_data_size(size.n_rows, get_row_clueline_size(&size));
+    size_t col_end = (size_t)entry->col_clues_offset
+                     + clue_data_size(size.n_cols, get_col_clueline_size(&size));
+
+    return entry->row_clues_offset % _Alignof(int) == 0
+           && entry->col_clues_offset % _Alignof(int) == 0
+           && row_end <= map_size
+           && col_end <= map_size;
+}
+
+struct puzzle *puzzle_create_from_pack(const void *map,
+                                       const struct npk_entry *entry)
+{
+    struct puzzle *pz = malloc(sizeof(struct puzzle));
+    ALLOC_CHECK_RETURN(pz, NULL);
+
+    strncpy(pz->title,  entry->title,  MAX_PZ_TITLE_LEN + 1);
+    strncpy(pz->author, entry->author, MAX_PZ_AUTHOR_LEN + 1);
+    pz->difficulty   = entry->difficulty;
+    pz->n_rows       = entry->n_rows;
+    pz->n_cols       = entry->n_cols;
+    pz->clues_mapped = true;
+
+    pz->row_clues = clue_lines_create(map, entry->row_clues_offset,
+                                      pz->n_rows, get_row_clueline_size(pz));
+    pz->col_clues = clue_lines_create(map, entry->col_clues_offset,
+                                      pz->n_cols, get_col_clueline_size(pz));
+    if (pz->row_clues == NULL || pz->col_clues == NULL)
+    {
+        puzzle_destroy(pz);
+        return NULL;
+    }
+
+    return pz;
+}
+
+int **clue_lines_create(const void *map, uint32_t offset,
+                        int n_lines, int clueline_size)
+{
+    // Only the line pointers are allocated, the clues stay in the mapping
+    int **lines = malloc(n_lines * sizeof(int *));
+    ALLOC_CHECK_RETURN(lines, NULL);
+
+    int *data = (int *)((char *)map + offset);
+    for (int i = 0; i < n_lines; i++)
+    {
+        lines[i] = data + i * clueline_size;
+    }
+
+    return lines;
+}
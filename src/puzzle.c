@@ -1,18 +1,20 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 
+#include "catalog.h"
 #include "config.h"
 #include "loader.h"
+#include "pack.h"
 #include "puzzle.h"
+#include "save.h"
+#include "solver.h"
 #include "tui.h"
 #include "utils.h"
 
-enum load_mode 
-{
-    LOAD_METADATA_ONLY,
-    LOAD_ALL
-};
+// Search budget when checking for a unique solution at load time
+#define VALIDATE_MAX_GUESSES 1000
 
 /* As of ver 0.2.0 */
 
@@ -40,6 +42,7 @@ enum puzzle_json_key
 #define PSET_KEY_START KEY_PSET_FMT_VER
 #define PZ_KEY_START   KEY_PZ_TITLE
 #define PSET_KEY_END   PZ_KEY_START
+#define PSET_META_KEY_END KEY_PSET_PUZZLES
 #define PZ_KEY_END     KEY_N_KEYS
 
 static const struct json_property puzzle_json_props[KEY_N_KEYS] = 
@@ -130,28 +133,113 @@ static const struct json_property puzzle_json_props[KEY_N_KEYS] =
     }
 };
 
-/* Function Prototypes */
+// Longest key of the schema is "format_version"
+#define JSON_KEY_BUF_SIZE 32
 
-bool is_valid_json_puzzle_format(const cJSON *json);
-bool is_valid_puzzle_set_metadata(const cJSON *json);
-bool is_valid_puzzles(const cJSON *puzzles);
+#define MAX_CLUE_LINES    MAX(MAX_PZ_N_ROWS, MAX_PZ_N_COLS)
+#define MAX_CLUELINE_SIZE ((MAX_CLUE_LINES + 1) / 2)
 
-struct puzzle *puzzle_create(const cJSON *json);
+/**
+ * What is needed to report the first schema failure of a puzzle object
+ * after the whole set was read.
+ */
+struct json_puzzle_check
+{
+    bool is_object;
+    struct json_value_info info[KEY_N_KEYS]; // Puzzle keys only
+    bool clues_valid[2];                     // By enum axis
+};
 
-int **clues_create(const cJSON *json, const struct puzzle *pz, enum axis axis);
+/**
+ * Puzzle object as read, clue lines left aligned.
+ */
+struct json_puzzle
+{
+    struct json_puzzle_check check;
+
+    char title[MAX_PZ_TITLE_LEN + 1];
+    char author[MAX_PZ_AUTHOR_LEN + 1];
+    int difficulty;
+    int n_rows;
+    int n_cols;
+
+    bool lines_ok[2]; // Every line is an array of numbers
+    int  n_lines[2];
+    int  line_len[2][MAX_CLUE_LINES];
+    int  clues[2][MAX_CLUE_LINES][MAX_CLUELINE_SIZE];
+};
 
-struct puzzle_set *puzzle_set_create(const char *file_name, enum load_mode mode);
-void load_puzzle_set_metadata(const cJSON *json, struct puzzle_set *pset);
+struct json_puzzle_set
+{
+    struct json_value_info info[KEY_N_KEYS]; // Set keys only
+    char format_ver[JSON_FMT_VER_LEN + 1];
+    char title[MAX_PZ_TITLE_LEN + 1];
+    char desc[MAX_PZ_DESC_LEN + 1];
+    int num_puzzles;
+
+    int n_puzzles_read;
+    struct json_puzzle_check checks[MAX_PZ_PER_SET];
+    struct puzzle *puzzles[MAX_PZ_PER_SET]; // Built if their check passed
+    bool alloc_failed;
+};
+
+/* Function Prototypes */
+
+/**
+ * Single pass parse of a 0.2.0 JSON set, straight into struct puzzle.
+ *  - Values are collected while reading and checked against
+ *    puzzle_json_props once the set is read, in key order, so the first
+ *    failure is the one reported no matter the member order in the file.
+ */
+struct puzzle_set *puzzle_set_create_from_json(const char *file_name,
+                                               enum load_mode mode);
+
+/**
+ * @return false on a syntax error, schema errors are left for
+ *         is_valid_json_puzzle_set()
+ */
+bool parse_json_puzzle_set(struct json_reader *r, struct json_puzzle_set *jset,
+                           struct json_puzzle *jp, enum load_mode mode);
+void parse_json_puzzles(struct json_reader *r, struct json_puzzle_set *jset,
+                        struct json_puzzle *jp);
+void parse_json_puzzle(struct json_reader *r, struct json_puzzle *jp);
+void parse_json_clues(struct json_reader *r, struct json_puzzle *jp,
+                      enum axis axis, struct json_value_info *info);
+
+/**
+ * Read a string or number value, any other value is skipped.
+ */
+void read_json_value(struct json_reader *r, struct json_value_info *info,
+                     char *str, size_t str_size, int *num);
+int  find_json_key(const char *key, int start, int end);
+
+bool is_valid_json_puzzle_set(const struct json_puzzle_set *jset,
+                              enum load_mode mode);
+bool is_valid_json_puzzle(const struct json_puzzle_check *check, bool log);
+
+struct puzzle *puzzle_create_from_json(const struct json_puzzle *jp);
+int **clues_create(const struct json_puzzle *jp, const struct puzzle *pz,
+                   enum axis axis);
 
 struct puzzle_set **create_puzzle_set_arr(int *arr_size_out);
 
-bool fread_puzzle(FILE *fp, struct puzzle *pz);
+/**
+ * @return Pack sibling of a JSON file if it exists and is not older, else a
+ *         copy of json_name
+ */
+char *preferred_puzzle_set_file(const char *json_name);
+int   compare_file_names(const void *a, const void *b);
 
-bool is_valid_puzzle(const struct puzzle *pz)
-{
-    // @TODO: Implement
-    return true;
-}
+/**
+ * Check that clues are in range and the puzzle has exactly one solution.
+ */
+bool is_valid_puzzle(const struct puzzle *pz);
+
+/**
+ * Drop puzzles that fail is_valid_puzzle() from the set.
+ * @return Number of puzzles left
+ */
+int remove_invalid_puzzles(struct puzzle_set *pset);
 
 /* Public */
 
@@ -163,36 +251,23 @@ void puzzle_set_destroy(struct puzzle_set *pset)
         {
             puzzle_destroy(pset->puzzles[i]);
         }
+        if (pset->map != NULL)
+        {
+            munmap(pset->map, pset->map_size);
+        }
     }
     free(pset); pset = NULL;
 }
 
 struct puzzle *puzzle_create_from_save(void)
 {
-    FILE          *fp = NULL;
-    struct puzzle *pz = NULL;
-
-    pz = malloc(sizeof(struct puzzle));
-    ALLOC_CHECK_RETURN(pz, NULL);
-
-    fp = fopen(SAVE_FILE_NAME, "rb");
-    if (fp == NULL)
-    {
-        LOGF(LOG_ERROR, "Failed to open file: '%s'", SAVE_FILE_NAME);
-        free(pz);
-        return NULL;
-    }
-
-    if (!fread_puzzle(fp, pz))
+    struct puzzle *pz = save_load_puzzle(SAVE_FILE_NAME);
+    if (pz == NULL)
     {
         LOG(LOG_ERROR, "Failed to read puzzle from Save File");
-        free(pz);
-        fclose(fp);
         return NULL;
     }
 
-    fclose(fp);
-
     if (!is_valid_puzzle(pz))
     {
         LOG(LOG_ERROR, "Invalid puzzle loaded from Save File");
@@ -203,36 +278,6 @@ struct puzzle *puzzle_create_from_save(void)
     return pz;
 }
 
-bool skip_puzzle_from_file(FILE *fp, const struct puzzle *pz)
-{
-    assert(fp != NULL);
-    assert(pz != NULL);
-
-    int offsets[] = 
-    {
-        sizeof(*(pz->title)) * (MAX_PZ_TITLE_LEN + 1),
-        sizeof(*(pz->author)) * (MAX_PZ_AUTHOR_LEN + 1),
-        sizeof(pz->difficulty),
-        sizeof(pz->n_rows),
-        sizeof(pz->n_cols),
-        sizeof(int) * pz->n_rows * get_row_clueline_size(pz),
-        sizeof(int) * pz->n_cols * get_col_clueline_size(pz)
-    };
-
-    int arr_size = sizeof(offsets) / sizeof(*offsets);
-
-    for (int i = 0; i < arr_size; i++)
-    {
-        if (fseek(fp, offsets[i], SEEK_CUR) != 0)
-        {
-            LOG(LOG_ERROR, "Failed to skip puzzle from file");
-            return false;
-        }
-    }
-
-    return true;
-}
-
 struct puzzle_set *puzzle_set_create_from_user_selection(void)
 {
     int n_puzzle_sets;
@@ -277,6 +322,20 @@ struct puzzle_set *puzzle_set_create_from_user_selection(void)
     selected_pset = puzzle_set_create(puzzle_sets[selected]->file_name, LOAD_ALL);
     free_ptr_array((void **) puzzle_sets, n_puzzle_sets);
 
+    // The catalog only checked the set header
+    if (selected_pset == NULL)
+    {
+        display_notification("Failed to load the puzzle set");
+        return NULL;
+    }
+
+    if (remove_invalid_puzzles(selected_pset) == 0)
+    {
+        LOGF(LOG_WARNING, "No valid puzzle in set: %s", selected_pset->file_name);
+        puzzle_set_destroy(selected_pset);
+        return NULL;
+    }
+
     return selected_pset;
 }
 
@@ -320,7 +379,13 @@ struct puzzle *select_puzzle_from_set(struct puzzle_set *pset)
 
 void puzzle_destroy(struct puzzle *puzzle)
 {
-    if (puzzle != NULL)
+    if (puzzle != NULL && puzzle->clues_mapped)
+    {
+        // Clues live in the set's mapping, only the line pointers are owned
+        free(puzzle->row_clues);
+        free(puzzle->col_clues);
+    }
+    else if (puzzle != NULL)
     {
         free2d((void **) puzzle->row_clues, puzzle->n_rows);
         free2d((void **) puzzle->col_clues, puzzle->n_cols);
@@ -334,272 +399,709 @@ struct puzzle_set **create_puzzle_set_arr(int *arr_size_out)
 {
     assert(arr_size_out != NULL);
 
-    char              **file_names = NULL;
-    struct puzzle_set **pset_arr   = NULL;
-    struct puzzle_set  *pset       = NULL;
+    struct catalog     *catalog  = NULL;
+    struct puzzle_set **pset_arr = NULL;
+    struct puzzle_set  *pset     = NULL;
 
-    int n_json_files;
-    file_names = list_json_files(PUZZLE_DIR, &n_json_files);
-    if (file_names == NULL) return NULL;
+    // Metadata comes from the catalog, only changed files are parsed
+    catalog = catalog_load(PUZZLE_DIR, CATALOG_FILE_NAME, 0);
+    if (catalog == NULL) return NULL;
 
-    pset_arr = malloc(n_json_files * sizeof(struct puzzle_set *));
+    pset_arr = malloc(MAX(catalog->n_entries, 1) * sizeof(struct puzzle_set *));
     if (pset_arr == NULL)
     {
         LOG(LOG_ERROR, "Memory allocation failed");
-        free_ptr_array((void **) file_names, n_json_files);
+        catalog_destroy(catalog);
         return NULL;
     }
 
     // Add valid puzzle sets only
     int n_puzzle_sets = 0;
-    for (int i = 0; i < n_json_files; i++)
+    for (int i = 0; i < catalog->n_entries; i++)
     {
-        pset = puzzle_set_create(file_names[i], LOAD_METADATA_ONLY);
-        if (pset != NULL)
+        if (!catalog->entries[i].valid) continue;
+
+        pset = calloc(1, sizeof(struct puzzle_set));
+        if (pset == NULL)
         {
-            pset_arr[n_puzzle_sets++] = pset;
+            LOG(LOG_ERROR, "Memory allocation failed");
+            break;
         }
+        catalog_entry_get_metadata(&catalog->entries[i], pset);
+        pset_arr[n_puzzle_sets++] = pset;
     }
 
     *arr_size_out = n_puzzle_sets;
-    free_ptr_array((void **) file_names, n_json_files);
+    catalog_destroy(catalog);
     return pset_arr;
 }
 
-int **clues_create(const cJSON *json, const struct puzzle *pz, enum axis axis)
+char **list_puzzle_set_files(const char *dir_name, int *n_files_out)
 {
-    assert(json != NULL);
-    assert(pz != NULL);
+    assert(dir_name != NULL);
+    assert(n_files_out != NULL);
 
-    int axis_size = (axis == AXIS_ROW) ? pz->n_rows : pz->n_cols;
-    int clueline_size = (axis == AXIS_ROW) 
-                         ? get_row_clueline_size(pz) 
-                         : get_col_clueline_size(pz);
+    int n_json, n_pack;
+    char **json_names = list_json_files(dir_name, &n_json);
+    if (json_names == NULL) return NULL;
 
-    int **clues = (int **) calloc2d(axis_size, clueline_size, sizeof(int));
-    ALLOC_CHECK_RETURN(clues, NULL);
+    char **pack_names = list_files_with_ext(dir_name, NPK_EXT, &n_pack);
+    if (pack_names == NULL)
+    {
+        // Packs are optional
+        n_pack = 0;
+    }
 
-    // Right align
-    for (int i = 0; i < axis_size; i++)
+    // Pack names of the JSON files, sorted to look packs up in
+    char **file_names   = malloc(MAX(n_json + n_pack, 1) * sizeof(char *));
+    char **source_packs = calloc(MAX(n_json, 1), sizeof(char *));
+    if (file_names == NULL || source_packs == NULL)
     {
-        cJSON *clues_json = cJSON_GetArrayItem(json, i);
-        int arr_size = cJSON_GetArraySize(clues_json);
-        int start = clueline_size - arr_size;
-        for (int k = 0; k < arr_size; k++)
+        LOG(LOG_ERROR, "Memory allocation failed");
+        free(file_names);
+        free(source_packs);
+        free_ptr_array((void **) json_names, n_json);
+        free_ptr_array((void **) pack_names, n_pack);
+        return NULL;
+    }
+
+    int n_files  = 0;
+    int n_source = 0;
+    for (int i = 0; i < n_json; i++)
+    {
+        char *name = preferred_puzzle_set_file(json_names[i]);
+        if (name != NULL)
         {
-            clues[i][start + k] = cJSON_GetArrayItem(clues_json, k)->valueint;
+            file_names[n_files++] = name;
         }
-    }
 
-    return clues;
-}
+        char *pack_name = pack_file_name(json_names[i]);
+        if (pack_name != NULL)
+        {
+            source_packs[n_source++] = pack_name;
+        }
+    }
+    qsort(source_packs, n_source, sizeof(*source_packs), compare_file_names);
 
-struct puzzle *puzzle_create(const cJSON *json)
-{
-    struct puzzle *pz = malloc(sizeof(struct puzzle));
-    ALLOC_CHECK_RETURN(pz, NULL);
+    // Packs without a JSON source are listed on their own
+    for (int i = 0; i < n_pack; i++)
+    {
+        if (bsearch(&pack_names[i], source_packs, n_source,
+                    sizeof(*source_packs), compare_file_names) == NULL)
+        {
+            file_names[n_files++] = pack_names[i];
+            pack_names[i] = NULL;
+        }
+    }
 
-    cJSON *title      = get_cJSON(json, puzzle_json_props[KEY_PZ_TITLE]);
-    cJSON *author     = get_cJSON(json, puzzle_json_props[KEY_PZ_AUTHOR]);
-    cJSON *difficulty = get_cJSON(json, puzzle_json_props[KEY_PZ_DIFFICULTY]);
-    cJSON *rows       = get_cJSON(json, puzzle_json_props[KEY_PZ_ROWS]);
-    cJSON *cols       = get_cJSON(json, puzzle_json_props[KEY_PZ_COLS]);
-    cJSON *row_clues  = get_cJSON(json, puzzle_json_props[KEY_PZ_ROW_CLUES]);
-    cJSON *col_clues  = get_cJSON(json, puzzle_json_props[KEY_PZ_COL_CLUES]);
+    free_ptr_array((void **) source_packs, n_source);
+    free_ptr_array((void **) json_names, n_json);
+    free_ptr_array((void **) pack_names, n_pack);
 
-    strncpy(pz->title,  title->valuestring,  MAX_PZ_TITLE_LEN + 1);
-    strncpy(pz->author, author->valuestring, MAX_PZ_AUTHOR_LEN + 1);
+    qsort(file_names, n_files, sizeof(*file_names), compare_file_names);
 
-    pz->difficulty = difficulty->valueint;
-    pz->n_rows     = rows->valueint;
-    pz->n_cols     = cols->valueint;
+    *n_files_out = n_files;
+    return file_names;
+}
 
-    pz->row_clues = clues_create(row_clues, pz, AXIS_ROW);
-    if (pz->row_clues == NULL)
-    {
-        free(pz);
-        return NULL;
-    }
+char *preferred_puzzle_set_file(const char *json_name)
+{
+    char *pack_name = pack_file_name(json_name);
+    if (pack_name == NULL) return NULL;
 
-    pz->col_clues = clues_create(col_clues, pz, AXIS_COL);
-    if (pz->col_clues == NULL)
+    struct file_info json_info, pack_info;
+    if (get_file_info(pack_name, &pack_info)
+        && get_file_info(json_name, &json_info)
+        && pack_info.mtime_ns >= json_info.mtime_ns)
     {
-        free2d((void **) pz->row_clues, pz->n_rows);
-        free(pz);
-        return NULL;
+        return pack_name;
     }
 
-    return pz;
+    free(pack_name);
+    return strdup(json_name);
 }
 
-
-void load_puzzle_set_metadata(const cJSON *json, struct puzzle_set *pset)
+int compare_file_names(const void *a, const void *b)
 {
-    assert(json != NULL);
-    assert(pset != NULL);
-    assert(pset->file_name != NULL);
-
-    cJSON *fmt_ver   = get_cJSON(json, puzzle_json_props[KEY_PSET_FMT_VER]);
-    cJSON *title     = get_cJSON(json, puzzle_json_props[KEY_PSET_TITLE]);
-    cJSON *desc      = get_cJSON(json, puzzle_json_props[KEY_PSET_DESC]);
-    cJSON *n_puzzles = get_cJSON(json, puzzle_json_props[KEY_PSET_N_PUZZLES]);
-
-    strncpy(pset->format_ver, fmt_ver->valuestring, JSON_FMT_VER_LEN + 1);
-    strncpy(pset->title,      title->valuestring,   MAX_PZ_TITLE_LEN + 1);
-    strncpy(pset->desc,       desc->valuestring,    MAX_PZ_DESC_LEN + 1);
-    pset->num_puzzles = n_puzzles->valueint;
+    return strcmp(*(const char **)a, *(const char **)b);
 }
 
 struct puzzle_set *puzzle_set_create(const char *file_name, enum load_mode mode)
 {
-    struct puzzle_set *pset = NULL;
-    cJSON             *json = NULL;
+    if (is_pack_file_name(file_name))
+    {
+        return pack_load(file_name, mode);
+    }
+    return puzzle_set_create_from_json(file_name, mode);
+}
+
+struct puzzle_set *puzzle_set_create_from_json(const char *file_name,
+                                               enum load_mode mode)
+{
+    struct json_reader     *r    = NULL;
+    struct json_puzzle_set *jset = NULL;
+    struct json_puzzle     *jp   = NULL;
+    struct puzzle_set      *pset = NULL;
+
+    // Reader buffer and clue scratch are too large for the stack
+    r    = malloc(sizeof(struct json_reader));
+    jset = calloc(1, sizeof(struct json_puzzle_set));
+    jp   = malloc(sizeof(struct json_puzzle));
+    if (r == NULL || jset == NULL || jp == NULL)
+    {
+        LOG(LOG_ERROR, "Memory allocation failed");
+        goto cleanup;
+    }
 
-    int n_puzzles_created = 0;
+    if (!json_reader_open(r, file_name)) goto cleanup;
 
-    json = cJSON_parse_file(file_name);
-    if (json == NULL) return NULL;
+    bool parsed = parse_json_puzzle_set(r, jset, jp, mode);
+    json_reader_close(r);
+    if (!parsed) goto cleanup;
 
-    if (!is_valid_json_puzzle_format(json))
+    if (!is_valid_json_puzzle_set(jset, mode))
     {
         LOGF(LOG_WARNING, "Invalid JSON format in file: %s", file_name);
         goto cleanup;
     }
 
-    pset = malloc(sizeof(struct puzzle_set));
-    ALLOC_CHECK_RETURN(pset, NULL);
+    pset = calloc(1, sizeof(struct puzzle_set));
+    if (pset == NULL)
+    {
+        LOG(LOG_ERROR, "Memory allocation failed");
+        goto cleanup;
+    }
 
-    strncpy(pset->file_name, file_name, MAX_PZ_FILE_NAME_LEN);
-    load_puzzle_set_metadata(json, pset);
+    strncpy(pset->file_name,  file_name,        MAX_PZ_FILE_NAME_LEN);
+    strncpy(pset->format_ver, jset->format_ver, JSON_FMT_VER_LEN + 1);
+    strncpy(pset->title,      jset->title,      MAX_PZ_TITLE_LEN + 1);
+    strncpy(pset->desc,       jset->desc,       MAX_PZ_DESC_LEN + 1);
+    pset->num_puzzles = jset->num_puzzles;
 
-    n_puzzles_created = 0;
     if (mode != LOAD_METADATA_ONLY)
     {
-        struct puzzle *pz;
-        cJSON *puzzles_json;
-        cJSON *pz_json;
-        puzzles_json = get_cJSON(json, puzzle_json_props[KEY_PSET_PUZZLES]);
+        // Valid puzzles were all built while parsing, hand them over
         for (int i = 0; i < pset->num_puzzles; i++)
         {
-            pz_json = cJSON_GetArrayItem(puzzles_json, i);
-            pz = puzzle_create(pz_json);
-            if (pz == NULL)
-            {
-                goto cleanup;
-            }
-            pset->puzzles[i] = pz;
-            n_puzzles_created++;
+            pset->puzzles[i] = jset->puzzles[i];
+            jset->puzzles[i] = NULL;
         }
     }
 
-    cJSON_Delete(json);
+cleanup:
+    if (jset != NULL)
+    {
+        for (int i = 0; i < MAX_PZ_PER_SET; i++)
+        {
+            puzzle_destroy(jset->puzzles[i]);
+        }
+    }
+    free(r);
+    free(jset);
+    free(jp);
     return pset;
+}
 
-cleanup:
-    cJSON_Delete(json);
-    if (pset) puzzle_set_destroy(pset);
-    return NULL;
+bool parse_json_puzzle_set(struct json_reader *r, struct json_puzzle_set *jset,
+                           struct json_puzzle *jp, enum load_mode mode)
+{
+    char key[JSON_KEY_BUF_SIZE];
+    bool seen[KEY_N_KEYS] = {0};
+    int  n_meta_left = PSET_META_KEY_END - PSET_KEY_START;
+
+    // Not an object: every property is reported missing later
+    if (json_peek_type(r) != cJSON_Object)
+    {
+        json_skip_value(r);
+        return !r->error;
+    }
+    json_enter_object(r);
+
+    while (json_next_member(r, key, sizeof(key)))
+    {
+        // First occurrence wins, like cJSON_GetObjectItemCaseSensitive
+        int k = find_json_key(key, PSET_KEY_START, PSET_KEY_END);
+        if (k < 0 || seen[k])
+        {
+            json_skip_value(r);
+            continue;
+        }
+        seen[k] = true;
+
+        struct json_value_info *info = &jset->info[k];
+        switch (k)
+        {
+            case KEY_PSET_FMT_VER:
+                read_json_value(r, info, jset->format_ver,
+                                sizeof(jset->format_ver), NULL);
+                break;
+            case KEY_PSET_TITLE:
+                read_json_value(r, info, jset->title, sizeof(jset->title), NULL);
+                break;
+            case KEY_PSET_DESC:
+                read_json_value(r, info, jset->desc, sizeof(jset->desc), NULL);
+                break;
+            case KEY_PSET_N_PUZZLES:
+                read_json_value(r, info, NULL, 0, &jset->num_puzzles);
+                break;
+            case KEY_PSET_PUZZLES:
+                if (mode == LOAD_METADATA_ONLY)
+                {
+                    json_skip_value(r);
+                }
+                else
+                {
+                    parse_json_puzzles(r, jset, jp);
+                }
+                break;
+        }
+
+        // The puzzles array is never read for metadata only
+        if (k < PSET_META_KEY_END && --n_meta_left == 0
+            && mode == LOAD_METADATA_ONLY)
+        {
+            break;
+        }
+    }
+
+    return !r->error;
 }
 
-bool is_valid_json_puzzle_format(const cJSON *json)
+void parse_json_puzzles(struct json_reader *r, struct json_puzzle_set *jset,
+                        struct json_puzzle *jp)
 {
-    if (is_valid_puzzle_set_metadata(json))
+    struct json_value_info *info = &jset->info[KEY_PSET_PUZZLES];
+
+    if (json_peek_type(r) != cJSON_Array)
+    {
+        info->type = json_peek_type(r);
+        json_skip_value(r);
+        return;
+    }
+    json_enter_array(r);
+
+    int n_read = 0;
+    while (json_next_element(r))
     {
-        cJSON *puzzles = get_cJSON(json, puzzle_json_props[KEY_PSET_PUZZLES]);
-        if (is_valid_puzzles(puzzles))
+        // Past the limit the array size check fails, no need to keep them
+        if (n_read >= MAX_PZ_PER_SET)
         {
-            return true;
+            json_skip_value(r);
+            n_read++;
+            continue;
+        }
+
+        parse_json_puzzle(r, jp);
+        jset->checks[n_read] = jp->check;
+
+        // Build straight away so the clue scratch can be reused
+        if (!r->error && is_valid_json_puzzle(&jp->check, false))
+        {
+            jset->puzzles[n_read] = puzzle_create_from_json(jp);
+            jset->alloc_failed |= jset->puzzles[n_read] == NULL;
+        }
+        n_read++;
+    }
+
+    *info = (struct json_value_info){.type = cJSON_Array, .size = n_read};
+    jset->n_puzzles_read = n_read;
+}
+
+void parse_json_puzzle(struct json_reader *r, struct json_puzzle *jp)
+{
+    memset(&jp->check, 0, sizeof(jp->check));
+    memset(jp->n_lines, 0, sizeof(jp->n_lines));
+    jp->lines_ok[AXIS_ROW] = jp->lines_ok[AXIS_COL] = true;
+
+    if (json_peek_type(r) != cJSON_Object)
+    {
+        json_skip_value(r);
+        return;
+    }
+    json_enter_object(r);
+    jp->check.is_object = true;
+
+    char key[JSON_KEY_BUF_SIZE];
+    bool seen[KEY_N_KEYS] = {0};
+    while (json_next_member(r, key, sizeof(key)))
+    {
+        int k = find_json_key(key, PZ_KEY_START, PZ_KEY_END);
+        if (k < 0 || seen[k])
+        {
+            json_skip_value(r);
+            continue;
+        }
+        seen[k] = true;
+
+        struct json_value_info *info = &jp->check.info[k];
+        switch (k)
+        {
+            case KEY_PZ_TITLE:
+                read_json_value(r, info, jp->title, sizeof(jp->title), NULL);
+                break;
+            case KEY_PZ_AUTHOR:
+                read_json_value(r, info, jp->author, sizeof(jp->author), NULL);
+                break;
+            case KEY_PZ_DIFFICULTY:
+                read_json_value(r, info, NULL, 0, &jp->difficulty);
+                break;
+            case KEY_PZ_ROWS:
+                read_json_value(r, info, NULL, 0, &jp->n_rows);
+                break;
+            case KEY_PZ_COLS:
+                read_json_value(r, info, NULL, 0, &jp->n_cols);
+                break;
+            case KEY_PZ_ROW_CLUES:
+                parse_json_clues(r, jp, AXIS_ROW, info);
+                break;
+            case KEY_PZ_COL_CLUES:
+                parse_json_clues(r, jp, AXIS_COL, info);
+                break;
         }
     }
-    return false; 
+
+    // Line count and length can only be checked once the size is known
+    struct puzzle size = {.n_rows = jp->n_rows, .n_cols = jp->n_cols};
+    for (int axis = AXIS_ROW; axis <= AXIS_COL; axis++)
+    {
+        int n_lines = (axis == AXIS_ROW) ? size.n_rows : size.n_cols;
+        int clueline_size = (axis == AXIS_ROW) ? get_row_clueline_size(&size)
+                                               : get_col_clueline_size(&size);
+
+        bool ok = jp->lines_ok[axis] && jp->n_lines[axis] == n_lines;
+        for (int i = 0; ok && i < jp->n_lines[axis]; i++)
+        {
+            ok = jp->line_len[axis][i] <= clueline_size;
+        }
+        jp->check.clues_valid[axis] = ok;
+    }
 }
 
-bool is_valid_puzzle_set_metadata(const cJSON *json)
+void parse_json_clues(struct json_reader *r, struct json_puzzle *jp,
+                      enum axis axis, struct json_value_info *info)
 {
-    assert(json != NULL);
+    if (json_peek_type(r) != cJSON_Array)
+    {
+        info->type = json_peek_type(r);
+        json_skip_value(r);
+        return;
+    }
+    json_enter_array(r);
 
-    for (int i = PSET_KEY_START; i < PSET_KEY_END; i++)
+    int n_lines = 0;
+    while (json_next_element(r))
     {
-        if (!is_valid_json_property(json, puzzle_json_props[i]))
+        if (n_lines >= MAX_CLUE_LINES || json_peek_type(r) != cJSON_Array)
+        {
+            // Too many lines fails the array size check
+            jp->lines_ok[axis] &= n_lines >= MAX_CLUE_LINES;
+            json_skip_value(r);
+            n_lines++;
+            continue;
+        }
+        json_enter_array(r);
+
+        int *line = jp->clues[axis][n_lines];
+        int len = 0;
+        while (json_next_element(r))
+        {
+            double value;
+            if (json_peek_type(r) != cJSON_Number)
+            {
+                jp->lines_ok[axis] = false;
+                json_skip_value(r);
+            }
+            else if (json_read_number(r, &value) && len < MAX_CLUELINE_SIZE)
+            {
+                line[len] = json_number_to_int(value);
+            }
+            len++;
+        }
+        jp->line_len[axis][n_lines++] = len;
+    }
+
+    *info = (struct json_value_info){.type = cJSON_Array, .size = n_lines};
+    jp->n_lines[axis] = MIN(n_lines, MAX_CLUE_LINES);
+}
+
+void read_json_value(struct json_reader *r, struct json_value_info *info,
+                     char *str, size_t str_size, int *num)
+{
+    info->type = json_peek_type(r);
+    info->size = 0;
+
+    double value;
+    if (info->type == cJSON_String && str != NULL)
+    {
+        info->size = json_read_string(r, str, str_size);
+    }
+    else if (info->type == cJSON_Number && num != NULL
+             && json_read_number(r, &value))
+    {
+        info->size = json_number_to_int(value);
+        *num = info->size;
+    }
+    else
+    {
+        // Wrong type, reported by the property check
+        json_skip_value(r);
+        info->type = (info->type == cJSON_String || info->type == cJSON_Number)
+                     ? cJSON_Invalid : info->type;
+    }
+}
+
+int find_json_key(const char *key, int start, int end)
+{
+    for (int k = start; k < end; k++)
+    {
+        if (strcmp(key, puzzle_json_props[k].name) == 0) return k;
+    }
+    return -1;
+}
+
+struct puzzle *puzzle_create_from_json(const struct json_puzzle *jp)
+{
+    struct puzzle *pz = malloc(sizeof(struct puzzle));
+    ALLOC_CHECK_RETURN(pz, NULL);
+
+    strncpy(pz->title,  jp->title,  MAX_PZ_TITLE_LEN + 1);
+    strncpy(pz->author, jp->author, MAX_PZ_AUTHOR_LEN + 1);
+    pz->difficulty   = jp->difficulty;
+    pz->n_rows       = jp->n_rows;
+    pz->n_cols       = jp->n_cols;
+    pz->clues_mapped = false;
+
+    pz->row_clues = clues_create(jp, pz, AXIS_ROW);
+    if (pz->row_clues == NULL)
+    {
+        free(pz);
+        return NULL;
+    }
+
+    pz->col_clues = clues_create(jp, pz, AXIS_COL);
+    if (pz->col_clues == NULL)
+    {
+        free2d((void **) pz->row_clues, pz->n_rows);
+        free(pz);
+        return NULL;
+    }
+
+    return pz;
+}
+
+int **clues_create(const struct json_puzzle *jp, const struct puzzle *pz,
+                   enum axis axis)
+{
+    int axis_size = (axis == AXIS_ROW) ? pz->n_rows : pz->n_cols;
+    int clueline_size = (axis == AXIS_ROW) 
+                         ? get_row_clueline_size(pz) 
+                         : get_col_clueline_size(pz);
+
+    int **clues = (int **) calloc2d(axis_size, clueline_size, sizeof(int));
+    ALLOC_CHECK_RETURN(clues, NULL);
+
+    // Right align
+    for (int i = 0; i < axis_size; i++)
+    {
+        int len = jp->line_len[axis][i];
+        int start = clueline_size - len;
+        memcpy(&clues[i][start], jp->clues[axis][i], len * sizeof(int));
+    }
+
+    return clues;
+}
+
+bool is_valid_json_puzzle_set(const struct json_puzzle_set *jset,
+                              enum load_mode mode)
+{
+    for (int i = PSET_KEY_START; i < PSET_META_KEY_END; i++)
+    {
+        if (!is_valid_json_value(jset->info[i], puzzle_json_props[i]))
         {
             return false;
         }
     }
 
-    cJSON *fmt_ver = get_cJSON(json, puzzle_json_props[KEY_PSET_FMT_VER]);
-    if (strcmp(fmt_ver->valuestring, JSON_FMT_VER) != 0)
+    if (strcmp(jset->format_ver, JSON_FMT_VER) != 0)
     {
         LOGF(LOG_WARNING, 
              "Invalid JSON format version: Got %s, Expected %s",
-              fmt_ver->valuestring);
+              jset->format_ver, JSON_FMT_VER);
         return false;
     }
-    return true;
-}
 
-bool is_valid_puzzles(const cJSON *puzzles)
-{
-    assert(puzzles != NULL);
+    if (mode == LOAD_METADATA_ONLY)
+    {
+        return true;
+    }
 
-    const cJSON *pz;
-    cJSON_ArrayForEach(pz, puzzles)
+    if (!is_valid_json_value(jset->info[KEY_PSET_PUZZLES],
+                             puzzle_json_props[KEY_PSET_PUZZLES]))
     {
-        if (!cJSON_IsObject(pz))
+        return false;
+    }
+
+    for (int i = 0; i < jset->n_puzzles_read; i++)
+    {
+        if (!is_valid_json_puzzle(&jset->checks[i], true))
         {
-            LOG(LOG_WARNING, "Invalid JSON puzzle object");
+            return false;
         }
+    }
+
+    if (jset->num_puzzles > jset->n_puzzles_read)
+    {
+        LOGF(LOG_WARNING,
+             "JSON attribute 'num_puzzles' is %d, but 'puzzles' has %d",
+             jset->num_puzzles, jset->n_puzzles_read);
+        return false;
+    }
+
+    return !jset->alloc_failed;
+}
+
+bool is_valid_json_puzzle(const struct json_puzzle_check *check, bool log)
+{
+    if (!check->is_object && log)
+    {
+        LOG(LOG_WARNING, "Invalid JSON puzzle object");
+    }
 
-        for (int i = PZ_KEY_START; i < PZ_KEY_END; i++)
+    for (int i = PZ_KEY_START; i < PZ_KEY_END; i++)
+    {
+        bool ok = log ? is_valid_json_value(check->info[i], puzzle_json_props[i])
+                      : is_json_value_in_spec(check->info[i], puzzle_json_props[i]);
+        if (!ok) return false;
+    }
+
+    for (int axis = AXIS_ROW; axis <= AXIS_COL; axis++)
+    {
+        if (!check->clues_valid[axis])
         {
-            if (!is_valid_json_property(pz, puzzle_json_props[i]))
+            if (log)
             {
-                return false;
+                int key = (axis == AXIS_ROW) ? KEY_PZ_ROW_CLUES
+                                             : KEY_PZ_COL_CLUES;
+                LOGF(LOG_WARNING, "Invalid clue lines in JSON attribute '%s'",
+                     puzzle_json_props[key].name);
             }
+            return false;
         }
     }
 
     return true;
 }
 
-bool fread_puzzle(FILE *fp, struct puzzle *pz)
+bool is_valid_puzzle(const struct puzzle *pz)
 {
-    if (!fread(pz->title, sizeof(char), MAX_PZ_TITLE_LEN + 1, fp)
-        || !fread(pz->author, sizeof(char), MAX_PZ_AUTHOR_LEN + 1, fp)
-        || !fread(&pz->difficulty, sizeof(int), 1, fp)
-        || !fread(&pz->n_rows, sizeof(int), 1, fp)
-        || !fread(&pz->n_cols, sizeof(int), 1, fp))
+    assert(pz != NULL);
+
+    if (!is_valid_clues(pz))
     {
         return false;
     }
-    pz->title[MAX_PZ_TITLE_LEN]   = '\0';
-    pz->author[MAX_PZ_AUTHOR_LEN] = '\0';
 
-    if (pz->n_rows > MAX_PZ_N_ROWS || pz->n_cols > MAX_PZ_N_COLS
-        || pz->n_cols < 0 || pz->n_rows < 0)
+    struct solver *solver = solver_create(pz);
+    if (solver == NULL)
     {
         return false;
     }
 
-    pz->row_clues = (int **)alloc2d(pz->n_rows, 
-                                    get_row_clueline_size(pz), sizeof(int));
+    solver->max_guesses = VALIDATE_MAX_GUESSES;
+    int  n_solutions = solver_count_solutions(solver, 2, NULL);
+    bool gave_up     = solver->gave_up;
+    solver_destroy(solver);
 
-    ALLOC_CHECK_RETURN(pz->row_clues, false);
-    pz->col_clues = (int **)alloc2d(pz->n_cols, 
-                                    get_col_clueline_size(pz), sizeof(int));
-    if (pz->col_clues == NULL)
+    if (gave_up)
     {
-        free2d((void **) pz->row_clues, pz->n_rows);
-        return false;
+        // Too expensive to prove either way, keep it playable
+        LOGF(LOG_WARNING, "Puzzle uniqueness not verified: '%s'", pz->title);
+        return true;
     }
 
-    int row_clues_size = pz->n_rows * get_row_clueline_size(pz);
-    int col_clues_size = pz->n_cols * get_col_clueline_size(pz);
-    if (!fread(pz->row_clues[0], sizeof(int), row_clues_size, fp)
-        || !fread(pz->col_clues[0], sizeof(int), col_clues_size, fp))
+    switch (n_solutions)
     {
+        case 1:
+            return true;
+        case 0:
+            LOGF(LOG_WARNING, "Puzzle has no solution: '%s'", pz->title);
+            break;
+        case 2:
+            LOGF(LOG_WARNING, "Puzzle has multiple solutions: '%s'", pz->title);
+            break;
+        default:
+            LOGF(LOG_ERROR, "Failed to solve puzzle: '%s'", pz->title);
+            break;
+    }
+    return false;
+}
+
+bool is_valid_clues(const struct puzzle *pz)
+{
+    long total[2] = {0, 0}; // Filled cells by row clues, by column clues
+
+    for (enum axis axis = AXIS_ROW; axis <= AXIS_COL; axis++)
+    {
+        int **clues       = (axis == AXIS_ROW) ? pz->row_clues : pz->col_clues;
+        int n_lines       = (axis == AXIS_ROW) ? pz->n_rows : pz->n_cols;
+        int line_len      = (axis == AXIS_ROW) ? pz->n_cols : pz->n_rows;
+        int clueline_size = (axis == AXIS_ROW) ? get_row_clueline_size(pz)
+                                               : get_col_clueline_size(pz);
+
+        for (int i = 0; i < n_lines; i++)
+        {
+            // Blocks plus one cell gap between each
+            int min_len = -1;
+            for (int j = 0; j < clueline_size; j++)
+            {
+                int clue = clues[i][j];
+                if (clue < 0 || clue > line_len)
+                {
+                    LOGF(LOG_WARNING, "Invalid clue %d in puzzle '%s'", 
+                         clue, pz->title);
+                    return false;
+                }
+                if (clue > 0)
+                {
+                    min_len += clue + 1;
+                    total[axis] += clue;
+                }
+            }
+
+            if (min_len > line_len)
+            {
+                LOGF(LOG_WARNING, "Clues do not fit in line %d of puzzle '%s'",
+                     i, pz->title);
+                return false;
+            }
+        }
+    }
+
+    if (total[AXIS_ROW] != total[AXIS_COL])
+    {
+        LOGF(LOG_WARNING, "Row and column clue totals differ in puzzle '%s'",
+             pz->title);
         return false;
     }
 
     return true;
 }
 
+int remove_invalid_puzzles(struct puzzle_set *pset)
+{
+    int n_valid = 0;
+    for (int i = 0; i < pset->num_puzzles; i++)
+    {
+        if (is_valid_puzzle(pset->puzzles[i]))
+        {
+            pset->puzzles[n_valid++] = pset->puzzles[i];
+        }
+        else
+        {
+            puzzle_destroy(pset->puzzles[i]);
+        }
+    }
+
+    pset->num_puzzles = n_valid;
+    return n_valid;
+}
@@ -0,0 +1,517 @@
+#include "save.h"
+#include "utils.h"
+#include <string.h>
+
+#define SAVE_HEADER_SIZE (2 * sizeof(uint32_t))
+#define SAVE_CRC_SIZE    sizeof(uint32_t)
+
+struct save_reader
+{
+    const uint8_t *data;
+    size_t size; // Bytes that can be read, CRC excluded
+    size_t pos;
+    int version;
+    bool ok; // False once a read went past the end
+};
+
+/* Function prototypes */
+
+/**
+ * @return Contents of the file, NULL if it could not be read
+ */
+uint8_t *save_read_file(const char *file_name, size_t *size_out);
+
+/**
+ * Find the version of a save and check the header and CRC of version 2.
+ * @return True if the save can be read from the reader
+ */
+bool save_reader_init(struct save_reader *rd, const uint8_t *data, size_t size);
+
+/**
+ * Read the puzzle part of a save, the clues are allocated.
+ */
+bool save_read_puzzle(struct save_reader *rd, struct puzzle *pz);
+bool save_read_cells(struct save_reader *rd, int n_cells, uint8_t *cells);
+
+/**
+ * Read a version 2 clue line into a right aligned, 0 padded line.
+ */
+bool save_read_clue_line(struct save_reader *rd, int *line, int line_size);
+
+/**
+ * @return Bytes of a version 2 save of the puzzle
+ */
+size_t save_size(const struct puzzle *pz);
+uint8_t *save_put_clue_line(uint8_t *pos, const int *line, int line_size);
+
+/**
+ * CRC-32 with the IEEE polynomial, as used by zlib and PNG.
+ */
+uint32_t save_crc32(const uint8_t *data, size_t size);
+
+static inline uint8_t *save_put_u32(uint8_t *pos, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        *pos++ = value >> (8 * i);
+    }
+    return pos;
+}
+
+static inline uint32_t save_get_u32_at(const uint8_t *pos)
+{
+    return (uint32_t)pos[0] | (uint32_t)pos[1] << 8
+           | (uint32_t)pos[2] << 16 | (uint32_t)pos[3] << 24;
+}
+
+/**
+ * @return Next `n` bytes of the reader, NULL past the end
+ */
+static inline const uint8_t *save_take(struct save_reader *rd, size_t n)
+{
+    if (!rd->ok || rd->size - rd->pos < n)
+    {
+        rd->ok = false;
+        return NULL;
+    }
+    rd->pos += n;
+    return rd->data + rd->pos - n;
+}
+
+static inline uint8_t save_get_u8(struct save_reader *rd)
+{
+    const uint8_t *pos = save_take(rd, 1);
+    return pos != NULL ? *pos : 0;
+}
+
+static inline uint32_t save_get_u32(struct save_reader *rd)
+{
+    const uint8_t *pos = save_take(rd, 4);
+    return pos != NULL ? save_get_u32_at(pos) : 0;
+}
+
+/**
+ * Native int of a version 1 save.
+ */
+static inline int save_get_int(struct save_reader *rd)
+{
+    int value = 0;
+    const uint8_t *pos = save_take(rd, sizeof(int));
+    if (pos != NULL)
+    {
+        memcpy(&value, pos, sizeof(int));
+    }
+    return value;
+}
+
+/* Public */
+
+int save_write(const char *file_name, const struct puzzle *pz,
+               const uint8_t *cells)
+{
+    assert(file_name != NULL);
+    assert(pz != NULL);
+    assert(cells != NULL);
+    assert(pz->n_rows <= UINT8_MAX && pz->n_cols <= UINT8_MAX);
+
+    size_t size = save_size(pz);
+    uint8_t *data = malloc(size);
+    ALLOC_CHECK_RETURN(data, -1);
+
+    uint8_t *pos = data;
+    pos = save_put_u32(pos, SAVE_MAGIC);
+    pos = save_put_u32(pos, SAVE_VERSION);
+
+    size_t title_len  = strlen(pz->title);
+    size_t author_len = strlen(pz->author);
+    *pos++ = title_len;
+    memcpy(pos, pz->title, title_len);
+    pos += title_len;
+    *pos++ = author_len;
+    memcpy(pos, pz->author, author_len);
+    pos += author_len;
+
+    pos = save_put_u32(pos, (uint32_t)pz->difficulty);
+    *pos++ = pz->n_rows;
+    *pos++ = pz->n_cols;
+
+    for (int r = 0; r < pz->n_rows; r++)
+    {
+        pos = save_put_clue_line(pos, pz->row_clues[r], get_row_clueline_size(pz));
+    }
+    for (int c = 0; c < pz->n_cols; c++)
+    {
+        pos = save_put_clue_line(pos, pz->col_clues[c], get_col_clueline_size(pz));
+    }
+
+    // Cells, low bits first
+    int      n_cells = pz->n_rows * pz->n_cols;
+    uint32_t bits    = 0;
+    int      n_bits  = 0;
+    for (int i = 0; i < n_cells; i++)
+    {
+        assert(cells[i] < 1 << SAVE_CELL_BITS);
+        bits   |= (uint32_t)cells[i] << n_bits;
+        n_bits += SAVE_CELL_BITS;
+        for (; n_bits >= 8; n_bits -= 8, bits >>= 8)
+        {
+            *pos++ = bits;
+        }
+    }
+    if (n_bits > 0)
+    {
+        *pos++ = bits;
+    }
+
+    pos = save_put_u32(pos, save_crc32(data, pos - data));
+    assert((size_t)(pos - data) == size);
+
+    FILE *fp = fopen(file_name, "wb");
+    if (fp == NULL)
+    {
+        LOGF(LOG_WARNING, "Failed to open file: '%s'", file_name);
+        free(data);
+        return -1;
+    }
+
+    bool ok = fwrite(data, 1, size, fp) == size;
+    free(data);
+    if (fclose(fp) != 0 || !ok)
+    {
+        LOGF(LOG_ERROR, "Failed to write save: '%s'", file_name);
+        remove(file_name);
+        return -1;
+    }
+
+    return 0;
+}
+
+struct puzzle *save_load_puzzle(const char *file_name)
+{
+    assert(file_name != NULL);
+
+    size_t size;
+    uint8_t *data = save_read_file(file_name, &size);
+    if (data == NULL)
+    {
+        return NULL;
+    }
+
+    struct puzzle *pz = calloc(1, sizeof(struct puzzle));
+    if (pz == NULL)
+    {
+        LOG(LOG_ERROR, "Memory allocation failed");
+        free(data);
+        return NULL;
+    }
+
+    struct save_reader rd;
+    if (!save_reader_init(&rd, data, size) || !save_read_puzzle(&rd, pz))
+    {
+        LOGF(LOG_WARNING, "Invalid save: '%s'", file_name);
+        puzzle_destroy(pz);
+        pz = NULL;
+    }
+
+    free(data);
+    return pz;
+}
+
+int save_load_cells(const char *file_name, const struct puzzle *pz,
+                    uint8_t *cells)
+{
+    assert(file_name != NULL);
+    assert(pz != NULL);
+    assert(cells != NULL);
+
+    size_t size;
+    uint8_t *data = save_read_file(file_name, &size);
+    if (data == NULL)
+    {
+        return -1;
+    }
+
+    // The puzzle is read again to find the cells, its size must match
+    struct puzzle saved = {.clues_mapped = false};
+    struct save_reader rd;
+    bool ok = save_reader_init(&rd, data, size) && save_read_puzzle(&rd, &saved);
+    free2d((void **)saved.row_clues, saved.n_rows);
+    free2d((void **)saved.col_clues, saved.n_cols);
+
+    ok = ok && saved.n_rows == pz->n_rows && saved.n_cols == pz->n_cols
+         && save_read_cells(&rd, pz->n_rows * pz->n_cols, cells);
+    free(data);
+
+    if (!ok)
+    {
+        LOGF(LOG_WARNING, "Failed to read board state from save: '%s'", file_name);
+        return -1;
+    }
+    return 0;
+}
+
+/* Private */
+
+uint8_t *save_read_file(const char *file_name, size_t *size_out)
+{
+    FILE *fp = fopen(file_name, "rb");
+    if (fp == NULL)
+    {
+        LOGF(LOG_WARNING, "Failed to open file: '%s'", file_name);
+        return NULL;
+    }
+
+    long size = -1;
+    if (fseek(fp, 0, SEEK_END) == 0)
+    {
+        size = ftell(fp);
+        rewind(fp);
+    }
+
+    uint8_t *data = size >= 0 ? malloc(size + 1) : NULL;
+    if (data == NULL || fread(data, 1, size, fp) != (size_t)size)
+    {
+        LOGF(LOG_WARNING, "Failed to read file: '%s'", file_name);
+        free(data);
+        data = NULL;
+    }
+
+    fclose(fp);
+    *size_out = size;
+    return data;
+}
+
+bool save_reader_init(struct save_reader *rd, const uint8_t *data, size_t size)
+{
+    *rd = (struct save_reader){.data = data, .size = size, .version = 1, .ok = true};
+
+    // Version 1 starts with the title, never with the magic
+    if (size < SAVE_HEADER_SIZE + SAVE_CRC_SIZE
+        || save_get_u32_at(data) != SAVE_MAGIC)
+    {
+        return true;
+    }
+
+    rd->version = save_get_u32_at(data + sizeof(uint32_t));
+    if (rd->version != SAVE_VERSION)
+    {
+        LOGF(LOG_WARNING, "Unknown save version: %d", rd->version);
+        return false;
+    }
+
+    rd->size = size - SAVE_CRC_SIZE;
+    if (save_crc32(data, rd->size) != save_get_u32_at(data + rd->size))
+    {
+        LOG(LOG_WARNING, "Save checksum mismatch");
+        return false;
+    }
+
+    rd->pos = SAVE_HEADER_SIZE;
+    return true;
+}
+
+bool save_read_puzzle(struct save_reader *rd, struct puzzle *pz)
+{
+    pz->clues_mapped = false;
+    pz->row_clues    = NULL;
+    pz->col_clues    = NULL;
+
+    if (rd->version == 1)
+    {
+        const uint8_t *title  = save_take(rd, MAX_PZ_TITLE_LEN + 1);
+        const uint8_t *author = save_take(rd, MAX_PZ_AUTHOR_LEN + 1);
+        pz->difficulty = save_get_int(rd);
+        pz->n_rows     = save_get_int(rd);
+        pz->n_cols     = save_get_int(rd);
+        if (!rd->ok)
+        {
+            return false;
+        }
+        memcpy(pz->title, title, MAX_PZ_TITLE_LEN);
+        memcpy(pz->author, author, MAX_PZ_AUTHOR_LEN);
+        pz->title[MAX_PZ_TITLE_LEN]   = '\0';
+        pz->author[MAX_PZ_AUTHOR_LEN] = '\0';
+    }
+    else
+    {
+        size_t title_len = save_get_u8(rd);
+        const uint8_t *title = save_take(rd, title_len);
+        size_t author_len = save_get_u8(rd);
+        const uint8_t *author = save_take(rd, author_len);
+        pz->difficulty = (int32_t)save_get_u32(rd);
+        pz->n_rows     = save_get_u8(rd);
+        pz->n_cols     = save_get_u8(rd);
+        if (!rd->ok || title_len > MAX_PZ_TITLE_LEN
+            || author_len > MAX_PZ_AUTHOR_LEN)
+        {
+            return false;
+        }
+        memcpy(pz->title, title, title_len);
+        memcpy(pz->author, author, author_len);
+        pz->title[title_len]   = '\0';
+        pz->author[author_len] = '\0';
+    }
+
+    if (pz->n_rows < 1 || pz->n_rows > MAX_PZ_N_ROWS
+        || pz->n_cols < 1 || pz->n_cols > MAX_PZ_N_COLS)
+    {
+        pz->n_rows = pz->n_cols = 0;
+        return false;
+    }
+
+    pz->row_clues = (int **)alloc2d(pz->n_rows,
+                                    get_row_clueline_size(pz), sizeof(int));
+    pz->col_clues = (int **)alloc2d(pz->n_cols,
+                                    get_col_clueline_size(pz), sizeof(int));
+    if (pz->row_clues == NULL || pz->col_clues == NULL)
+    {
+        LOG(LOG_ERROR, "Memory allocation failed");
+        return false;
+    }
+
+    if (rd->version == 1)
+    {
+        size_t row_clues_size = sizeof(int) * pz->n_rows * get_row_clueline_size(pz);
+        size_t col_clues_size = sizeof(int) * pz->n_cols * get_col_clueline_size(pz);
+        const uint8_t *row_clues = save_take(rd, row_clues_size);
+        const uint8_t *col_clues = save_take(rd, col_clues_size);
+        if (!rd->ok)
+        {
+            return false;
+        }
+        memcpy(pz->row_clues[0], row_clues, row_clues_size);
+        memcpy(pz->col_clues[0], col_clues, col_clues_size);
+        return true;
+    }
+
+    bool ok = true;
+    for (int r = 0; ok && r < pz->n_rows; r++)
+    {
+        ok = save_read_clue_line(rd, pz->row_clues[r], get_row_clueline_size(pz));
+    }
+    for (int c = 0; ok && c < pz->n_cols; c++)
+    {
+        ok = save_read_clue_line(rd, pz->col_clues[c], get_col_clueline_size(pz));
+    }
+    return ok;
+}
+
+bool save_read_cells(struct save_reader *rd, int n_cells, uint8_t *cells)
+{
+    if (rd->version == 1)
+    {
+        // One enum cell_state each, out of range values are kept invalid
+        for (int i = 0; i < n_cells; i++)
+        {
+            int state = save_get_int(rd);
+            cells[i] = (state >= 0 && state <= UINT8_MAX) ? state : UINT8_MAX;
+        }
+        return rd->ok;
+    }
+
+    const uint8_t *pos = save_take(rd, ((size_t)n_cells * SAVE_CELL_BITS + 7) / 8);
+    if (pos == NULL || rd->pos != rd->size)
+    {
+        return false;
+    }
+
+    uint32_t bits   = 0;
+    int      n_bits = 0;
+    for (int i = 0; i < n_cells; i++)
+    {
+        if (n_bits < SAVE_CELL_BITS)
+        {
+            bits   |= (uint32_t)*pos++ << n_bits;
+            n_bits += 8;
+        }
+        cells[i] = bits & ((1U << SAVE_CELL_BITS) - 1);
+        bits   >>= SAVE_CELL_BITS;
+        n_bits  -= SAVE_CELL_BITS;
+    }
+    return true;
+}
+
+bool save_read_clue_line(struct save_reader *rd, int *line, int line_size)
+{
+    int n_clues = save_get_u8(rd);
+    const uint8_t *clues = save_take(rd, n_clues);
+    if (clues == NULL || n_clues > line_size)
+    {
+        return false;
+    }
+
+    int pad = line_size - n_clues;
+    for (int i = 0; i < pad; i++)
+    {
+        line[i] = 0;
+    }
+    for (int i = 0; i < n_clues; i++)
+    {
+        line[pad + i] = clues[i];
+    }
+    return true;
+}
+
+size_t save_size(const struct puzzle *pz)
+{
+    size_t size = SAVE_HEADER_SIZE
+                  + 1 + strlen(pz->title) + 1 + strlen(pz->author)
+                  + sizeof(uint32_t) + 2
+                  + pz->n_rows + pz->n_cols
+                  + ((size_t)pz->n_rows * pz->n_cols * SAVE_CELL_BITS + 7) / 8
+                  + SAVE_CRC_SIZE;
+
+    // Clues without their padding
+    for (int r = 0; r < pz->n_rows; r++)
+    {
+        for (int i = 0; i < get_row_clueline_size(pz); i++)
+        {
+            size += pz->row_clues[r][i] != 0;
+        }
+    }
+    for (int c = 0; c < pz->n_cols; c++)
+    {
+        for (int i = 0; i < get_col_clueline_size(pz); i++)
+        {
+            size += pz->col_clues[c][i] != 0;
+        }
+    }
+    return size;
+}
+
+uint8_t *save_put_clue_line(uint8_t *pos, const int *line, int line_size)
+{
+    uint8_t *count = pos++;
+    *count = 0;
+    for (int i = 0; i < line_size; i++)
+    {
+        if (line[i] != 0)
+        {
+            assert(line[i] <= UINT8_MAX);
+            *pos++ = line[i];
+            (*count)++;
+        }
+    }
+    return pos;
+}
+
+uint32_t save_crc32(const uint8_t *data, size_t size)
+{
+    // A nibble at a time, saves are small
+    static const uint32_t table[16] =
+    {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+        0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+        0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+    };
+
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < size; i++)
+    {
+        crc ^= data[i];
+        crc  = (crc >> 4) ^ table[crc & 0xF];
+        crc  = (crc >> 4) ^ table[crc & 0xF];
+    }
+    return ~crc;
+}
@@ -0,0 +1,626 @@
+#include "solver.h"
+#include "utils.h"
+#include <string.h>
+
+// Can blocks [i, n) be placed in cells [p, len)
+#define FIT(table, i, p) (table)[(i) * (len + 1) + (p)]
+
+enum line_cell
+{
+    LINE_UNKNOWN,
+    LINE_FILLED,
+    LINE_EMPTY
+};
+
+/* Function prototypes */
+
+void solver_enqueue(struct solver *s, int line_id);
+int  solver_dequeue(struct solver *s);
+void solver_enqueue_all(struct solver *s);
+
+static inline enum axis line_id_axis(const struct solver *s, int line_id)
+{
+    return (line_id < s->puzzle->n_rows) ? AXIS_ROW : AXIS_COL;
+}
+
+static inline int line_id_idx(const struct solver *s, int line_id)
+{
+    return (line_id < s->puzzle->n_rows) ? line_id
+                                         : line_id - s->puzzle->n_rows;
+}
+
+/**
+ * Run the line solver on a single line and write back new cells.
+ * @retval false if the line can not be completed
+ */
+bool solver_solve_line(struct solver *s, int line_id);
+
+/**
+ * Find the left-most placement of the clue blocks over the line.
+ * @param starts Output, start cell of each block
+ * @retval false if there is no valid placement
+ */
+bool line_leftmost(struct solver *s, const unsigned char *cells, int len,
+                   const int *clues, int n_clues, unsigned char *fit, 
+                   int *starts);
+
+/**
+ * Exact line solve, fix every cell that is the same in all placements.
+ *  - Uses the tables of the last line_leftmost() calls on the line.
+ * @param fill, empty Output, cells that must be filled/empty
+ */
+void line_settle(struct solver *s, int len, const int *clues, int n_clues,
+                 uint64_t *fill, uint64_t *empty);
+
+/**
+ * @return Number of solutions below this node, -1 if allocation failed
+ */
+int solver_search(struct solver *s, int depth, int limit, int n_found,
+                  struct bitboard *solution);
+
+/**
+ * @return Unknown cell with the fewest unknown cells on its row and column
+ */
+struct cell solver_pick_branch_cell(const struct solver *s);
+
+/**
+ * Fix an unknown cell and queue its row and column.
+ */
+void solver_assume(struct solver *s, struct cell cell, enum bb_plane plane);
+
+/* Public */
+
+struct solver *solver_create(const struct puzzle *pz)
+{
+    assert(pz != NULL);
+
+    struct solver *s = calloc(1, sizeof(struct solver));
+    ALLOC_CHECK_RETURN(s, NULL);
+
+    s->puzzle = pz;
+
+    int n_lines   = pz->n_rows + pz->n_cols;
+    int max_len   = MAX(pz->n_rows, pz->n_cols);
+    int max_clues = (max_len + 1) / 2;
+    int n_clues_total = pz->n_rows * get_row_clueline_size(pz)
+                        + pz->n_cols * get_col_clueline_size(pz);
+
+    s->grid       = bitboard_create(pz->n_rows, pz->n_cols);
+    s->clues      = malloc(n_clues_total * sizeof(int));
+    s->clue_start = malloc(n_lines * sizeof(int));
+    s->n_clues    = malloc(n_lines * sizeof(int));
+    s->queue      = malloc(n_lines * sizeof(int));
+    s->queued     = calloc(BB_N_WORDS(n_lines), sizeof(uint64_t));
+    s->cells      = malloc(max_len);
+    s->rev_cells  = malloc(max_len);
+    s->rev_clues  = malloc(max_clues * sizeof(int));
+    s->run        = malloc((max_len + 1) * sizeof(int));
+    s->left       = malloc(max_clues * sizeof(int));
+    s->right      = malloc(max_clues * sizeof(int));
+    s->fit        = malloc((max_clues + 1) * (max_len + 1));
+    s->rev_fit    = malloc((max_clues + 1) * (max_len + 1));
+    s->can_fill   = malloc((max_len + 1) * sizeof(int));
+
+    if (s->grid == NULL || s->clues == NULL || s->clue_start == NULL
+        || s->n_clues == NULL || s->queue == NULL || s->queued == NULL
+        || s->cells == NULL || s->rev_cells == NULL || s->rev_clues == NULL
+        || s->run == NULL || s->left == NULL || s->right == NULL
+        || s->fit == NULL || s->rev_fit == NULL || s->can_fill == NULL)
+    {
+        LOG(LOG_ERROR, "Memory allocation failed");
+        solver_destroy(s);
+        return NULL;
+    }
+
+    // Strip the 0 padding of the right aligned clue lines
+    int offset = 0;
+    for (int id = 0; id < n_lines; id++)
+    {
+        bool is_row       = id < pz->n_rows;
+        int *clueline     = is_row ? pz->row_clues[id]
+                                   : pz->col_clues[id - pz->n_rows];
+        int clueline_size = is_row ? get_row_clueline_size(pz)
+                                   : get_col_clueline_size(pz);
+
+        s->clue_start[id] = offset;
+        for (int i = 0; i < clueline_size; i++)
+        {
+            if (clueline[i] != 0)
+            {
+                s->clues[offset++] = clueline[i];
+            }
+        }
+        s->n_clues[id] = offset - s->clue_start[id];
+    }
+
+    solver_reset(s);
+    return s;
+}
+
+void solver_destroy(struct solver *s)
+{
+    if (s != NULL)
+    {
+        bitboard_destroy(s->grid);
+        free(s->clues);
+        free(s->clue_start);
+        free(s->n_clues);
+        free(s->queue);
+        free(s->queued);
+        free(s->cells);
+        free(s->rev_cells);
+        free(s->rev_clues);
+        free(s->run);
+        free(s->left);
+        free(s->right);
+        free(s->fit);
+        free(s->rev_fit);
+        free(s->can_fill);
+        for (int i = 0; i < s->stack_size; i++)
+        {
+            bitboard_destroy(s->stack[i]);
+        }
+        free(s->stack);
+    }
+    free(s); s = NULL;
+}
+
+void solver_reset(struct solver *s)
+{
+    assert(s != NULL);
+
+    bitboard_clear(s->grid);
+    s->n_known = 0;
+    s->stats   = (struct solver_stats){0};
+    solver_enqueue_all(s);
+}
+
+enum solve_status solver_propagate(struct solver *s)
+{
+    assert(s != NULL);
+
+    int line_id;
+    while ((line_id = solver_dequeue(s)) >= 0)
+    {
+        if (!solver_solve_line(s, line_id))
+        {
+            // Leave the queue empty for the next run
+            while (solver_dequeue(s) >= 0);
+            return SOLVE_CONTRADICTION;
+        }
+    }
+
+    return solver_is_solved(s) ? SOLVE_SOLVED : SOLVE_STALLED;
+}
+
+int solver_count_solutions(struct solver *s, int limit, struct bitboard *solution)
+{
+    assert(s != NULL);
+    assert(limit > 0);
+
+    s->gave_up = false;
+    return solver_search(s, 0, limit, 0, solution);
+}
+
+/* Private */
+
+int solver_search(struct solver *s, int depth, int limit, int n_found,
+                  struct bitboard *solution)
+{
+    s->stats.max_depth = MAX(s->stats.max_depth, depth);
+
+    switch (solver_propagate(s))
+    {
+        case SOLVE_CONTRADICTION:
+            return 0;
+        case SOLVE_SOLVED:
+            if (n_found == 0 && solution != NULL)
+            {
+                bitboard_copy(solution, s->grid);
+            }
+            return 1;
+        case SOLVE_STALLED:
+            break;
+    }
+
+    if (depth >= s->stack_size)
+    {
+        struct bitboard **stack = realloc(s->stack, 
+                                          (depth + 1) * sizeof(*stack));
+        ALLOC_CHECK_RETURN(stack, -1);
+        s->stack = stack;
+
+        s->stack[depth] = bitboard_create(s->puzzle->n_rows, s->puzzle->n_cols);
+        ALLOC_CHECK_RETURN(s->stack[depth], -1);
+        s->stack_size = depth + 1;
+    }
+
+    struct cell cell = solver_pick_branch_cell(s);
+    bitboard_copy(s->stack[depth], s->grid);
+    int n_known = s->n_known;
+
+    int n_solutions = 0;
+    for (enum bb_plane guess = BB_PLANE_FILL; guess <= BB_PLANE_XMARK; guess++)
+    {
+        if (guess != BB_PLANE_FILL)
+        {
+            bitboard_copy(s->grid, s->stack[depth]);
+            s->n_known = n_known;
+        }
+
+        if (s->max_guesses > 0 && s->stats.n_guesses >= s->max_guesses)
+        {
+            s->gave_up = true;
+            return -1;
+        }
+
+        s->stats.n_guesses++;
+        solver_assume(s, cell, guess);
+
+        int n = solver_search(s, depth + 1, limit, n_found + n_solutions,
+                              solution);
+        if (n < 0) return -1;
+
+        n_solutions += n;
+        if (n_found + n_solutions >= limit)
+        {
+            break;
+        }
+    }
+
+    return n_solutions;
+}
+
+struct cell solver_pick_branch_cell(const struct solver *s)
+{
+    const struct bitboard *grid = s->grid;
+
+    int row_unknown[MAX_PZ_N_ROWS];
+    int col_unknown[MAX_PZ_N_COLS];
+    for (enum axis axis = AXIS_ROW; axis <= AXIS_COL; axis++)
+    {
+        int n_lines  = (axis == AXIS_ROW) ? grid->n_rows : grid->n_cols;
+        int len      = bitboard_line_len(grid, axis);
+        int *unknown = (axis == AXIS_ROW) ? row_unknown : col_unknown;
+        for (int i = 0; i < n_lines; i++)
+        {
+            const uint64_t *fill  = bitboard_line(grid, BB_PLANE_FILL, axis, i);
+            const uint64_t *xmark = bitboard_line(grid, BB_PLANE_XMARK, axis, i);
+            unknown[i] = 0;
+            for (int w = 0; w < bitboard_line_words(grid, axis); w++)
+            {
+                uint64_t known = fill[w] | xmark[w];
+                unknown[i] += __builtin_popcountll(~known 
+                                                   & bitline_word_mask(len, w));
+            }
+        }
+    }
+
+    struct cell best = {-1, -1};
+    int best_score = grid->n_rows + grid->n_cols + 1;
+    for (int r = 0; r < grid->n_rows; r++)
+    {
+        if (row_unknown[r] == 0 || row_unknown[r] >= best_score)
+        {
+            continue;
+        }
+
+        const uint64_t *fill  = bitboard_line(grid, BB_PLANE_FILL, AXIS_ROW, r);
+        const uint64_t *xmark = bitboard_line(grid, BB_PLANE_XMARK, AXIS_ROW, r);
+        for (int w = 0; w < grid->row_words; w++)
+        {
+            uint64_t unknown = ~(fill[w] | xmark[w]) 
+                               & bitline_word_mask(grid->n_cols, w);
+            while (unknown != 0)
+            {
+                int c = w * BB_WORD_BITS + __builtin_ctzll(unknown);
+                unknown &= unknown - 1;
+
+                int score = row_unknown[r] + col_unknown[c];
+                if (score < best_score)
+                {
+                    best_score = score;
+                    best = (struct cell){r, c};
+                }
+            }
+        }
+    }
+
+    assert(best.row >= 0);
+    return best;
+}
+
+void solver_assume(struct solver *s, struct cell cell, enum bb_plane plane)
+{
+    assert(!bitboard_get(s->grid, BB_PLANE_FILL, cell));
+    assert(!bitboard_get(s->grid, BB_PLANE_XMARK, cell));
+
+    bitboard_put(s->grid, plane, cell, true);
+    s->n_known++;
+    solver_enqueue(s, cell.row);
+    solver_enqueue(s, s->puzzle->n_rows + cell.col);
+}
+
+void solver_enqueue(struct solver *s, int line_id)
+{
+    if (bitline_test(s->queued, line_id))
+    {
+        return;
+    }
+    s->queued[line_id / BB_WORD_BITS] |= (uint64_t)1 << (line_id % BB_WORD_BITS);
+
+    int n_lines = solver_n_lines(s);
+    s->queue[(s->queue_head + s->queue_len) % n_lines] = line_id;
+    s->queue_len++;
+}
+
+int solver_dequeue(struct solver *s)
+{
+    if (s->queue_len == 0)
+    {
+        return -1;
+    }
+
+    int line_id = s->queue[s->queue_head];
+    s->queue_head = (s->queue_head + 1) % solver_n_lines(s);
+    s->queue_len--;
+    s->queued[line_id / BB_WORD_BITS] &= ~((uint64_t)1 << (line_id % BB_WORD_BITS));
+    return line_id;
+}
+
+void solver_enqueue_all(struct solver *s)
+{
+    for (int id = 0; id < solver_n_lines(s); id++)
+    {
+        solver_enqueue(s, id);
+    }
+}
+
+bool solver_solve_line(struct solver *s, int line_id)
+{
+    s->stats.n_line_solves++;
+
+    enum axis axis  = line_id_axis(s, line_id);
+    int idx         = line_id_idx(s, line_id);
+    int len         = bitboard_line_len(s->grid, axis);
+    int n_words     = bitboard_line_words(s->grid, axis);
+    const int *clues = s->clues + s->clue_start[line_id];
+    int n_clues     = s->n_clues[line_id];
+
+    const uint64_t *known_fill  = bitboard_line(s->grid, BB_PLANE_FILL, axis, idx);
+    const uint64_t *known_empty = bitboard_line(s->grid, BB_PLANE_XMARK, axis, idx);
+
+    for (int x = 0; x < len; x++)
+    {
+        s->cells[x] = bitline_test(known_fill, x)  ? LINE_FILLED
+                    : bitline_test(known_empty, x) ? LINE_EMPTY
+                                                   : LINE_UNKNOWN;
+    }
+
+    if (!line_leftmost(s, s->cells, len, clues, n_clues, s->fit, s->left))
+    {
+        return false;
+    }
+
+    // Right-most placement is the left-most placement of the reversed line
+    for (int x = 0; x < len; x++)
+    {
+        s->rev_cells[x] = s->cells[len - 1 - x];
+    }
+    for (int i = 0; i < n_clues; i++)
+    {
+        s->rev_clues[i] = clues[n_clues - 1 - i];
+    }
+    if (!line_leftmost(s, s->rev_cells, len, s->rev_clues, n_clues, 
+                       s->rev_fit, s->right))
+    {
+        return false;
+    }
+    for (int i = 0; i < n_clues / 2; i++)
+    {
+        int tmp = s->right[i];
+        s->right[i] = s->right[n_clues - 1 - i];
+        s->right[n_clues - 1 - i] = tmp;
+    }
+    for (int i = 0; i < n_clues; i++)
+    {
+        s->right[i] = len - (s->right[i] + clues[i]);
+    }
+
+    // Overlap of the same block in both placements is filled,
+    // overlap of the same gap in both placements is empty
+    uint64_t fill[BB_MAX_LINE_WORDS]  = {0};
+    uint64_t empty[BB_MAX_LINE_WORDS] = {0};
+    for (int i = 0; i < n_clues; i++)
+    {
+        bitline_set_range(fill, s->right[i], s->left[i] + clues[i]);
+    }
+    for (int j = 0; j <= n_clues; j++)
+    {
+        int gap_start = (j == 0)       ? 0   : s->right[j - 1] + clues[j - 1];
+        int gap_end   = (j == n_clues) ? len : s->left[j];
+        bitline_set_range(empty, gap_start, gap_end);
+    }
+
+    int n_new     = 0;
+    int n_unknown = 0;
+    for (int w = 0; w < n_words; w++)
+    {
+        if ((fill[w] & known_empty[w]) || (empty[w] & known_fill[w]))
+        {
+            return false;
+        }
+
+        uint64_t unknown = ~(known_fill[w] | known_empty[w]) 
+                           & bitline_word_mask(len, w);
+        n_new     += __builtin_popcountll((fill[w] | empty[w]) & unknown);
+        n_unknown += __builtin_popcountll(unknown);
+    }
+
+    // Overlap gave nothing, settle the line exactly
+    bool settled = false;
+    if (n_new == 0 && n_unknown > 0)
+    {
+        line_settle(s, len, clues, n_clues, fill, empty);
+        settled = true;
+    }
+
+    enum axis cross_axis = (axis == AXIS_ROW) ? AXIS_COL : AXIS_ROW;
+    int cross_id_base    = (cross_axis == AXIS_ROW) ? 0 : s->puzzle->n_rows;
+
+    n_new = 0;
+    for (int w = 0; w < n_words; w++)
+    {
+        for (enum bb_plane plane = BB_PLANE_FILL; plane <= BB_PLANE_XMARK; plane++)
+        {
+            uint64_t new_bits = (plane == BB_PLANE_FILL)
+                                ? fill[w] & ~known_fill[w]
+                                : empty[w] & ~known_empty[w];
+            while (new_bits != 0)
+            {
+                int x = w * BB_WORD_BITS + __builtin_ctzll(new_bits);
+                new_bits &= new_bits - 1;
+
+                struct cell cell = (axis == AXIS_ROW) ? (struct cell){idx, x}
+                                                      : (struct cell){x, idx};
+                bitboard_put(s->grid, plane, cell, true);
+                s->n_known++;
+                s->stats.n_cells_fixed++;
+                n_new++;
+                solver_enqueue(s, cross_id_base + x);
+            }
+        }
+    }
+
+    // Overlap is not idempotent, run the line again until it stops giving
+    if (!settled && n_new > 0 && n_new < n_unknown)
+    {
+        solver_enqueue(s, line_id);
+    }
+
+    return true;
+}
+
+bool line_leftmost(struct solver *s, const unsigned char *cells, int len,
+                   const int *clues, int n_clues, unsigned char *fit, 
+                   int *starts)
+{
+    int *run = s->run;
+
+    // Length of the non-empty run starting at each cell
+    run[len] = 0;
+    for (int p = len - 1; p >= 0; p--)
+    {
+        run[p] = (cells[p] == LINE_EMPTY) ? 0 : run[p + 1] + 1;
+    }
+
+    // No blocks left, no filled cell may remain
+    FIT(fit, n_clues, len) = true;
+    for (int p = len - 1; p >= 0; p--)
+    {
+        FIT(fit, n_clues, p) = FIT(fit, n_clues, p + 1) 
+                               && cells[p] != LINE_FILLED;
+    }
+
+    for (int i = n_clues - 1; i >= 0; i--)
+    {
+        int c = clues[i];
+        FIT(fit, i, len) = false;
+        for (int p = len - 1; p >= 0; p--)
+        {
+            bool place_here = run[p] >= c
+                              && (p + c == len || cells[p + c] != LINE_FILLED)
+                              && FIT(fit, i + 1, MIN(p + c + 1, len));
+            bool skip_cell  = cells[p] != LINE_FILLED && FIT(fit, i, p + 1);
+            FIT(fit, i, p) = place_here || skip_cell;
+        }
+    }
+
+    if (!FIT(fit, 0, 0))
+    {
+        return false;
+    }
+
+    // Greedy placement, the table guarantees the rest still fits
+    int p = 0;
+    for (int i = 0; i < n_clues; i++)
+    {
+        int c = clues[i];
+        while (!(run[p] >= c
+                 && (p + c == len || cells[p + c] != LINE_FILLED)
+                 && FIT(fit, i + 1, MIN(p + c + 1, len))))
+        {
+            assert(cells[p] != LINE_FILLED);
+            p++;
+        }
+        starts[i] = p;
+        p = MIN(p + c + 1, len);
+    }
+
+    return true;
+}
+
+void line_settle(struct solver *s, int len, const int *clues, int n_clues,
+                 uint64_t *fill, uint64_t *empty)
+{
+    const unsigned char *cells = s->cells;
+    int *run      = s->run;
+    int *can_fill = s->can_fill;
+
+// Blocks [0, i) fit in cells [0, q), from the reversed line table
+#define PREFIX(i, q) FIT(s->rev_fit, n_clues - (i), len - (q))
+
+    run[len] = 0;
+    for (int p = len - 1; p >= 0; p--)
+    {
+        run[p] = (cells[p] == LINE_EMPTY) ? 0 : run[p + 1] + 1;
+    }
+
+    // Count valid placements covering each cell with a difference array
+    memset(can_fill, 0, (len + 1) * sizeof(int));
+    for (int i = 0; i < n_clues; i++)
+    {
+        int c = clues[i];
+        for (int p = 0; p + c <= len; p++)
+        {
+            bool valid = run[p] >= c
+                         && (p == 0 ? i == 0 
+                                    : cells[p - 1] != LINE_FILLED
+                                      && PREFIX(i, p - 1))
+                         && (p + c == len || cells[p + c] != LINE_FILLED)
+                         && FIT(s->fit, i + 1, MIN(p + c + 1, len));
+            if (valid)
+            {
+                can_fill[p]++;
+                can_fill[p + c]--;
+            }
+        }
+    }
+
+    memset(fill,  0, BB_N_WORDS(len) * sizeof(uint64_t));
+    memset(empty, 0, BB_N_WORDS(len) * sizeof(uint64_t));
+
+    int n_covering = 0;
+    for (int x = 0; x < len; x++)
+    {
+        n_covering += can_fill[x];
+
+        // Empty if some split puts blocks [0, i) left and [i, n) right of x
+        bool can_empty = false;
+        for (int i = 0; i <= n_clues && !can_empty && cells[x] != LINE_FILLED; i++)
+        {
+            can_empty = PREFIX(i, x) && FIT(s->fit, i, x + 1);
+        }
+
+        if (!can_empty)
+        {
+            bitline_set_range(fill, x, x + 1);
+        }
+        else if (n_covering == 0)
+        {
+            bitline_set_range(empty, x, x + 1);
+        }
+    }
+
+#undef PREFIX
+}
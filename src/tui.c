@@ -1,10 +1,49 @@
+#include "ansi_render.h"
 #include "tui.h"
 #include "utils.h"
+#include <fcntl.h>
+#include <langinfo.h>
+#include <limits.h>
+#include <locale.h>
 #include <ncurses.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <wchar.h>
 
 #define KEY_LF 10
+#define KEY_DEL 127
+
+// Ncurses writes to the terminal fd directly, its output is measured with
+// the process write counter ("wchar") around each doupdate()
+#define PROC_IO_FILE_NAME "/proc/self/io"
+
+#define MAX_DYNAMIC_PAIRS 128
+
+static struct frame_stats frame_stats;
+static int proc_io_fd = -1;
+
+static SCREEN *headless_screen;
+static FILE *headless_out;
+
+static enum frame_renderer frame_renderer = RENDERER_NCURSES;
+static struct ansi_renderer *ansi_renderer;
+static FILE *ansi_screen_out; // Ncurses output, discarded
+static struct termios saved_tty;
+static bool is_tty_saved;
+
+static void (*frame_hook)(void *arg);
+static void *frame_hook_arg;
+
+// Pairs made by get_color_pair(), numbered from COLOR_P_N_PAIRS
+static struct
+{
+    short fg, bg;
+} dynamic_pairs[MAX_DYNAMIC_PAIRS];
+static int n_dynamic_pairs;
 
 const struct menu_config menu_config_default =
 {
@@ -14,6 +53,48 @@ const struct menu_config menu_config_default =
 /* Function Prototypes */
 
 void end_screen(void);
+
+/**
+ * Terminal modes, colors and frame counters shared by all screens.
+ */
+void configure_screen(void);
+
+/**
+ * Screen for the ANSI renderer: ncurses reads keys from the terminal but
+ * its output goes to /dev/null, the renderer writes to stdout.
+ */
+void init_ansi_screen(void);
+
+/**
+ * Ncurses only sets the modes of its output terminal, the input is put
+ * in cbreak/noecho mode here.
+ */
+void set_tty_input_mode(int fd);
+void restore_tty_input_mode(void);
+
+/**
+ * Write a terminfo string capability to the terminal, not to ncurses'
+ * output. No-op if the terminal does not have it.
+ */
+void write_tty_cap(const char *cap_name);
+
+/**
+ * @return Bytes written by the process so far, -1 if unknown
+ */
+long long get_bytes_written(void);
+
+/**
+ * Compare the staged frame (newscr) with the screen (curscr).
+ * @param cells_out        Cells that differ
+ * @param attr_changes_out Attribute switches when writing them row by row
+ */
+void count_changed_cells(long *cells_out, long *attr_changes_out);
+
+/**
+ * @return Character to write for a screen cell, line drawing is ASCII
+ */
+wchar_t get_dump_char(const cchar_t *cell);
+
 ITEM **menu_items_create(const struct menu_param *params);
 
 void init_colors(void);
@@ -56,16 +137,213 @@ void color_test(void)
     }
 }
 
+short get_color_pair(short fg, short bg)
+{
+    for (int i = 0; i < n_dynamic_pairs; i++)
+    {
+        if (dynamic_pairs[i].fg == fg && dynamic_pairs[i].bg == bg)
+        {
+            return COLOR_P_N_PAIRS + i;
+        }
+    }
+
+    short pair = COLOR_P_N_PAIRS + n_dynamic_pairs;
+    if (n_dynamic_pairs == MAX_DYNAMIC_PAIRS || pair >= COLOR_PAIRS
+        || init_pair(pair, fg, bg) == ERR)
+    {
+        LOGF(LOG_WARNING, "No color pair left for %d/%d", fg, bg);
+        return COLOR_P_DEFAULT;
+    }
+
+    dynamic_pairs[n_dynamic_pairs].fg = fg;
+    dynamic_pairs[n_dynamic_pairs].bg = bg;
+    n_dynamic_pairs++;
+    return pair;
+}
+
+bool has_unicode(void)
+{
+    return strcmp(nl_langinfo(CODESET), "UTF-8") == 0;
+}
+
+void set_frame_renderer(enum frame_renderer renderer)
+{
+    frame_renderer = renderer;
+}
+
 void init_screen(void)
 {
-    initscr();
+    // Wide characters are only drawn with a UTF-8 locale
+    setlocale(LC_CTYPE, "");
+    if (frame_renderer == RENDERER_ANSI)
+    {
+        init_ansi_screen();
+    }
+    else
+    {
+        initscr();
+    }
     atexit(end_screen);
+    configure_screen();
+}
 
-    cbreak();
-    noecho();
-    keypad(stdscr, true);
-    curs_set(0);
-    init_colors();
+int init_headless_screen(FILE *in, const char *term, struct pos size)
+{
+    assert(in != NULL);
+    assert(headless_screen == NULL);
+
+    setlocale(LC_CTYPE, "");
+    headless_out = fopen("/dev/null", "w");
+    if (headless_out == NULL)
+    {
+        LOG(LOG_ERROR, "Failed to open /dev/null");
+        return -1;
+    }
+
+    headless_screen = newterm(term, headless_out, in);
+    if (headless_screen == NULL)
+    {
+        LOGF(LOG_ERROR, "Failed to create screen for terminal: %s",
+             term ? term : "$TERM");
+        fclose(headless_out);
+        headless_out = NULL;
+        return -1;
+    }
+
+    // No real terminal to take the size from
+    resize_term(size.y, size.x);
+    if (frame_renderer == RENDERER_ANSI)
+    {
+        ansi_renderer = ansi_renderer_create(fileno(headless_out), size);
+        if (ansi_renderer == NULL)
+        {
+            delscreen(headless_screen);
+            fclose(headless_out);
+            headless_screen = NULL;
+            headless_out    = NULL;
+            return -1;
+        }
+    }
+    configure_screen();
+    return 0;
+}
+
+void end_headless_screen(void)
+{
+    if (headless_screen == NULL)
+    {
+        return;
+    }
+
+    ansi_renderer_destroy(ansi_renderer);
+    ansi_renderer = NULL;
+    endwin();
+    delscreen(headless_screen);
+    frame_hook     = NULL;
+    frame_hook_arg = NULL;
+    fclose(headless_out);
+    headless_screen = NULL;
+    headless_out    = NULL;
+}
+
+void dump_screen(FILE *out)
+{
+    assert(out != NULL);
+
+    struct pos size;
+    getmaxyx(curscr, size.y, size.x);
+
+    // Rows below the last one written are left out
+    int n_rows = 0;
+    for (int y = 0; y < size.y; y++)
+    {
+        for (int x = 0; x < size.x; x++)
+        {
+            cchar_t cell;
+            mvwin_wch(curscr, y, x, &cell);
+            if (get_dump_char(&cell) != L' ')
+            {
+                n_rows = y + 1;
+                break;
+            }
+        }
+    }
+
+    char mb[MB_LEN_MAX + 1];
+    for (int y = 0; y < n_rows; y++)
+    {
+        for (int x = 0; x < size.x; x++)
+        {
+            cchar_t cell;
+            mvwin_wch(curscr, y, x, &cell);
+            size_t len = wcrtomb(mb, get_dump_char(&cell), NULL);
+            if (len == (size_t)-1)
+            {
+                mb[0] = '?';
+                len   = 1;
+            }
+            fwrite(mb, 1, len, out);
+        }
+        fputc('\n', out);
+    }
+
+    static const char digits[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+    for (int y = 0; y < n_rows; y++)
+    {
+        for (int x = 0; x < size.x; x++)
+        {
+            cchar_t cell;
+            wchar_t wch[CCHARW_MAX];
+            attr_t attrs;
+            short pair;
+            mvwin_wch(curscr, y, x, &cell);
+            getcchar(&cell, wch, &attrs, &pair, NULL);
+            fputc((pair == 0) ? '.' : (pair < 36) ? digits[pair] : '+', out);
+        }
+        fputc('\n', out);
+    }
+}
+
+int get_key_within(WINDOW *win, int timeout_ms)
+{
+    wtimeout(win, timeout_ms);
+    int key = wgetch(win);
+    wtimeout(win, -1);
+    return key;
+}
+
+void resize_screen(void)
+{
+    if (ansi_renderer == NULL)
+    {
+        // Ncurses has already resized its screen
+        return;
+    }
+
+    // Ncurses cannot read the size from /dev/null, headless screens are
+    // resized by their caller
+    struct winsize ws;
+    if (headless_screen == NULL && ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0
+        && ws.ws_row > 0 && ws.ws_col > 0)
+    {
+        resize_term(ws.ws_row, ws.ws_col);
+    }
+
+    struct pos size;
+    getmaxyx(stdscr, size.y, size.x);
+    if (ansi_renderer_resize(ansi_renderer, size) != 0)
+    {
+        LOGF(LOG_WARNING, "Failed to resize the ANSI renderer to %dx%d",
+             size.y, size.x);
+    }
+}
+
+int get_pending_key(WINDOW *win)
+{
+    nodelay(win, true);
+    int key = wgetch(win);
+    nodelay(win, false);
+    return key;
 }
 
 void print_in_middle(WINDOW *win, const char *string)
@@ -79,10 +357,124 @@ void display_notification(const char *msg)
 {
     clear();
     print_in_middle(stdscr, msg);
-    refresh();
+    frame_stage(stdscr);
+    frame_display();
     getch();
     clear();
-    refresh();
+    frame_stage(stdscr);
+    frame_display();
+}
+
+bool prompt_number(const char *msg, long max, long *value_out)
+{
+    assert(msg != NULL);
+    assert(value_out != NULL);
+
+    char digits[16] = "";
+    int  n_digits   = 0;
+    long value      = 0;
+
+    int key;
+    while (true)
+    {
+        char line[COLS + 1];
+        snprintf(line, sizeof(line), "%s%s_", msg, digits);
+        clear();
+        print_in_middle(stdscr, line);
+        frame_stage(stdscr);
+        frame_display();
+
+        key = getch();
+        if (key == 'q' || key == ERR || key == KEY_ENTER || key == KEY_LF)
+        {
+            break;
+        }
+        if ((key == KEY_BACKSPACE || key == KEY_DEL || key == '\b')
+            && n_digits > 0)
+        {
+            digits[--n_digits] = '\0';
+            value /= 10;
+        }
+        else if (key >= '0' && key <= '9' && n_digits < (int)sizeof(digits) - 1
+                 && value <= (max - (key - '0')) / 10)
+        {
+            digits[n_digits++] = (char)key;
+            digits[n_digits]   = '\0';
+            value = value * 10 + (key - '0');
+        }
+    }
+
+    clear();
+    frame_stage(stdscr);
+    frame_display();
+
+    *value_out = value;
+    return key != 'q' && key != ERR && n_digits > 0;
+}
+
+void frame_stage(WINDOW *win)
+{
+    wnoutrefresh(win);
+}
+
+void frame_display(void)
+{
+    struct timespec start, end;
+    long long bytes;
+
+    if (ansi_renderer != NULL)
+    {
+        // Ncurses' screen is never updated, newscr keeps the whole frame
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        bytes = ansi_render_frame(ansi_renderer, newscr,
+                                  &frame_stats.last_cells,
+                                  &frame_stats.last_attr_changes);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        bytes = MAX(bytes, 0);
+    }
+    else
+    {
+        // Reading both screens costs more than drawing, so only when headless
+        if (headless_screen != NULL)
+        {
+            count_changed_cells(&frame_stats.last_cells,
+                                &frame_stats.last_attr_changes);
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        long long before = get_bytes_written();
+        doupdate();
+        long long after  = get_bytes_written();
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        bytes = (before < 0 || after < 0) ? 0 : after - before;
+    }
+    frame_stats.total_cells        += frame_stats.last_cells;
+    frame_stats.total_attr_changes += frame_stats.last_attr_changes;
+
+    frame_stats.last_us   = elapsed_us(start, end);
+    frame_stats.total_us += frame_stats.last_us;
+
+    frame_stats.n_frames++;
+    frame_stats.last_bytes   = bytes;
+    frame_stats.max_bytes    = MAX(frame_stats.max_bytes, bytes);
+    frame_stats.total_bytes += bytes;
+
+    if (frame_hook != NULL)
+    {
+        frame_hook(frame_hook_arg);
+    }
+}
+
+const struct frame_stats *get_frame_stats(void)
+{
+    return &frame_stats;
+}
+
+void set_frame_hook(void (*hook)(void *arg), void *arg)
+{
+    frame_hook     = hook;
+    frame_hook_arg = arg;
 }
 
 struct menu_set *menu_set_create(const struct menu_param *params)
@@ -136,6 +528,25 @@ void menu_set_configure(struct menu_set *mset, const struct menu_config config)
     set_menu_sub(mset->menu, derwin(mset->win, req_size.y, req_size.x, 1, 1));
 }
 
+int menu_set_move(struct menu_set *mset, struct pos start)
+{
+    assert(mset != NULL);
+
+    if (mvwin(mset->win, start.y, start.x) == ERR)
+    {
+        return -1;
+    }
+
+    // Subwindows keep their screen position, the menu area is recreated
+    WINDOW *sub = menu_sub(mset->menu);
+    struct pos sub_size;
+    getmaxyx(sub, sub_size.y, sub_size.x);
+    set_menu_sub(mset->menu, NULL);
+    delwin(sub);
+    set_menu_sub(mset->menu, derwin(mset->win, sub_size.y, sub_size.x, 1, 1));
+    return 0;
+}
+
 void menu_set_destroy(struct menu_set *mset)
 {
     assert(mset != NULL);
@@ -143,7 +554,8 @@ void menu_set_destroy(struct menu_set *mset)
     assert(mset->win != NULL);
 
     wclear(mset->win);
-    wrefresh(mset->win);
+    frame_stage(mset->win);
+    frame_display();
     free_menu(mset->menu);
     for (int i = 0; i < mset->params->n_choices; i++)
     {
@@ -162,9 +574,11 @@ int menu_set_get_user_choice(struct menu_set *mset)
 
     box(mset->win, 0, 0);
     post_menu(mset->menu);
-    wrefresh(mset->win);
+    frame_stage(mset->win);
+    frame_display();
     int choice;
-    while ((choice = wgetch(mset->win)) != 'q')
+    // ERR once the input is closed
+    while ((choice = wgetch(mset->win)) != 'q' && choice != ERR)
     {
         switch (choice)
         {
@@ -179,7 +593,8 @@ int menu_set_get_user_choice(struct menu_set *mset)
                 return item_index(current_item(mset->menu));
                 break;
         }
-        wrefresh(mset->win);
+        frame_stage(mset->win);
+        frame_display();
     }
     unpost_menu(mset->menu);
     return MENU_NOT_SELECTED;
@@ -190,6 +605,193 @@ int menu_set_get_user_choice(struct menu_set *mset)
 void end_screen(void) 
 { 
     endwin();
+    if (ansi_renderer != NULL)
+    {
+        write_tty_cap("rmkx");
+        ansi_renderer_destroy(ansi_renderer);
+        ansi_renderer = NULL;
+        restore_tty_input_mode();
+    }
+}
+
+void write_tty_cap(const char *cap_name)
+{
+    const char *cap = tigetstr(cap_name);
+    if (cap == NULL || cap == (char *)-1)
+    {
+        return;
+    }
+
+    size_t len = strlen(cap);
+    if (write(STDOUT_FILENO, cap, len) != (ssize_t)len)
+    {
+        LOGF(LOG_WARNING, "Failed to write terminal capability: %s", cap_name);
+    }
+}
+
+void init_ansi_screen(void)
+{
+    struct winsize ws;
+    if (!isatty(STDIN_FILENO) || ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) != 0)
+    {
+        fprintf(stderr, "The ANSI renderer needs a terminal\n");
+        exit(EXIT_FAILURE);
+    }
+
+    ansi_screen_out = fopen("/dev/null", "w");
+    ALLOC_CHECK_EXIT(ansi_screen_out);
+    if (newterm(NULL, ansi_screen_out, stdin) == NULL)
+    {
+        fprintf(stderr, "Unknown terminal type: %s\n", getenv("TERM"));
+        exit(EXIT_FAILURE);
+    }
+    resize_term(ws.ws_row, ws.ws_col);
+
+    set_tty_input_mode(STDIN_FILENO);
+    struct pos size = {.y = ws.ws_row, .x = ws.ws_col};
+    ansi_renderer = ansi_renderer_create(STDOUT_FILENO, size);
+    ALLOC_CHECK_EXIT(ansi_renderer);
+
+    // Keys are only sent as ncurses expects them in keypad mode
+    write_tty_cap("smkx");
+}
+
+void set_tty_input_mode(int fd)
+{
+    struct termios tty;
+    if (tcgetattr(fd, &tty) != 0)
+    {
+        LOG(LOG_WARNING, "Failed to read the terminal modes");
+        return;
+    }
+    saved_tty    = tty;
+    is_tty_saved = true;
+
+    tty.c_lflag &= ~(ICANON | ECHO);
+    tty.c_cc[VMIN]  = 1;
+    tty.c_cc[VTIME] = 0;
+    tcsetattr(fd, TCSANOW, &tty);
+}
+
+void restore_tty_input_mode(void)
+{
+    if (is_tty_saved)
+    {
+        tcsetattr(STDIN_FILENO, TCSANOW, &saved_tty);
+        is_tty_saved = false;
+    }
+}
+
+void configure_screen(void)
+{
+    if (proc_io_fd < 0)
+    {
+        proc_io_fd = open(PROC_IO_FILE_NAME, O_RDONLY);
+    }
+    if (proc_io_fd < 0)
+    {
+        LOGF(LOG_INFO, "Frame output is not counted: %s", PROC_IO_FILE_NAME);
+    }
+
+    cbreak();
+    noecho();
+    keypad(stdscr, true);
+    curs_set(0);
+    init_colors();
+}
+
+long long get_bytes_written(void)
+{
+    if (proc_io_fd < 0)
+    {
+        return -1;
+    }
+
+    char buf[512];
+    ssize_t len = pread(proc_io_fd, buf, sizeof(buf) - 1, 0);
+    if (len <= 0)
+    {
+        return -1;
+    }
+    buf[len] = '\0';
+
+    const char *wchar = strstr(buf, "wchar:");
+    return (wchar != NULL) ? atoll(wchar + strlen("wchar:")) : -1;
+}
+
+void count_changed_cells(long *cells_out, long *attr_changes_out)
+{
+    struct pos size;
+    getmaxyx(newscr, size.y, size.x);
+
+    long cells        = 0;
+    long attr_changes = 0;
+
+    // Attributes are reset before each frame
+    attr_t last_attrs = A_NORMAL;
+    short last_pair   = 0;
+
+    for (int y = 0; y < size.y; y++)
+    {
+        for (int x = 0; x < size.x; x++)
+        {
+            cchar_t next, curr;
+            mvwin_wch(newscr, y, x, &next);
+            mvwin_wch(curscr, y, x, &curr);
+
+            wchar_t next_wch[CCHARW_MAX], curr_wch[CCHARW_MAX];
+            attr_t next_attrs, curr_attrs;
+            short next_pair, curr_pair;
+            getcchar(&next, next_wch, &next_attrs, &next_pair, NULL);
+            getcchar(&curr, curr_wch, &curr_attrs, &curr_pair, NULL);
+
+            if (next_attrs == curr_attrs && next_pair == curr_pair
+                && wcscmp(next_wch, curr_wch) == 0)
+            {
+                continue;
+            }
+
+            cells++;
+            if (next_attrs != last_attrs || next_pair != last_pair)
+            {
+                attr_changes++;
+                last_attrs = next_attrs;
+                last_pair  = next_pair;
+            }
+        }
+    }
+
+    *cells_out        = cells;
+    *attr_changes_out = attr_changes;
+}
+
+wchar_t get_dump_char(const cchar_t *cell)
+{
+    wchar_t wch[CCHARW_MAX];
+    attr_t attrs;
+    short pair;
+    getcchar(cell, wch, &attrs, &pair, NULL);
+
+    if (!(attrs & A_ALTCHARSET))
+    {
+        return (wch[0] == L'\0') ? L' ' : wch[0];
+    }
+
+    // VT100 line drawing set
+    switch (wch[0])
+    {
+        case L'q':
+            return L'-';
+        case L'x':
+            return L'|';
+        case L'a':
+            return L'#';
+        case L'l': case L'k': case L'm': case L'j':
+        case L't': case L'u': case L'v': case L'w': case L'n':
+            return L'+';
+        default:
+            return wch[0];
+    }
 }
 
 void set_custom_colors(void)
@@ -217,6 +819,10 @@ void set_custom_colors(void)
     {
         set_color_rgb(COLOR_DARK_GREY, 54, 57, 58);
     }
+    if (COLORS > COLOR_SHADE)
+    {
+        set_color_rgb(COLOR_SHADE, 40, 44, 45);
+    }
 }
 
 void set_color_rgb(short color, short r, short g, short b)
@@ -283,6 +889,7 @@ void init_colors(void)
     assume_default_colors(COLOR_WHITE, COLOR_BLACK);
 
     set_color_pairs();
+    n_dynamic_pairs = 0;
 }
 
 ITEM **menu_items_create(const struct menu_param *params)
@@ -0,0 +1,200 @@
+#include "undo_history.h"
+#include "utils.h"
+#include <string.h>
+
+#define UNDO_ALIGN(size) (((size) + 7) & ~(size_t)7)
+
+struct undo_record_header
+{
+    uint32_t size; // Bytes, header included
+    uint32_t id;   // Last, read by undo_history_id()
+};
+
+/* Function prototypes */
+
+/**
+ * @return A chunk that can hold `size` bytes, NULL if allocation failed
+ *  - Drops the oldest chunks if a new one would go past the memory cap
+ */
+struct undo_chunk *undo_chunk_get(struct undo_history *h, size_t size);
+
+/**
+ * Free the chunk or keep it as the spare.
+ */
+void undo_chunk_release(struct undo_history *h, struct undo_chunk *chunk);
+
+size_t undo_chunk_bytes(const struct undo_chunk *chunk);
+
+static inline struct undo_record_header *undo_record_at(const struct undo_chunk *chunk,
+                                                        size_t offset)
+{
+    return (struct undo_record_header *)((char *)chunk->data + offset);
+}
+
+/* Public */
+
+struct undo_history *undo_history_create(size_t memory_cap)
+{
+    // No chunk until the first push
+    struct undo_history *h = calloc(1, sizeof(struct undo_history));
+    ALLOC_CHECK_RETURN(h, NULL);
+
+    h->memory_cap = memory_cap;
+    return h;
+}
+
+void undo_history_destroy(struct undo_history *h)
+{
+    if (h != NULL)
+    {
+        struct undo_chunk *chunk = h->first;
+        while (chunk != NULL)
+        {
+            struct undo_chunk *next = chunk->next;
+            free(chunk);
+            chunk = next;
+        }
+        free(h->spare);
+    }
+    free(h); h = NULL;
+}
+
+void *undo_history_push(struct undo_history *h, size_t size)
+{
+    assert(h != NULL);
+
+    size_t rec_size = sizeof(struct undo_record_header) + UNDO_ALIGN(size);
+    assert(rec_size <= UINT32_MAX);
+
+    struct undo_chunk *chunk = h->last;
+    if (chunk == NULL || chunk->used + rec_size > chunk->size)
+    {
+        chunk = undo_chunk_get(h, rec_size);
+        if (chunk == NULL)
+        {
+            return NULL;
+        }
+
+        chunk->prev     = h->last;
+        chunk->first_id = h->end_id;
+        if (h->last != NULL)
+        {
+            h->last->next = chunk;
+        }
+        else
+        {
+            h->first    = chunk;
+            h->first_id = h->end_id;
+        }
+        h->last = chunk;
+    }
+
+    struct undo_record_header *rec = undo_record_at(chunk, chunk->used);
+    rec->size = rec_size;
+    rec->id   = h->end_id++;
+    if (UNDO_ALIGN(size) != size)
+    {
+        memset((char *)(rec + 1) + size, 0, UNDO_ALIGN(size) - size);
+    }
+
+    chunk->used += rec_size;
+    return rec + 1;
+}
+
+void *undo_history_get(const struct undo_history *h, uint32_t id)
+{
+    assert(h != NULL);
+
+    if (!undo_history_has(h, id))
+    {
+        return NULL;
+    }
+
+    // Recent records are asked for most
+    const struct undo_chunk *chunk = h->last;
+    while (chunk->first_id > id)
+    {
+        chunk = chunk->prev;
+    }
+
+    size_t offset = 0;
+    struct undo_record_header *rec = undo_record_at(chunk, offset);
+    while (rec->id != id)
+    {
+        offset += rec->size;
+        rec = undo_record_at(chunk, offset);
+    }
+    return rec + 1;
+}
+
+/* Private */
+
+struct undo_chunk *undo_chunk_get(struct undo_history *h, size_t size)
+{
+    size = MAX(size, UNDO_CHUNK_SIZE);
+
+    struct undo_chunk *chunk = NULL;
+    if (h->spare != NULL && h->spare->size >= size)
+    {
+        chunk    = h->spare;
+        h->spare = NULL;
+    }
+    else
+    {
+        // Oldest records go first
+        size_t need = sizeof(struct undo_chunk) + size;
+        while (h->first != NULL && h->bytes_in_use + need > h->memory_cap)
+        {
+            struct undo_chunk *oldest = h->first;
+            h->first = oldest->next;
+            if (h->first != NULL)
+            {
+                h->first->prev = NULL;
+                h->first_id    = h->first->first_id;
+            }
+            else
+            {
+                h->last     = NULL;
+                h->first_id = h->end_id;
+            }
+            undo_chunk_release(h, oldest);
+
+            if (h->spare != NULL && h->spare->size >= size)
+            {
+                chunk    = h->spare;
+                h->spare = NULL;
+                break;
+            }
+        }
+
+        if (chunk == NULL)
+        {
+            chunk = malloc(sizeof(struct undo_chunk) + size);
+            ALLOC_CHECK_RETURN(chunk, NULL);
+            chunk->size      = size;
+            h->bytes_in_use += undo_chunk_bytes(chunk);
+        }
+    }
+
+    chunk->prev = NULL;
+    chunk->next = NULL;
+    chunk->used = 0;
+    return chunk;
+}
+
+void undo_chunk_release(struct undo_history *h, struct undo_chunk *chunk)
+{
+    if (h->spare == NULL)
+    {
+        h->spare = chunk;
+        return;
+    }
+
+    h->bytes_in_use -= undo_chunk_bytes(chunk);
+    free(chunk);
+}
+
+size_t undo_chunk_bytes(const struct undo_chunk *chunk)
+{
+    return sizeof(struct undo_chunk) + chunk->size;
+}
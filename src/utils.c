@@ -70,6 +70,12 @@ void free_ptr_array(void **arr, size_t n)
     free(arr); arr = NULL;
 }
 
+double elapsed_us(struct timespec start, struct timespec end)
+{
+    return (end.tv_sec - start.tv_sec) * 1e6
+           + (end.tv_nsec - start.tv_nsec) / 1e3;
+}
+
 /* ---- LOGGING ---- */
 
 static FILE *log_file = NULL;
@@ -114,9 +120,11 @@ void log_msg(enum log_level lv, const char *fmt, ...)
 
     va_list args;
     va_start(args, fmt);
+    flockfile(log_file); // Keep lines whole across threads
     fprintf(log_file, "[%s] ", log_level_str[lv]);
     vfprintf(log_file, fmt, args);
     fprintf(log_file, "\n");
     fflush(log_file);
+    funlockfile(log_file);
     va_end(args);
 }